@@ -0,0 +1,225 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+// times saving and loading a session in each file format, and compares the
+// load time with the period of one audio buffer, which is what a set-list
+// change between songs has to fit in.
+//
+// usage: bench-load [-s nseqs] [-n nsteps] [-d density] [-m muted] [-b bufsize]
+//                   [-r rate] [-k loads] [-S seed] [-j]
+//
+// -m mutes that fraction of the sequences, which are loaded packed
+//
+// one result line is printed per format, as CSV (default) or as JSON
+// lines (-j)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "sequoia.h"
+#include "fakejack.h"
+
+static const char *formats[] = {"sqa", "sqb"};
+
+static int nseqs = 256;
+static int nsteps = 256;
+static float density = 0.25;
+static float muted = 0;
+static int bs = 256;
+static int sr = 48000;
+static int nloads = 20;
+static unsigned int seed = 1;
+static int json = 0;
+
+static sq_session_t build_session(void);
+static void bench_format(sq_session_t, const char*, const char*);
+static unsigned long long now_ns(void);
+
+int main(int argc, char **argv) {
+
+    int opt;
+    char dir[] = "/tmp/bench-load-XXXXXX";
+    char path[64];
+    sq_session_t sesh;
+
+    while ((opt = getopt(argc, argv, "s:n:d:m:b:r:k:S:j")) != -1) {
+        switch (opt) {
+            case 's':
+                nseqs = atoi(optarg);
+                break;
+            case 'n':
+                nsteps = atoi(optarg);
+                break;
+            case 'd':
+                density = atof(optarg);
+                break;
+            case 'm':
+                muted = atof(optarg);
+                break;
+            case 'b':
+                bs = atoi(optarg);
+                break;
+            case 'r':
+                sr = atoi(optarg);
+                break;
+            case 'k':
+                nloads = atoi(optarg);
+                break;
+            case 'S':
+                seed = atoi(optarg);
+                break;
+            case 'j':
+                json = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s nseqs] [-n nsteps] [-d density] [-m muted] "
+                                "[-b bufsize] [-r rate] [-k loads] [-S seed] [-j]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (nloads < 1) {
+        fprintf(stderr, "need at least one load\n");
+        return 1;
+    }
+
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    if (!json) {
+        printf("format,nseqs,nsteps,density,muted,bytes,save_ms,load_ms,max_load_ms,"
+                "buffer_ms,buffers_per_load\n");
+    }
+
+    fakejack_set_params(sr, bs);
+    sesh = build_session();
+
+    for (int i=0; i<sizeof(formats)/sizeof(formats[0]); i++) {
+        snprintf(path, sizeof(path), "%s/session.%s", dir, formats[i]);
+        bench_format(sesh, formats[i], path);
+        unlink(path);
+    }
+
+    sq_session_delete_recursive(sesh);
+    rmdir(dir);
+
+    return 0;
+
+}
+
+static sq_session_t build_session(void) {
+
+    // random patterns, reproducible for a given seed
+
+    sq_session_t sesh;
+    sq_outport_t outport;
+    sq_sequence_t seq;
+    sq_trigger_t trig;
+    char name[32];
+
+    sesh = sq_session_new("bench");
+    outport = sq_outport_new("out");
+    sq_session_register_outport(sesh, outport);
+
+    srandom(seed);
+    trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    for (int i=0; i<nseqs; i++) {
+        seq = sq_sequence_new(nsteps);
+        snprintf(name, sizeof(name), "seq%d", i);
+        sq_sequence_set_name(seq, name);
+        sq_sequence_set_outport(seq, outport);
+        sq_sequence_set_mute(seq, i < muted * nseqs);
+        for (int step=0; step<nsteps; step++) {
+            if (((float) random()) / RAND_MAX < density) {
+                sq_trigger_set_note_value(trig, 36 + random() % 60);
+                sq_trigger_set_note_velocity(trig, 64 + random() % 64);
+                sq_sequence_set_trig(seq, step, trig);
+            }
+        }
+        sq_session_add_sequence(sesh, seq);
+    }
+    sq_trigger_delete(trig);
+
+    return sesh;
+
+}
+
+static void bench_format(sq_session_t sesh, const char *format, const char *path) {
+
+    sq_session_t loaded;
+    struct stat st;
+    unsigned long long t0, save_ns;
+    double load, total = 0., max = 0., period;
+
+    t0 = now_ns();
+    sq_session_save(sesh, path);
+    save_ns = now_ns() - t0;
+
+    if (stat(path, &st) < 0) {
+        perror(path);
+        return;
+    }
+
+    for (int i=0; i<nloads; i++) {
+        loaded = sq_session_load(path);
+        if (!loaded) {
+            fprintf(stderr, "failed to load %s\n", path);
+            return;
+        }
+        load = sq_session_get_load_time(loaded);
+        total += load;
+        if (load > max) max = load;
+        sq_session_delete_recursive(loaded);
+    }
+
+    period = (double) bs / sr;
+
+    if (json) {
+        printf("{\"format\": \"%s\", \"nseqs\": %d, \"nsteps\": %d, \"density\": %g, "
+                "\"muted\": %g, \"bytes\": %lld, \"save_ms\": %.3f, \"load_ms\": %.3f, \"max_load_ms\": %.3f, "
+                "\"buffer_ms\": %.3f, \"buffers_per_load\": %.3f}\n",
+                format, nseqs, nsteps, density, muted, (long long) st.st_size, save_ns * 1e-6,
+                total / nloads * 1e3, max * 1e3, period * 1e3, total / nloads / period);
+    } else {
+        printf("%s,%d,%d,%g,%g,%lld,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                format, nseqs, nsteps, density, muted, (long long) st.st_size, save_ns * 1e-6,
+                total / nloads * 1e3, max * 1e3, period * 1e3, total / nloads / period);
+    }
+    fflush(stdout);
+
+}
+
+static unsigned long long now_ns(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+}
@@ -0,0 +1,347 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+// microbenchmarks for the building blocks of the process callback:
+// midiEvent_sort, the offHeap free list, the control ringbuffers and the
+// buf_off note-off list append.
+//
+// usage: bench-micro [-b batches] [-S seed] [-j]
+//
+// each case is timed in batches; one result line is printed per case, with
+// the mean, p99 and p99.9 cost per operation over the batches, as CSV
+// (default) or as JSON lines (-j)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <jack/ringbuffer.h>
+
+#include "sequoia.h"
+#include "sequoia/midiEvent.h"
+#include "sequoia/offHeap.h"
+#include "sequoia/sequence.h"
+
+#define BENCH_WARMUP_BATCHES 10
+#define BENCH_OPS_PER_BATCH 1024
+#define BENCH_OFFHEAP_SIZE 4096
+#define BENCH_OFF_NSLOTS 1024
+
+enum order {ORDER_RANDOM, ORDER_NEARLY, ORDER_SORTED};
+
+static const char *order_names[] = {"random", "nearly", "sorted"};
+static const int sort_counts[] = {16, 64, 256, 1024, 4096};
+
+static int nbatches = 1000;
+static unsigned int seed = 1;
+static int json = 0;
+
+static void bench_sort(int, enum order);
+static void bench_offheap(int);
+static void bench_ringbuffer(int);
+static void bench_append(int, int);
+static void report(const char*, const char*, int, unsigned long long*, int);
+static void fill_events(midiEvent*, int, enum order);
+static int cmp_u64(const void*, const void*);
+static unsigned long long now_ns(void);
+
+static volatile unsigned long sink;    // keeps results alive
+
+int main(int argc, char **argv) {
+
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:S:j")) != -1) {
+        switch (opt) {
+            case 'b':
+                nbatches = atoi(optarg);
+                break;
+            case 'S':
+                seed = atoi(optarg);
+                break;
+            case 'j':
+                json = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-b batches] [-S seed] [-j]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (nbatches < 1) {
+        fprintf(stderr, "need at least one batch\n");
+        return 1;
+    }
+
+    if (!json) {
+        printf("case,variant,n,batches,ns_per_op,p99_ns_per_op,p999_ns_per_op,mops_per_s\n");
+    }
+
+    srandom(seed);
+
+    for (int i=0; i<sizeof(sort_counts)/sizeof(sort_counts[0]); i++) {
+        for (int j=ORDER_RANDOM; j<=ORDER_SORTED; j++) {
+            bench_sort(sort_counts[i], j);
+        }
+    }
+
+    bench_offheap(1);
+    bench_offheap(64);
+    bench_ringbuffer(1);
+    bench_ringbuffer(16);
+    bench_append(BENCH_OPS_PER_BATCH, BENCH_OFF_NSLOTS);  // spread over the slots
+    bench_append(BENCH_OPS_PER_BATCH, 16);  // deep chains, as with many simultaneous note-offs
+
+    return 0;
+
+}
+
+// sort n events per op, starting from the given pre-sortedness
+
+static void bench_sort(int n, enum order order) {
+
+    midiEvent *src, *mevs, *tmp;
+    unsigned long long *batch_ns, t0;
+    int nsorts;
+
+    src = malloc(n * sizeof(midiEvent));
+    mevs = malloc(n * sizeof(midiEvent));
+    tmp = malloc((n / 2) * sizeof(midiEvent));
+    batch_ns = malloc(nbatches * sizeof(unsigned long long));
+    fill_events(src, n, order);
+
+    // keep batches roughly the same length in events
+    nsorts = BENCH_OPS_PER_BATCH * 16 / n;
+    if (nsorts < 1) nsorts = 1;
+
+    for (int b=-BENCH_WARMUP_BATCHES; b<nbatches; b++) {
+        unsigned long long elapsed = 0;
+        for (int i=0; i<nsorts; i++) {
+            memcpy(mevs, src, n * sizeof(midiEvent));
+            t0 = now_ns();
+            midiEvent_sort(mevs, n, tmp);
+            elapsed += now_ns() - t0;
+            sink += mevs[0].time;
+        }
+        if (b >= 0) batch_ns[b] = elapsed;
+    }
+
+    report("sort", order_names[order], n, batch_ns, nsorts);
+
+    free(batch_ns);
+    free(tmp);
+    free(mevs);
+    free(src);
+
+}
+
+// alloc and free in bursts of the given depth, FIFO, as the note-offs are
+
+static void bench_offheap(int depth) {
+
+    offHeap_t *offHeap;
+    offNode_t *nodes[64];
+    unsigned long long *batch_ns, t0;
+    int nops = BENCH_OPS_PER_BATCH / depth;
+
+    offHeap = offHeap_new(BENCH_OFFHEAP_SIZE);
+    batch_ns = malloc(nbatches * sizeof(unsigned long long));
+
+    for (int b=-BENCH_WARMUP_BATCHES; b<nbatches; b++) {
+        t0 = now_ns();
+        for (int i=0; i<nops; i++) {
+            for (int k=0; k<depth; k++) {
+                nodes[k] = offHeap_alloc(offHeap);
+            }
+            for (int k=0; k<depth; k++) {
+                offHeap_free(offHeap, nodes[k]);
+            }
+        }
+        if (b >= 0) batch_ns[b] = now_ns() - t0;
+    }
+
+    // one op is an alloc/free pair
+    report("offheap", "churn", depth, batch_ns, nops * depth);
+
+    free(batch_ns);
+    offHeap_delete(offHeap);
+
+}
+
+// write then read bursts of sequence control messages, the way a setter
+// and sequence_serve_ctrl_msgs exchange them
+
+static void bench_ringbuffer(int depth) {
+
+    jack_ringbuffer_t *rb;
+    sequence_ctrl_msg_t msg = {.param = SEQUENCE_TRANSPOSE};
+    unsigned long long *batch_ns, t0;
+    int nops = BENCH_OPS_PER_BATCH / depth;
+
+    rb = jack_ringbuffer_create(32 * sizeof(sequence_ctrl_msg_t));
+    batch_ns = malloc(nbatches * sizeof(unsigned long long));
+
+    for (int b=-BENCH_WARMUP_BATCHES; b<nbatches; b++) {
+        t0 = now_ns();
+        for (int i=0; i<nops; i++) {
+            for (int k=0; k<depth; k++) {
+                msg.vi = k;
+                if (jack_ringbuffer_write_space(rb) >= sizeof(sequence_ctrl_msg_t)) {
+                    jack_ringbuffer_write(rb, (const char*) &msg, sizeof(sequence_ctrl_msg_t));
+                }
+            }
+            while (jack_ringbuffer_read_space(rb) >= sizeof(sequence_ctrl_msg_t)) {
+                jack_ringbuffer_read(rb, (char*) &msg, sizeof(sequence_ctrl_msg_t));
+                sink += msg.vi;
+            }
+        }
+        if (b >= 0) batch_ns[b] = now_ns() - t0;
+    }
+
+    // one op is a write/read pair
+    report("ringbuffer", "ctrl_msg", depth, batch_ns, nops * depth);
+
+    free(batch_ns);
+    jack_ringbuffer_free(rb);
+
+}
+
+// append n note-offs to a buf_off-style list array of nslots, then drain it
+
+static void bench_append(int n, int nslots) {
+
+    offHeap_t *offHeap;
+    offNode_t **buf_off, *offp;
+    int *slots;
+    unsigned long long *batch_ns, t0, elapsed;
+
+    offHeap = offHeap_new(n);
+    buf_off = calloc(nslots, sizeof(offNode_t*));
+    slots = malloc(n * sizeof(int));
+    batch_ns = malloc(nbatches * sizeof(unsigned long long));
+
+    for (int i=0; i<n; i++) {
+        slots[i] = random() % nslots;
+    }
+
+    for (int b=-BENCH_WARMUP_BATCHES; b<nbatches; b++) {
+        t0 = now_ns();
+        for (int i=0; i<n; i++) {
+            offp = offHeap_alloc(offHeap);
+            offNode_append(buf_off + slots[i], offp);
+        }
+        elapsed = now_ns() - t0;
+        // the drain is not part of the measurement
+        for (int s=0; s<nslots; s++) {
+            while (buf_off[s]) {
+                offp = buf_off[s];
+                buf_off[s] = offp->next;
+                offHeap_free(offHeap, offp);
+            }
+        }
+        if (b >= 0) batch_ns[b] = elapsed;
+    }
+
+    report("append", nslots < n ? "chained" : "spread", nslots, batch_ns, n);
+
+    free(batch_ns);
+    free(slots);
+    free(buf_off);
+    offHeap_delete(offHeap);
+
+}
+
+static void report(const char *name, const char *variant, int n, unsigned long long *batch_ns,
+                    int ops_per_batch) {
+
+    unsigned long long total = 0;
+    double mean, p99, p999;
+
+    for (int b=0; b<nbatches; b++) {
+        total += batch_ns[b];
+    }
+
+    qsort(batch_ns, nbatches, sizeof(unsigned long long), cmp_u64);
+    mean = (double) total / nbatches / ops_per_batch;
+    p99 = (double) batch_ns[(int) (0.99 * (nbatches - 1))] / ops_per_batch;
+    p999 = (double) batch_ns[(int) (0.999 * (nbatches - 1))] / ops_per_batch;
+
+    if (json) {
+        printf("{\"case\": \"%s\", \"variant\": \"%s\", \"n\": %d, \"batches\": %d, "
+                "\"ns_per_op\": %.2f, \"p99_ns_per_op\": %.2f, \"p999_ns_per_op\": %.2f, "
+                "\"mops_per_s\": %.3f}\n",
+                name, variant, n, nbatches, mean, p99, p999, mean > 0 ? 1e3 / mean : 0.);
+    } else {
+        printf("%s,%s,%d,%d,%.2f,%.2f,%.2f,%.3f\n",
+                name, variant, n, nbatches, mean, p99, p999, mean > 0 ? 1e3 / mean : 0.);
+    }
+    fflush(stdout);
+
+}
+
+// events spread over a 256-frame buffer; "nearly" sorted swaps a tenth of
+// neighbouring pairs, which is what the per-sequence chunks tend to produce
+
+static void fill_events(midiEvent *mevs, int n, enum order order) {
+
+    for (int i=0; i<n; i++) {
+        mevs[i] = MIDIEVENT_NULL;
+        mevs[i].type = MEV_TYPE_NOTEON;
+        mevs[i].status = 0x90;
+        mevs[i].data1 = 36 + random() % 60;
+        mevs[i].data2 = 100;
+        mevs[i].size = 3;
+        mevs[i].time = (order == ORDER_RANDOM) ? random() % 256 : (i * 256) / n;
+    }
+
+    if (order == ORDER_NEARLY) {
+        midiEvent tmp;
+        for (int i=0; i+1<n; i+=2) {
+            if (random() % 5 == 0) {
+                tmp = mevs[i];
+                mevs[i] = mevs[i+1];
+                mevs[i+1] = tmp;
+            }
+        }
+    }
+
+}
+
+static int cmp_u64(const void *a, const void *b) {
+
+    unsigned long long x = *(const unsigned long long*) a;
+    unsigned long long y = *(const unsigned long long*) b;
+
+    return (x > y) - (x < y);
+
+}
+
+static unsigned long long now_ns(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+}
+
@@ -0,0 +1,262 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+// drives the session process callback through fakejack, over a grid of
+// session sizes, and reports the cost per cycle and per event.
+//
+// usage: bench-session [-s nseqs,...] [-n nsteps,...] [-b bufsize,...]
+//                      [-d density] [-l minlen:maxlen] [-B bpm] [-r rate]
+//                      [-c cycles] [-S seed] [-a] [-H] [-j]
+//
+// -a carves the sequences from a session arena, -H from one in hugepages
+//
+// each comma-separated list is swept; one result line is printed per
+// combination, as CSV (default) or as JSON lines (-j)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "sequoia.h"
+#include "sequoia/sequence.h"
+#include "fakejack.h"
+
+#define BENCH_MAX_NVALUES 16
+#define BENCH_WARMUP_CYCLES 100
+
+typedef struct {
+
+    int values[BENCH_MAX_NVALUES];
+    int n;
+
+} int_list_t;
+
+static int_list_t nseqs_list = {{64}, 1};
+static int_list_t nsteps_list = {{16}, 1};
+static int_list_t bs_list = {{256}, 1};
+static float density = 0.25;
+static float len_min = 0.5, len_max = 0.5;
+static float bpm = 120;
+static int sr = 48000;
+static int ncycles = 10000;
+static unsigned int seed = 1;
+static int json = 0;
+static int arena = 0;  // 0 for malloc, 1 for an arena, 2 for hugepages
+
+static int parse_list(const char*, int_list_t*);
+static void bench_run(int, int, int);
+static int cmp_u64(const void*, const void*);
+static unsigned long long now_ns(void);
+
+int main(int argc, char **argv) {
+
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:n:b:d:l:B:r:c:S:aHj")) != -1) {
+        switch (opt) {
+            case 's':
+                if (parse_list(optarg, &nseqs_list)) return 1;
+                break;
+            case 'n':
+                if (parse_list(optarg, &nsteps_list)) return 1;
+                break;
+            case 'b':
+                if (parse_list(optarg, &bs_list)) return 1;
+                break;
+            case 'd':
+                density = atof(optarg);
+                break;
+            case 'l':
+                if (sscanf(optarg, "%f:%f", &len_min, &len_max) != 2) len_max = len_min;
+                break;
+            case 'B':
+                bpm = atof(optarg);
+                break;
+            case 'r':
+                sr = atoi(optarg);
+                break;
+            case 'c':
+                ncycles = atoi(optarg);
+                break;
+            case 'S':
+                seed = atoi(optarg);
+                break;
+            case 'a':
+                arena = 1;
+                break;
+            case 'H':
+                arena = 2;
+                break;
+            case 'j':
+                json = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s nseqs,...] [-n nsteps,...] [-b bufsize,...] "
+                                "[-d density] [-l minlen:maxlen] [-B bpm] [-r rate] "
+                                "[-c cycles] [-S seed] [-a] [-H] [-j]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!json) {
+        printf("nseqs,nsteps,bufsize,density,cycles,events,ns_per_cycle,p99_ns_per_cycle,"
+                "max_ns_per_cycle,ns_per_event,headroom,worst_headroom\n");
+    }
+
+    for (int i=0; i<nseqs_list.n; i++) {
+        for (int j=0; j<nsteps_list.n; j++) {
+            for (int k=0; k<bs_list.n; k++) {
+                bench_run(nseqs_list.values[i], nsteps_list.values[j], bs_list.values[k]);
+            }
+        }
+    }
+
+    return 0;
+
+}
+
+static void bench_run(int nseqs, int nsteps, int bs) {
+
+    sq_session_t sesh;
+    sq_outport_t outport;
+    sq_sequence_t seq;
+    sq_trigger_t trig;
+    struct sq_outport_stats stats;
+    unsigned long long *cycle_ns, t0, total = 0;
+    unsigned long events;
+    double period_ns, mean, p99, ns_per_event;
+
+    fakejack_set_params(sr, bs);
+
+    sesh = sq_session_new("bench");
+    sq_session_set_bpm(sesh, bpm);
+    outport = sq_outport_new("out");
+    sq_session_register_outport(sesh, outport);
+    if (arena) {
+        sq_session_init_arena(sesh, nseqs * sequence_arena_size(nsteps, nsteps, false), arena == 2);
+    }
+
+    // random patterns, reproducible for a given seed
+    srandom(seed);
+    trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    for (int i=0; i<nseqs; i++) {
+        seq = sq_session_new_sequence(sesh, nsteps);
+        sq_sequence_set_outport(seq, outport);
+        for (int step=0; step<nsteps; step++) {
+            if (((float) random()) / RAND_MAX < density) {
+                sq_trigger_set_note_value(trig, 36 + random() % 60);
+                sq_trigger_set_note_length(trig,
+                        len_min + (len_max - len_min) * ((float) random()) / RAND_MAX);
+                sq_sequence_set_trig(seq, step, trig);
+            }
+        }
+        sq_session_add_sequence(sesh, seq);
+    }
+    sq_trigger_delete(trig);
+
+    sq_session_start(sesh);
+    for (int i=0; i<BENCH_WARMUP_CYCLES; i++) {
+        fakejack_cycle();
+    }
+
+    sq_outport_get_stats(outport, &stats);
+    events = stats.events;
+
+    cycle_ns = malloc(ncycles * sizeof(unsigned long long));
+    for (int i=0; i<ncycles; i++) {
+        t0 = now_ns();
+        fakejack_cycle();
+        cycle_ns[i] = now_ns() - t0;
+        total += cycle_ns[i];
+    }
+
+    sq_outport_get_stats(outport, &stats);
+    events = stats.events - events;
+
+    qsort(cycle_ns, ncycles, sizeof(unsigned long long), cmp_u64);
+    period_ns = 1e9 * bs / sr;
+    mean = (double) total / ncycles;
+    p99 = cycle_ns[(int) (0.99 * (ncycles - 1))];
+    ns_per_event = events ? (double) total / events : 0.;
+
+    if (json) {
+        printf("{\"nseqs\": %d, \"nsteps\": %d, \"bufsize\": %d, \"density\": %g, "
+                "\"cycles\": %d, \"events\": %lu, \"ns_per_cycle\": %.1f, "
+                "\"p99_ns_per_cycle\": %.1f, \"max_ns_per_cycle\": %llu, "
+                "\"ns_per_event\": %.1f, \"headroom\": %.4f, \"worst_headroom\": %.4f}\n",
+                nseqs, nsteps, bs, density, ncycles, events, mean, p99,
+                cycle_ns[ncycles - 1], ns_per_event, 1. - mean / period_ns,
+                1. - cycle_ns[ncycles - 1] / period_ns);
+    } else {
+        printf("%d,%d,%d,%g,%d,%lu,%.1f,%.1f,%llu,%.1f,%.4f,%.4f\n",
+                nseqs, nsteps, bs, density, ncycles, events, mean, p99,
+                cycle_ns[ncycles - 1], ns_per_event, 1. - mean / period_ns,
+                1. - cycle_ns[ncycles - 1] / period_ns);
+    }
+    fflush(stdout);
+
+    free(cycle_ns);
+    sq_session_delete_recursive(sesh);
+
+}
+
+static int parse_list(const char *arg, int_list_t *list) {
+
+    char *end;
+
+    list->n = 0;
+    while (*arg) {
+        if (list->n == BENCH_MAX_NVALUES) {
+            fprintf(stderr, "too many values: %s\n", arg);
+            return 1;
+        }
+        list->values[list->n++] = strtol(arg, &end, 10);
+        if (end == arg) {
+            fprintf(stderr, "bad value: %s\n", arg);
+            return 1;
+        }
+        arg = (*end == ',') ? end + 1 : end;
+    }
+
+    return 0;
+
+}
+
+static int cmp_u64(const void *a, const void *b) {
+
+    unsigned long long x = *(const unsigned long long*) a;
+    unsigned long long y = *(const unsigned long long*) b;
+
+    return (x > y) - (x < y);
+
+}
+
+static unsigned long long now_ns(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+}
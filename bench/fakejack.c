@@ -0,0 +1,526 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/ringbuffer.h>
+
+#include "fakejack.h"
+
+// LOCAL DECLARATIONS
+
+#define FAKEJACK_MAX_NCLIENTS 16
+#define FAKEJACK_MAX_NPORTS 64
+#define FAKEJACK_MAX_NAME_LEN 255
+#define FAKEJACK_MIDI_MAX_NEVENTS 4096
+#define FAKEJACK_MIDI_MAX_EVENT_SIZE 4
+
+typedef struct {
+
+    jack_nframes_t time;
+    size_t size;
+    jack_midi_data_t data[FAKEJACK_MIDI_MAX_EVENT_SIZE];
+
+} fake_midi_event_t;
+
+typedef struct {
+
+    fake_midi_event_t events[FAKEJACK_MIDI_MAX_NEVENTS];
+    uint32_t nevents;
+
+} fake_midi_buffer_t;
+
+struct _jack_port {
+
+    char name[FAKEJACK_MAX_NAME_LEN + 1];
+    unsigned long flags;
+    jack_client_t *client;
+    fake_midi_buffer_t buf;     // what the client reads or writes this cycle
+    fake_midi_buffer_t next;    // injected input, for the next cycle
+
+};
+
+struct _jack_client {
+
+    char name[FAKEJACK_MAX_NAME_LEN + 1];
+    JackProcessCallback process;
+    void *process_arg;
+    bool active;
+
+};
+
+static jack_nframes_t fake_sr = FAKEJACK_DEFAULT_SR;
+static jack_nframes_t fake_bs = FAKEJACK_DEFAULT_BS;
+static jack_client_t *fake_clients[FAKEJACK_MAX_NCLIENTS];
+static jack_port_t *fake_ports[FAKEJACK_MAX_NPORTS];
+static unsigned long long fake_ncycles;
+
+static pthread_t fake_thread;
+static bool fake_running;
+static double fake_speedup;
+static void (*fake_hook)(void*);
+static void *fake_hook_arg;
+
+static void fake_copy_name(char*, const char*);
+static void *fake_thread_main(void*);
+
+// FAKEJACK CODE
+
+void fakejack_set_params(jack_nframes_t sr, jack_nframes_t bs) {
+
+    fake_sr = sr;
+    fake_bs = bs;
+
+}
+
+void fakejack_cycle(void) {
+
+    jack_port_t *port;
+    jack_client_t *client;
+
+    // deliver the injected input
+    for (int i=0; i<FAKEJACK_MAX_NPORTS; i++) {
+        port = fake_ports[i];
+        if (port && (port->flags & JackPortIsInput)) {
+            port->buf = port->next;
+            port->next.nevents = 0;
+        }
+    }
+
+    for (int i=0; i<FAKEJACK_MAX_NCLIENTS; i++) {
+        client = fake_clients[i];
+        if (client && client->active && client->process) {
+            client->process(fake_bs, client->process_arg);
+        }
+    }
+
+    __atomic_add_fetch(&fake_ncycles, 1, __ATOMIC_RELEASE);
+
+}
+
+int fakejack_start(double speedup, void (*hook)(void*), void *arg) {
+
+    if (fake_running) return -1;
+
+    fake_speedup = speedup;
+    fake_hook = hook;
+    fake_hook_arg = arg;
+    __atomic_store_n(&fake_running, true, __ATOMIC_RELEASE);
+
+    if (pthread_create(&fake_thread, NULL, fake_thread_main, NULL)) {
+        fake_running = false;
+        return -1;
+    }
+
+    return 0;
+
+}
+
+void fakejack_stop(void) {
+
+    if (!fake_running) return;
+
+    __atomic_store_n(&fake_running, false, __ATOMIC_RELEASE);
+    pthread_join(fake_thread, NULL);
+
+}
+
+unsigned long long fakejack_get_ncycles(void) {
+
+    return __atomic_load_n(&fake_ncycles, __ATOMIC_ACQUIRE);
+
+}
+
+jack_port_t *fakejack_get_port(const char *name) {
+
+    for (int i=0; i<FAKEJACK_MAX_NPORTS; i++) {
+        if (fake_ports[i] && (strcmp(fake_ports[i]->name, name) == 0)) {
+            return fake_ports[i];
+        }
+    }
+
+    return NULL;
+
+}
+
+int fakejack_inject(jack_port_t *port, jack_nframes_t time, const jack_midi_data_t *data,
+                        size_t size) {
+
+    fake_midi_event_t *ev;
+
+    if ((port->next.nevents == FAKEJACK_MIDI_MAX_NEVENTS) || (size > FAKEJACK_MIDI_MAX_EVENT_SIZE)
+            || (time >= fake_bs)) {
+        return -1;
+    }
+
+    ev = port->next.events + port->next.nevents++;
+    ev->time = time;
+    ev->size = size;
+    memcpy(ev->data, data, size);
+
+    return 0;
+
+}
+
+// CLIENT AND PORT API
+
+jack_client_t *jack_client_open(const char *name, jack_options_t options,
+                                    jack_status_t *status, ...) {
+
+    jack_client_t *client;
+
+    for (int i=0; i<FAKEJACK_MAX_NCLIENTS; i++) {
+        if (!fake_clients[i]) {
+            client = calloc(1, sizeof(jack_client_t));
+            fake_copy_name(client->name, name);
+            fake_clients[i] = client;
+            return client;
+        }
+    }
+
+    return NULL;
+
+}
+
+int jack_client_close(jack_client_t *client) {
+
+    for (int i=0; i<FAKEJACK_MAX_NPORTS; i++) {
+        if (fake_ports[i] && (fake_ports[i]->client == client)) {
+            free(fake_ports[i]);
+            fake_ports[i] = NULL;
+        }
+    }
+
+    for (int i=0; i<FAKEJACK_MAX_NCLIENTS; i++) {
+        if (fake_clients[i] == client) {
+            fake_clients[i] = NULL;
+        }
+    }
+
+    free(client);
+
+    return 0;
+
+}
+
+jack_nframes_t jack_get_sample_rate(jack_client_t *client) {
+
+    return fake_sr;
+
+}
+
+jack_nframes_t jack_get_buffer_size(jack_client_t *client) {
+
+    return fake_bs;
+
+}
+
+int jack_set_process_callback(jack_client_t *client, JackProcessCallback process, void *arg) {
+
+    client->process = process;
+    client->process_arg = arg;
+
+    return 0;
+
+}
+
+int jack_activate(jack_client_t *client) {
+
+    client->active = true;
+
+    return 0;
+
+}
+
+char *jack_get_client_name(jack_client_t *client) {
+
+    return client->name;
+
+}
+
+jack_port_t *jack_port_register(jack_client_t *client, const char *name, const char *type,
+                                    unsigned long flags, unsigned long buffer_size) {
+
+    jack_port_t *port;
+
+    for (int i=0; i<FAKEJACK_MAX_NPORTS; i++) {
+        if (!fake_ports[i]) {
+            port = calloc(1, sizeof(jack_port_t));
+            fake_copy_name(port->name, name);
+            port->flags = flags;
+            port->client = client;
+            fake_ports[i] = port;
+            return port;
+        }
+    }
+
+    return NULL;
+
+}
+
+int jack_port_rename(jack_client_t *client, jack_port_t *port, const char *name) {
+
+    fake_copy_name(port->name, name);
+
+    return 0;
+
+}
+
+void *jack_port_get_buffer(jack_port_t *port, jack_nframes_t nframes) {
+
+    return &port->buf;
+
+}
+
+// MIDI API
+
+uint32_t jack_midi_get_event_count(void *port_buffer) {
+
+    return ((fake_midi_buffer_t*) port_buffer)->nevents;
+
+}
+
+int jack_midi_event_get(jack_midi_event_t *event, void *port_buffer, uint32_t index) {
+
+    fake_midi_buffer_t *buf = port_buffer;
+
+    if (index >= buf->nevents) return -1;
+
+    event->time = buf->events[index].time;
+    event->size = buf->events[index].size;
+    event->buffer = buf->events[index].data;
+
+    return 0;
+
+}
+
+void jack_midi_clear_buffer(void *port_buffer) {
+
+    ((fake_midi_buffer_t*) port_buffer)->nevents = 0;
+
+}
+
+jack_midi_data_t *jack_midi_event_reserve(void *port_buffer, jack_nframes_t time,
+                                            size_t data_size) {
+
+    // like JACK, events must be reserved in time order, and the buffer can fill up
+
+    fake_midi_buffer_t *buf = port_buffer;
+    fake_midi_event_t *ev;
+
+    if ((buf->nevents == FAKEJACK_MIDI_MAX_NEVENTS) || (data_size > FAKEJACK_MIDI_MAX_EVENT_SIZE)
+            || (time >= fake_bs)) {
+        return NULL;
+    }
+
+    if (buf->nevents && (time < buf->events[buf->nevents - 1].time)) {
+        return NULL;
+    }
+
+    ev = buf->events + buf->nevents++;
+    ev->time = time;
+    ev->size = data_size;
+
+    return ev->data;
+
+}
+
+int jack_midi_event_write(void *port_buffer, jack_nframes_t time,
+                            const jack_midi_data_t *data, size_t data_size) {
+
+    jack_midi_data_t *dest = jack_midi_event_reserve(port_buffer, time, data_size);
+
+    if (!dest) return -1;
+    memcpy(dest, data, data_size);
+
+    return 0;
+
+}
+
+// RINGBUFFER API (single reader, single writer, same algorithm as JACK)
+
+jack_ringbuffer_t *jack_ringbuffer_create(size_t sz) {
+
+    jack_ringbuffer_t *rb;
+    int power_of_two;
+
+    for (power_of_two = 1; (1 << power_of_two) < sz; power_of_two++);
+
+    rb = calloc(1, sizeof(jack_ringbuffer_t));
+    rb->size = 1 << power_of_two;
+    rb->size_mask = rb->size - 1;
+    rb->buf = malloc(rb->size);
+
+    return rb;
+
+}
+
+void jack_ringbuffer_free(jack_ringbuffer_t *rb) {
+
+    free(rb->buf);
+    free(rb);
+
+}
+
+int jack_ringbuffer_mlock(jack_ringbuffer_t *rb) {
+
+    rb->mlocked = 1;
+
+    return 0;
+
+}
+
+void jack_ringbuffer_reset(jack_ringbuffer_t *rb) {
+
+    rb->read_ptr = 0;
+    rb->write_ptr = 0;
+
+}
+
+size_t jack_ringbuffer_read_space(const jack_ringbuffer_t *rb) {
+
+    size_t w = __atomic_load_n(&rb->write_ptr, __ATOMIC_ACQUIRE);
+    size_t r = __atomic_load_n(&rb->read_ptr, __ATOMIC_ACQUIRE);
+
+    return (w - r) & rb->size_mask;
+
+}
+
+size_t jack_ringbuffer_write_space(const jack_ringbuffer_t *rb) {
+
+    size_t w = __atomic_load_n(&rb->write_ptr, __ATOMIC_ACQUIRE);
+    size_t r = __atomic_load_n(&rb->read_ptr, __ATOMIC_ACQUIRE);
+
+    return ((r - w - 1) & rb->size_mask);
+
+}
+
+size_t jack_ringbuffer_peek(jack_ringbuffer_t *rb, char *dest, size_t cnt) {
+
+    size_t avail = jack_ringbuffer_read_space(rb);
+    size_t r = rb->read_ptr;
+    size_t n1, n2;
+
+    if (cnt > avail) cnt = avail;
+
+    n1 = rb->size - r;
+    if (n1 > cnt) n1 = cnt;
+    n2 = cnt - n1;
+
+    memcpy(dest, rb->buf + r, n1);
+    memcpy(dest + n1, rb->buf, n2);
+
+    return cnt;
+
+}
+
+void jack_ringbuffer_read_advance(jack_ringbuffer_t *rb, size_t cnt) {
+
+    __atomic_store_n(&rb->read_ptr, (rb->read_ptr + cnt) & rb->size_mask, __ATOMIC_RELEASE);
+
+}
+
+size_t jack_ringbuffer_read(jack_ringbuffer_t *rb, char *dest, size_t cnt) {
+
+    cnt = jack_ringbuffer_peek(rb, dest, cnt);
+    jack_ringbuffer_read_advance(rb, cnt);
+
+    return cnt;
+
+}
+
+void jack_ringbuffer_write_advance(jack_ringbuffer_t *rb, size_t cnt) {
+
+    __atomic_store_n(&rb->write_ptr, (rb->write_ptr + cnt) & rb->size_mask, __ATOMIC_RELEASE);
+
+}
+
+size_t jack_ringbuffer_write(jack_ringbuffer_t *rb, const char *src, size_t cnt) {
+
+    size_t avail = jack_ringbuffer_write_space(rb);
+    size_t w = rb->write_ptr;
+    size_t n1, n2;
+
+    if (cnt > avail) cnt = avail;
+
+    n1 = rb->size - w;
+    if (n1 > cnt) n1 = cnt;
+    n2 = cnt - n1;
+
+    memcpy(rb->buf + w, src, n1);
+    memcpy(rb->buf, src + n1, n2);
+    jack_ringbuffer_write_advance(rb, cnt);
+
+    return cnt;
+
+}
+
+// LOCAL CODE
+
+static void *fake_thread_main(void *arg) {
+
+    struct timespec deadline, now;
+    long long period_ns = 0;
+
+    if (fake_speedup > 0) {
+        period_ns = (long long) (1e9 * fake_bs / fake_sr / fake_speedup);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    while (__atomic_load_n(&fake_running, __ATOMIC_ACQUIRE)) {
+
+        fakejack_cycle();
+        if (fake_hook) fake_hook(fake_hook_arg);
+
+        // absolute deadlines, so that late cycles are caught up on rather than
+        // stretching the timeline. at high speedups the period is shorter than
+        // the timer slack, so only sleep when ahead
+        if (period_ns) {
+            deadline.tv_nsec += period_ns;
+            while (deadline.tv_nsec >= 1000000000) {
+                deadline.tv_nsec -= 1000000000;
+                deadline.tv_sec++;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if ((now.tv_sec < deadline.tv_sec)
+                    || ((now.tv_sec == deadline.tv_sec) && (now.tv_nsec < deadline.tv_nsec))) {
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+            }
+        }
+
+    }
+
+    return NULL;
+
+}
+
+static void fake_copy_name(char *dest, const char *src) {
+
+    strncpy(dest, src, FAKEJACK_MAX_NAME_LEN);
+    dest[FAKEJACK_MAX_NAME_LEN] = '\0';
+
+}
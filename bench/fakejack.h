@@ -0,0 +1,58 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef FAKEJACK_H
+#define FAKEJACK_H
+
+// fakejack is an in-process stand-in for libjack. programs that link it
+// instead of -ljack drive the library's process callback themselves, with
+// no server, no audio hardware and no realtime scheduling
+
+#include <stdbool.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+
+#define FAKEJACK_DEFAULT_SR 48000
+#define FAKEJACK_DEFAULT_BS 256
+
+// server parameters, for clients opened after this call
+void fakejack_set_params(jack_nframes_t, jack_nframes_t);
+
+// runs one process cycle of every active client
+void fakejack_cycle(void);
+
+// runs process cycles on a thread of their own, paced at the given multiple
+// of realtime (or as fast as possible, for 0), until fakejack_stop. the hook,
+// if any, is called on that thread after each cycle. blocking setters only
+// return while cycles are running, so long-running programs use this mode
+int fakejack_start(double, void (*)(void*), void*);
+void fakejack_stop(void);
+
+// number of cycles run so far, in either mode
+unsigned long long fakejack_get_ncycles(void);
+
+// looks up a port by its short name, across all clients
+jack_port_t *fakejack_get_port(const char*);
+
+// queues a MIDI event on an input port, for the next cycle only
+int fakejack_inject(jack_port_t*, jack_nframes_t, const jack_midi_data_t*, size_t);
+
+#endif
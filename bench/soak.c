@@ -0,0 +1,575 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+// accelerated soak test. plays a session through fakejack, faster than
+// realtime, for a long stretch of simulated time, while randomly editing
+// patterns, BPM, clock divides, motion, mutes and loop points.
+//
+// usage: soak [-t hours] [-x speedup] [-s nseqs] [-b bufsize] [-r rate]
+//             [-i interval_ms] [-m max_rss_growth_mb] [-S seed]
+//
+// it watches for:
+//  - leaked note-off nodes: offHeap nodes in use that are not linked into
+//    the note-off buffer, and any still in use once playback has drained
+//  - stuck notes: note-on/note-off balance per channel and note, which must
+//    never go negative and must come back to zero after stopping
+//  - drift: a reference sequence fires every step, and at a steady tempo
+//    each one must land exactly fps frames (the library's rounded fps) after
+//    the one before; across a tempo change, within loose bounds. its
+//    notes last TRIG_MAX_LENGTH steps, and each note-off must land exactly
+//    that long after its note-on
+//  - RSS growth beyond a limit, after the first simulated hour
+//
+// the exit status is nonzero if any check failed
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "sequoia/trigger.h"
+#include "fakejack.h"
+
+#define SOAK_NOUTPORTS 4
+#define SOAK_REF_NSTEPS 32
+#define SOAK_REF_NOTE 40
+#define SOAK_REF_MAX_PENDING 8  // notes can overlap themselves after a big tempo jump
+#define SOAK_MIN_BPM 40
+#define SOAK_MAX_BPM 240
+#define SOAK_LINK_CHECK_CYCLES 10000
+#define SOAK_MAX_NERRORS 10     // per check, printed before going quiet
+
+typedef struct {
+
+    sq_session_t sesh;
+    jack_port_t *ref_port;
+    jack_port_t *ports[SOAK_NOUTPORTS];
+    unsigned long long ncycles;
+
+    // note balance, over all outports but the reference
+    long balance[16][128];
+    unsigned long long nnoteons, nnoteoffs;
+    unsigned long nnegative;
+
+    // reference clock
+    jack_nframes_t fps;
+    unsigned long long fps_changed;     // frame at which fps last changed
+    jack_nframes_t fps_min, fps_max;    // over the cycles since the last tick
+    unsigned long long last_tick;
+    bool have_tick;
+    unsigned long long ref_off[128][SOAK_REF_MAX_PENDING];  // when the note-offs are due
+    int ref_npending[128];
+    unsigned long long nticks;
+    unsigned long ntick_errors, nlength_errors;
+    long max_tick_error, max_length_error;
+
+    // offHeap
+    size_t offheap_peak;
+    unsigned long nlink_errors;
+
+} soak_state_t;
+
+static double hours = 24;
+static double speedup = 1000;
+static int nseqs = 16;
+static int bs = 256;
+static int sr = 48000;
+static double interval_ms = 250;
+static double max_rss_growth_mb = 8;
+static unsigned int seed = 1;
+
+static void soak_hook(void*);
+static void soak_check_links(soak_state_t*);
+static void soak_mutate(soak_state_t*, sq_sequence_t*, sq_outport_t*);
+static void soak_random_trig(sq_trigger_t);
+static void wait_for_cycles(unsigned long long);
+static long rss_kb(void);
+static double frand(void);
+
+int main(int argc, char **argv) {
+
+    int opt;
+    soak_state_t *state;
+    sq_session_t sesh;
+    sq_outport_t ref_outport, outports[SOAK_NOUTPORTS];
+    sq_sequence_t ref_seq, *seqs;
+    sq_trigger_t trig;
+    unsigned long long total_cycles, cycles_per_hour, cycles_per_mutation, next_mutation;
+    unsigned long long drain_cycles;
+    unsigned long nmutations = 0, nstuck = 0;
+    long rss_base = 0, rss_now, rss_max = 0;
+    struct sq_session_stats sstats;
+    struct sq_outport_stats ostats;
+    unsigned long reserve_fails = 0;
+    struct timespec ts0, ts1;
+    double wall;
+    char name[16];
+    int failed = 0;
+
+    while ((opt = getopt(argc, argv, "t:x:s:b:r:i:m:S:")) != -1) {
+        switch (opt) {
+            case 't':
+                hours = atof(optarg);
+                break;
+            case 'x':
+                speedup = atof(optarg);
+                break;
+            case 's':
+                nseqs = atoi(optarg);
+                break;
+            case 'b':
+                bs = atoi(optarg);
+                break;
+            case 'r':
+                sr = atoi(optarg);
+                break;
+            case 'i':
+                interval_ms = atof(optarg);
+                break;
+            case 'm':
+                max_rss_growth_mb = atof(optarg);
+                break;
+            case 'S':
+                seed = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-t hours] [-x speedup] [-s nseqs] [-b bufsize] "
+                                "[-r rate] [-i interval_ms] [-m max_rss_growth_mb] "
+                                "[-S seed]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if ((nseqs < 1) || (nseqs >= SESSION_MAX_NSEQ) || (bs < 1) || (sr < 1) || (hours <= 0)) {
+        fprintf(stderr, "bad parameters\n");
+        return 1;
+    }
+
+    srandom(seed);
+    fakejack_set_params(sr, bs);
+
+    state = calloc(1, sizeof(soak_state_t));
+    seqs = malloc(nseqs * sizeof(sq_sequence_t));
+
+    sesh = sq_session_new("soak");
+    state->sesh = sesh;
+
+    ref_outport = sq_outport_new("ref");
+    sq_session_register_outport(sesh, ref_outport);
+    state->ref_port = fakejack_get_port("ref");
+    for (int i=0; i<SOAK_NOUTPORTS; i++) {
+        sprintf(name, "out%d", i);
+        outports[i] = sq_outport_new(name);
+        sq_session_register_outport(sesh, outports[i]);
+        state->ports[i] = fakejack_get_port(name);
+    }
+
+    // the reference sequence fires a distinct note on every step, each as
+    // long as a note can be, and is never edited
+    trig = sq_trigger_new();
+    ref_seq = sq_sequence_new(SOAK_REF_NSTEPS);
+    sq_sequence_set_outport(ref_seq, ref_outport);
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_trigger_set_note_length(trig, TRIG_MAX_LENGTH);
+    for (int step=0; step<SOAK_REF_NSTEPS; step++) {
+        sq_trigger_set_note_value(trig, SOAK_REF_NOTE + step);
+        sq_sequence_set_trig(ref_seq, step, trig);
+    }
+    sq_session_add_sequence(sesh, ref_seq);
+
+    for (int i=0; i<nseqs; i++) {
+        seqs[i] = sq_sequence_new(8 * (1 + random() % 8));
+        sq_sequence_set_outport(seqs[i], outports[random() % SOAK_NOUTPORTS]);
+        for (int step=0; step<sq_sequence_get_nsteps(seqs[i]); step++) {
+            soak_random_trig(trig);
+            sq_sequence_set_trig(seqs[i], step, trig);
+        }
+        sq_session_add_sequence(sesh, seqs[i]);
+    }
+    sq_trigger_delete(trig);
+
+    total_cycles = (unsigned long long) (hours * 3600 * sr / bs);
+    cycles_per_hour = (unsigned long long) (3600. * sr / bs);
+    cycles_per_mutation = (unsigned long long) (interval_ms * sr / bs / 1000);
+    if (cycles_per_mutation < 1) cycles_per_mutation = 1;
+    // long enough for the longest note at the slowest tempo to end
+    drain_cycles = (unsigned long long) (TRIG_MAX_LENGTH * 60. * sr / (SOAK_MIN_BPM * 4) / bs) + 2;
+
+    printf("soak: %g hours at %gx, %d sequences, bufsize %d, rate %d, seed %u\n",
+            hours, speedup, nseqs, bs, sr, seed);
+    fflush(stdout);
+
+    clock_gettime(CLOCK_MONOTONIC, &ts0);
+
+    sq_session_start(sesh);
+    if (fakejack_start(speedup, soak_hook, state)) {
+        fprintf(stderr, "failed to start the process thread\n");
+        return 1;
+    }
+
+    // edits happen on this thread, like from a UI; the setters wait for the
+    // process thread to pick them up
+    next_mutation = cycles_per_mutation;
+    while (fakejack_get_ncycles() < total_cycles) {
+
+        wait_for_cycles(next_mutation);
+        soak_mutate(state, seqs, outports);
+        nmutations++;
+        next_mutation = fakejack_get_ncycles() + cycles_per_mutation;
+
+        // RSS, after the first hour or the first tenth of the run
+        if (!rss_base && (fakejack_get_ncycles() >= cycles_per_hour
+                            || fakejack_get_ncycles() >= total_cycles / 10)) {
+            rss_base = rss_kb();
+        }
+        rss_now = rss_kb();
+        if (rss_now > rss_max) rss_max = rss_now;
+
+    }
+
+    // stop, and let every scheduled note-off come out
+    sq_session_stop(sesh);
+    wait_for_cycles(fakejack_get_ncycles() + drain_cycles);
+    fakejack_stop();
+
+    clock_gettime(CLOCK_MONOTONIC, &ts1);
+    wall = (ts1.tv_sec - ts0.tv_sec) + 1e-9 * (ts1.tv_nsec - ts0.tv_nsec);
+
+    // final checks, with the process thread gone
+    soak_check_links(state);
+    for (int ch=0; ch<16; ch++) {
+        for (int note=0; note<128; note++) {
+            if (state->balance[ch][note]) {
+                if (nstuck < SOAK_MAX_NERRORS) {
+                    fprintf(stderr, "stuck note: channel %d, note %d, balance %ld\n",
+                            ch + 1, note, state->balance[ch][note]);
+                }
+                nstuck++;
+            }
+        }
+    }
+    for (int note=0; note<128; note++) {
+        nstuck += state->ref_npending[note];
+    }
+
+    sq_session_get_stats(sesh, &sstats);
+    for (int i=0; i<SOAK_NOUTPORTS; i++) {
+        sq_outport_get_stats(outports[i], &ostats);
+        reserve_fails += ostats.reserve_fails;
+    }
+    sq_outport_get_stats(ref_outport, &ostats);
+    reserve_fails += ostats.reserve_fails;
+
+    printf("simulated: %.2f hours in %.1f s (%.0fx)\n",
+            state->ncycles * (double) bs / sr / 3600, wall,
+            state->ncycles * (double) bs / sr / wall);
+    printf("mutations: %lu\n", nmutations);
+    printf("notes: %llu on, %llu off (%lu note-offs scheduled, %lu delivered)\n",
+            state->nnoteons, state->nnoteoffs, (unsigned long) sstats.noteoffs_scheduled,
+            (unsigned long) sstats.noteoffs_delivered);
+    printf("offheap: peak %zu of %zu, %zd in use at exit\n", state->offheap_peak,
+            sesh->offHeap->n, (ssize_t) sesh->offHeap->n - sesh->offHeap->savail);
+    printf("ref: %llu steps, max step error %ld frames, max note length error %ld frames\n",
+            state->nticks, state->max_tick_error, state->max_length_error);
+    printf("rss: %ld kB at baseline, %ld kB max\n", rss_base, rss_max);
+    printf("dropped: %lu offheap, %lu mevs, %lu reserve\n",
+            (unsigned long) sstats.offheap_exhausted, (unsigned long) sstats.mevs_dropped,
+            reserve_fails);
+
+    if (state->nlink_errors || (sesh->offHeap->savail != sesh->offHeap->n)) {
+        printf("FAIL: leaked note-off nodes\n");
+        failed = 1;
+    }
+    if (nstuck || state->nnegative) {
+        printf("FAIL: %lu stuck notes, %lu unmatched note-offs\n", nstuck, state->nnegative);
+        failed = 1;
+    }
+    if (state->ntick_errors || state->nlength_errors) {
+        printf("FAIL: drift: %lu step errors, %lu note length errors\n",
+                state->ntick_errors, state->nlength_errors);
+        failed = 1;
+    }
+    if (rss_base && (rss_max - rss_base > max_rss_growth_mb * 1024)) {
+        printf("FAIL: RSS grew by %ld kB\n", rss_max - rss_base);
+        failed = 1;
+    }
+    if (sstats.offheap_exhausted || sstats.mevs_dropped || reserve_fails) {
+        printf("FAIL: events dropped\n");
+        failed = 1;
+    }
+    if (!failed) printf("PASS\n");
+
+    sq_session_delete_recursive(sesh);
+    free(seqs);
+    free(state);
+
+    return failed;
+
+}
+
+// runs on the process thread, after each cycle
+
+static void soak_hook(void *arg) {
+
+    soak_state_t *state = arg;
+    sq_session_t sesh = state->sesh;
+    jack_midi_event_t ev;
+    void *buf;
+    unsigned long long t, interval, lo, hi;
+    unsigned char status, note;
+    long err;
+    int k;
+    size_t used;
+
+    if (sesh->fps != state->fps) {
+        state->fps = sesh->fps;
+        state->fps_changed = state->ncycles * bs;
+    }
+    if (sesh->fps < state->fps_min) state->fps_min = sesh->fps;
+    if (sesh->fps > state->fps_max) state->fps_max = sesh->fps;
+
+    // balance
+    for (int i=0; i<SOAK_NOUTPORTS; i++) {
+        buf = jack_port_get_buffer(state->ports[i], bs);
+        for (uint32_t j=0; j<jack_midi_get_event_count(buf); j++) {
+            jack_midi_event_get(&ev, buf, j);
+            status = ev.buffer[0] & 0xF0;
+            if (status == 0x90) {
+                state->balance[ev.buffer[0] & 0x0F][ev.buffer[1]]++;
+                state->nnoteons++;
+            } else if (status == 0x80) {
+                if (--state->balance[ev.buffer[0] & 0x0F][ev.buffer[1]] < 0) {
+                    state->nnegative++;
+                    state->balance[ev.buffer[0] & 0x0F][ev.buffer[1]] = 0;
+                }
+                state->nnoteoffs++;
+            }
+        }
+    }
+
+    // reference clock
+    buf = jack_port_get_buffer(state->ref_port, bs);
+    for (uint32_t j=0; j<jack_midi_get_event_count(buf); j++) {
+        jack_midi_event_get(&ev, buf, j);
+        t = state->ncycles * bs + ev.time;
+        status = ev.buffer[0] & 0xF0;
+        note = ev.buffer[1];
+        if (status == 0x90) {
+            if (state->have_tick) {
+                // once the tempo has been steady for a whole step, trigs land
+                // exactly fps frames apart. a tempo change moves the trig point
+                // within the step, and can cut a step short before its trig
+                // (which is then lost), so across one the bounds are loose
+                interval = t - state->last_tick;
+                if (state->last_tick >= state->fps_changed + state->fps_max) {
+                    lo = hi = state->fps;
+                } else {
+                    lo = state->fps_min / 2;
+                    hi = 2 * state->fps_max;
+                }
+                err = 0;
+                if (interval < lo) {
+                    err = (long) interval - (long) lo;
+                } else if (interval > hi) {
+                    err = (long) interval - (long) hi;
+                }
+                if (err) {
+                    if (state->ntick_errors < SOAK_MAX_NERRORS) {
+                        fprintf(stderr, "step at frame %llu is %ld frames off (fps %u to %u)\n",
+                                t, err, state->fps_min, state->fps_max);
+                    }
+                    state->ntick_errors++;
+                    if (labs(err) > state->max_tick_error) state->max_tick_error = labs(err);
+                }
+            }
+            state->last_tick = t;
+            state->have_tick = true;
+            state->fps_min = state->fps_max = sesh->fps;
+            state->nticks++;
+            if (state->ref_npending[note] == SOAK_REF_MAX_PENDING) {
+                state->nlength_errors++;
+                continue;
+            }
+            state->ref_off[note][state->ref_npending[note]++] =
+                t + (jack_nframes_t) (TRIG_MAX_LENGTH * sesh->fps);
+        } else if (status == 0x80) {
+            if (!state->ref_npending[note]) {
+                state->nnegative++;
+                continue;
+            }
+            // match the note-on this one was due for, if any, else the oldest
+            k = 0;
+            for (int i=0; i<state->ref_npending[note]; i++) {
+                if (state->ref_off[note][i] == t) k = i;
+            }
+            err = (long) (t - state->ref_off[note][k]);
+            if (err) {
+                if (state->nlength_errors < SOAK_MAX_NERRORS) {
+                    fprintf(stderr, "note-off at frame %llu is %ld frames off\n", t, err);
+                }
+                state->nlength_errors++;
+                if (labs(err) > state->max_length_error) state->max_length_error = labs(err);
+            }
+            for (int i=k+1; i<state->ref_npending[note]; i++) {
+                state->ref_off[note][i-1] = state->ref_off[note][i];
+            }
+            state->ref_npending[note]--;
+        }
+    }
+
+    // offHeap
+    used = sesh->offHeap->n - sesh->offHeap->savail;
+    if (used > state->offheap_peak) state->offheap_peak = used;
+    if (state->ncycles % SOAK_LINK_CHECK_CYCLES == 0) {
+        soak_check_links(state);
+    }
+
+    state->ncycles++;
+
+}
+
+// every offHeap node in use must be linked into the note-off buffer
+
+static void soak_check_links(soak_state_t *state) {
+
+    sq_session_t sesh = state->sesh;
+    size_t linked = 0, used;
+
+    for (size_t i=0; i<sesh->len_off; i++) {
+        for (offNode_t *offp = sesh->buf_off[i]; offp; offp = offp->next) {
+            linked++;
+        }
+    }
+
+    used = sesh->offHeap->n - sesh->offHeap->savail;
+    if (linked != used) {
+        if (state->nlink_errors < SOAK_MAX_NERRORS) {
+            fprintf(stderr, "offHeap has %zu nodes in use, but %zu are linked\n", used, linked);
+        }
+        state->nlink_errors++;
+    }
+
+}
+
+static void soak_mutate(soak_state_t *state, sq_sequence_t *seqs, sq_outport_t *outports) {
+
+    sq_sequence_t seq = seqs[random() % nseqs];
+    sq_trigger_t trig;
+    int nsteps = sq_sequence_get_nsteps(seq);
+    int first, last, tmp;
+
+    switch (random() % 8) {
+        case 0:
+        case 1:
+        case 2:
+            trig = sq_trigger_new();
+            soak_random_trig(trig);
+            sq_sequence_set_trig(seq, random() % nsteps, trig);
+            sq_trigger_delete(trig);
+            break;
+        case 3:
+            sq_session_set_bpm(state->sesh, SOAK_MIN_BPM + frand() * (SOAK_MAX_BPM - SOAK_MIN_BPM));
+            break;
+        case 4:
+            sq_sequence_set_clockdivide(seq, 1 + random() % 4);
+            break;
+        case 5:
+            sq_sequence_set_motion(seq, random() % 3);
+            break;
+        case 6:
+            sq_sequence_set_mute(seq, random() % 4 == 0);
+            sq_sequence_set_transpose(seq, random() % 25 - 12);
+            break;
+        case 7:
+            // keep first <= last at every point
+            first = random() % nsteps;
+            last = random() % nsteps;
+            if (first > last) {
+                tmp = first;
+                first = last;
+                last = tmp;
+            }
+            if (first > sq_sequence_get_last(seq)) {
+                sq_sequence_set_last(seq, last);
+                sq_sequence_set_first(seq, first);
+            } else {
+                sq_sequence_set_first(seq, first);
+                sq_sequence_set_last(seq, last);
+            }
+            break;
+    }
+
+}
+
+static void soak_random_trig(sq_trigger_t trig) {
+
+    float r = frand();
+
+    if (r < 0.5) {
+        sq_trigger_set_type(trig, TRIG_NULL);
+    } else if (r < 0.9) {
+        sq_trigger_set_type(trig, TRIG_NOTE);
+        sq_trigger_set_note_value(trig, 12 + random() % 100);
+        sq_trigger_set_note_velocity(trig, 1 + random() % 127);
+        sq_trigger_set_note_length(trig, frand() * TRIG_MAX_LENGTH);
+        sq_trigger_set_channel(trig, 1 + random() % 16);
+        sq_trigger_set_probability(trig, 0.5 + 0.5 * frand());
+        sq_trigger_set_microtime(trig, frand() - 0.5);
+    } else {
+        sq_trigger_set_type(trig, TRIG_CC);
+        sq_trigger_set_cc_number(trig, random() % 120);
+        sq_trigger_set_cc_value(trig, random() % 128);
+        sq_trigger_set_channel(trig, 1 + random() % 16);
+    }
+
+}
+
+static void wait_for_cycles(unsigned long long ncycles) {
+
+    while (fakejack_get_ncycles() < ncycles) {
+        usleep(100);
+    }
+
+}
+
+static long rss_kb(void) {
+
+    long pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+
+    if (f) {
+        if (fscanf(f, "%*s %ld", &pages) != 1) pages = 0;
+        fclose(f);
+    }
+
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+
+}
+
+static double frand(void) {
+
+    return ((double) random()) / RAND_MAX;
+
+}
+
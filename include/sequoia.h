@@ -48,10 +48,58 @@ enum motion_type {MOTION_FORWARD, MOTION_BACKWARD, MOTION_BOUNCE};
 enum swing_type {SWING_ODD, SWING_ALTERNATE};
 
 enum inport_type {INPORT_NONE, INPORT_TRANSPOSE, INPORT_PLAYHEAD, INPORT_CLOCKDIVIDE,
-                    INPORT_DIRECTION, INPORT_MUTE, INPORT_FIRST, INPORT_LAST};
+                    INPORT_DIRECTION, INPORT_MUTE, INPORT_FIRST, INPORT_LAST, INPORT_RECORD};
+
+enum record_mode {RECORD_OVERDUB, RECORD_REPLACE};
+
+enum perf_phase {PERF_CTRL, PERF_INPORTS, PERF_SEQUENCES, PERF_NOTEOFFS, PERF_SORT,
+                    PERF_WRITE, PERF_CYCLE, PERF_NPHASES};
+
+///////////////////////////////
+// structs
+///////////////////////////////
+
+#define SQ_PERF_NBINS 32
+
+// timing of the process callback, per phase (see sq_session_get_perf_stats)
+struct sq_perf_stats {
+
+    unsigned long hist[PERF_NPHASES][SQ_PERF_NBINS];   // bin i: [2^i, 2^(i+1)) ns
+    unsigned long max[PERF_NPHASES];                   // longest, in ns
+    unsigned long ncycles;  // callbacks timed
+    unsigned long nover;    // callbacks longer than threshold * period
+    float threshold;        // fraction of the JACK period
+
+};
 
 enum trig_type {TRIG_NULL, TRIG_NOTE, TRIG_CC};
 
+// monotonically increasing counters (see sq_*_get_stats)
+struct sq_sequence_stats {
+
+    unsigned long events;       // note-ons and CCs emitted
+    unsigned long prob_skips;   // trigs skipped by their probability
+    unsigned long rb_overflows; // control messages dropped (ringbuffer full)
+
+};
+
+struct sq_outport_stats {
+
+    unsigned long events;           // events written to the port
+    unsigned long reserve_fails;    // events dropped (jack_midi_event_reserve failed)
+
+};
+
+struct sq_session_stats {
+
+    unsigned long noteoffs_scheduled;
+    unsigned long noteoffs_delivered;
+    unsigned long offheap_exhausted;    // note-offs not scheduled (offHeap full)
+    unsigned long mevs_dropped;         // events dropped (event buffer full)
+    unsigned long rb_overflows;         // control messages dropped (ringbuffer full)
+
+};
+
 ///////////////////////////////
 // methods
 ///////////////////////////////
@@ -60,6 +108,8 @@ sq_session_t    sq_session_new(const char*);
 void            sq_session_delete(sq_session_t);
 void            sq_session_delete_recursive(sq_session_t);
 void            sq_session_disconnect_jack(sq_session_t);
+int             sq_session_init_arena(sq_session_t, size_t, bool);
+sq_sequence_t   sq_session_new_sequence(sq_session_t, int);
 int             sq_session_register_outport(sq_session_t, sq_outport_t);
 int             sq_session_register_inport(sq_session_t, sq_inport_t);
 void            sq_session_add_sequence(sq_session_t, sq_sequence_t);
@@ -71,22 +121,47 @@ const char*     sq_session_get_name(sq_session_t);
 float           sq_session_get_bpm(sq_session_t);
 size_t          sq_session_get_nseqs(sq_session_t);
 sq_sequence_t   sq_session_get_seq(sq_session_t, size_t);
+sq_sequence_t   sq_session_find_seq(sq_session_t, const char*);
 size_t          sq_session_get_ninports(sq_session_t);
 sq_inport_t     sq_session_get_inport(sq_session_t, size_t);
 size_t          sq_session_get_noutports(sq_session_t);
 sq_outport_t    sq_session_get_outport(sq_session_t, size_t);
+void            sq_session_get_stats(sq_session_t, struct sq_session_stats*);
+void            sq_session_get_perf_stats(sq_session_t, struct sq_perf_stats*);
+void            sq_session_reset_perf_stats(sq_session_t);
+void            sq_session_set_perf_threshold(sq_session_t, float);
+int             sq_session_enable_history(sq_session_t, size_t);
+void            sq_session_begin_edit(sq_session_t);
+void            sq_session_end_edit(sq_session_t);
+bool            sq_session_undo(sq_session_t);
+bool            sq_session_redo(sq_session_t);
+void            sq_session_clear_history(sq_session_t);
+int             sq_session_enable_journal(sq_session_t, const char*);
+void            sq_session_compact_journal(sq_session_t);
+void            sq_session_disable_journal(sq_session_t);
 void            sq_session_save(sq_session_t, const char*);
 sq_session_t    sq_session_load(const char*);
+int             sq_session_reload(sq_session_t, const char*);
+double          sq_session_get_load_time(sq_session_t);
 
 sq_sequence_t   sq_sequence_new(int);
 void            sq_sequence_delete(sq_sequence_t);
+sq_sequence_t   sq_sequence_clone(sq_sequence_t);
+sq_sequence_t   sq_sequence_new_linked(sq_sequence_t);
+void            sq_sequence_unlink(sq_sequence_t);
+bool            sq_sequence_is_linked(sq_sequence_t);
 void            sq_sequence_pprint(sq_sequence_t);
+void            sq_sequence_get_stats(sq_sequence_t, struct sq_sequence_stats*);
 ////
 sq_outport_t    sq_sequence_get_outport(sq_sequence_t);
 void            sq_sequence_set_outport(sq_sequence_t, sq_outport_t);
+void            sq_sequence_add_fanout(sq_sequence_t, sq_outport_t);
+void            sq_sequence_rm_fanout(sq_sequence_t, sq_outport_t);
 void            sq_sequence_set_trig(sq_sequence_t, int, sq_trigger_t);
 void            sq_sequence_get_trig(sq_sequence_t, size_t, sq_trigger_t);
 void            sq_sequence_clear_trig(sq_sequence_t, int);
+void            sq_sequence_get_trigs(sq_sequence_t, int, int, sq_trigger_t);
+void            sq_sequence_set_trigs(sq_sequence_t, int, int, sq_trigger_t);
 ////
 const char*     sq_sequence_get_name(sq_sequence_t);
 void            sq_sequence_set_name(sq_sequence_t, const char*);
@@ -129,6 +204,7 @@ void            sq_trigger_set_cc_value(sq_trigger_t, int);
 void            sq_trigger_set_probability(sq_trigger_t, float);
 void            sq_trigger_set_microtime(sq_trigger_t, float);
 void            sq_trigger_set_channel(sq_trigger_t, int);
+void            sq_trigger_set_outport(sq_trigger_t, int);
 enum trig_type  sq_trigger_get_type(sq_trigger_t);
 int             sq_trigger_get_note_value(sq_trigger_t);
 int             sq_trigger_get_note_velocity(sq_trigger_t);
@@ -138,19 +214,30 @@ int             sq_trigger_get_cc_value(sq_trigger_t);
 float           sq_trigger_get_probability(sq_trigger_t);
 float           sq_trigger_get_microtime(sq_trigger_t);
 int             sq_trigger_get_channel(sq_trigger_t);
+int             sq_trigger_get_outport(sq_trigger_t);
 
 sq_inport_t         sq_inport_new(const char*);
 void                sq_inport_delete(sq_inport_t);
 void                sq_inport_set_name(sq_inport_t, const char*);
 void                sq_inport_set_type(sq_inport_t, enum inport_type);
 void                sq_inport_add_sequence(sq_inport_t, sq_sequence_t);
+void                sq_inport_set_record_mode(sq_inport_t, enum record_mode);
+void                sq_inport_add_thru(sq_inport_t, sq_outport_t);
+void                sq_inport_rm_thru(sq_inport_t, sq_outport_t);
+void                sq_inport_set_thru_channel(sq_inport_t, int);
+void                sq_inport_set_thru_transpose(sq_inport_t, int);
 const char*         sq_inport_get_name(sq_inport_t);
 enum inport_type    sq_inport_get_type(sq_inport_t);
+enum record_mode    sq_inport_get_record_mode(sq_inport_t);
+int                 sq_inport_get_thru_channel(sq_inport_t);
+int                 sq_inport_get_thru_transpose(sq_inport_t);
+bool                sq_inport_read_recorded(sq_inport_t, sq_sequence_t*, int*, sq_trigger_t);
 
 sq_outport_t    sq_outport_new(const char*);
 void            sq_outport_delete(sq_outport_t);
 void            sq_outport_set_name(sq_outport_t, const char*);
 char*           sq_outport_get_name(sq_outport_t);
+void            sq_outport_get_stats(sq_outport_t, struct sq_outport_stats*);
 
 #ifdef __cplusplus
 }
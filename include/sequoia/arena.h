@@ -0,0 +1,67 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <jack/ringbuffer.h>
+
+#define ARENA_MIN_CLASS 6       // smallest block is 64 bytes
+#define ARENA_NCLASSES 20       // largest is 32 MB
+#define ARENA_HEADER_SIZE 16    // keeps blocks 16-byte aligned
+#define ARENA_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+// a session-owned region of memory, mapped and mlocked once up front, that
+// sequences are carved from. blocks are rounded up to a power of two, and
+// freed blocks go on a free list for their size class. not thread-safe, and
+// not for the RT thread: allocate and free from the UI thread only
+
+typedef struct arena_block {
+    struct arena_block *next;   // while on a free list
+} arena_block_t;
+
+typedef struct {
+
+    char *base;
+    size_t size;
+    size_t used;        // high-water mark of the bump allocator
+    bool locked;
+    bool hugepages;
+    arena_block_t *free[ARENA_NCLASSES];
+
+} arena_t;
+
+// constructor and destructor
+arena_t *arena_new(size_t, bool);
+void arena_delete(arena_t*);
+
+// methods (arena_alloc returns NULL once the arena is exhausted)
+void *arena_alloc(arena_t*, size_t);
+void arena_free(arena_t*, void*);
+bool arena_owns(arena_t*, void*);
+
+// a jack ringbuffer in arena memory, in one block (free it with arena_free)
+jack_ringbuffer_t *arena_ringbuffer_new(arena_t*, size_t);
+
+#endif
@@ -0,0 +1,85 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "sequoia.h"
+#include "trigger.h"
+#include "sequence.h"
+
+// undo/redo for trig and parameter edits. each edit is one small record of
+// the values before and after it, so the history costs a fixed number of
+// bytes per edit rather than a snapshot of the session. records made
+// between history_begin and history_end form one group, which is undone
+// and redone as a unit. the records belong to the UI thread, except while
+// the RT thread is applying a range of them for the session
+
+typedef struct {
+
+    sq_sequence_t seq;
+    unsigned int group;
+    enum sequence_param param;
+    int step;       // for SEQUENCE_SET_TRIG
+
+    union {
+        struct {int before, after;} i;
+        struct {float before, after;} f;
+        struct {struct trigger_data before, after;} t;
+    } v;
+
+} history_record_t;
+
+typedef struct history_data {
+
+    history_record_t *recs;
+    size_t size;
+    size_t len;
+    size_t pos;     // records [0, pos) can be undone, [pos, len) redone
+    unsigned int group;     // the next group number
+    unsigned int open_group;
+    int depth;      // of history_begin/history_end nesting
+
+} history_t;
+
+// constructor and destructor
+history_t *history_new(size_t);
+void history_delete(history_t*);
+
+// methods (UI thread)
+void history_begin(history_t*);
+void history_end(history_t*);
+void history_record_trig(history_t*, sq_sequence_t, int, sq_trigger_t, sq_trigger_t);
+void history_record_int(history_t*, sq_sequence_t, enum sequence_param, int, int);
+void history_record_float(history_t*, sq_sequence_t, enum sequence_param, float, float);
+bool history_undo_range(history_t*, size_t*, size_t*);
+bool history_redo_range(history_t*, size_t*, size_t*);
+void history_forget(history_t*, sq_sequence_t);
+void history_clear(history_t*);
+
+// applies records [from, to), backwards for an undo (either thread)
+void history_apply_now(history_t*, size_t, size_t, bool);
+
+#endif
@@ -22,12 +22,39 @@
 #ifndef inport_H
 #define inport_H
 
+#include <stdint.h>
 #include <jack/midiport.h>
+#include <jack/ringbuffer.h>
 
 #include "sequence.h"
+#include "outport.h"
+#include "midiEvent.h"
+#include "nameIndex.h"
 
 #define INPORT_MAX_NAME_LEN 255
 #define INPORT_MAX_NSEQ 16
+#define INPORT_NNOTES 128
+#define INPORT_NCHANNELS 16
+#define INPORT_MAX_NTHRU 16
+
+// a note being recorded, waiting for its note-off
+struct record_note {
+
+    bool active;
+    uint64_t time;                  // clock value at the note-on
+    int steps[INPORT_MAX_NSEQ];     // step it was written to, per sequence
+    int values[INPORT_MAX_NSEQ];    // note value it was written as, per sequence
+
+};
+
+// what the RT thread hands to the UI for each recorded trig
+typedef struct {
+
+    sq_sequence_t seq;
+    int step;
+    struct trigger_data trig;
+
+} record_msg_t;
 
 struct inport_data {
 
@@ -38,15 +65,42 @@ struct inport_data {
     jack_client_t *jack_client;
     jack_port_t *jack_port;
     void *buf;
+    jack_nframes_t nevents; // number of events in buf
+    jack_nframes_t ievent;  // index of the next event to be applied
+    nameIndex_t *names;     // of the session it's registered with, if any
 
     sq_sequence_t seqs[INPORT_MAX_NSEQ];
     int nseqs;
 
+    // MIDI thru
+    sq_outport_t thru[INPORT_MAX_NTHRU];
+    int nthru;
+    int thru_channel;       // [1, 16], or 0 to keep the incoming channel
+    int thru_transpose;
+    uint16_t thru_notes[INPORT_NCHANNELS][INPORT_NNOTES]; // sounding notes, see inport_thru_map()
+
+    // timing of the current processing block
+    uint64_t clock;         // frames elapsed before this block
+    jack_nframes_t nframes;
+    jack_nframes_t fps;
+    bool running;
+
+    // recording (INPORT_RECORD only)
+    enum record_mode rec_mode;
+    struct record_note rec_notes[INPORT_NNOTES];
+    int rec_step[INPORT_MAX_NSEQ];  // last step seen, per sequence (replace mode)
+    int rec_ahead[INPORT_MAX_NSEQ]; // step recorded ahead of the playhead, per sequence
+    jack_ringbuffer_t *rec_rb;
+
 };
 
-void inport_process(sq_inport_t, jack_nframes_t);
-json_object *inport_get_json(sq_inport_t);
-sq_inport_t inport_malloc_from_json(json_object*);
+void inport_prepare(sq_inport_t, jack_nframes_t, jack_nframes_t, bool);
+void inport_process(sq_inport_t, jack_nframes_t, jack_nframes_t);
+void inport_prepare_sequence(enum inport_type, sq_sequence_t);
+size_t inport_thru(sq_inport_t, midiEvent*, size_t, size_t*);
+jack_nframes_t inport_next_event_time(sq_inport_t, jack_nframes_t);
+void inport_write_json(sq_inport_t, jsonWriter_t*);
+sq_inport_t inport_read_json(jsonReader_t*, sq_session_t);
 
 
 #endif
@@ -0,0 +1,157 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <jack/ringbuffer.h>
+
+#include "sequoia.h"
+#include "trigger.h"
+#include "sequence.h"
+
+struct snapshot_data;
+
+#define JOURNAL_MAGIC "SQJ\0"
+#define JOURNAL_VERSION 3
+#define JOURNAL_NRECORDS 1024           // records in flight to the writer thread
+#define JOURNAL_COMPACT_SIZE (1 << 22)  // bytes of journal that prompt a new snapshot
+#define JOURNAL_POLL_US 10000
+
+// an append-only journal of the edits made to a session since its last
+// snapshot, for autosave and crash recovery. the UI thread queues a small
+// record for each edit (before applying it) on a ringbuffer, and a
+// background thread appends them to <snapshot>.journal. loading the
+// snapshot replays the journal on top of it.
+//
+// once the journal grows past JOURNAL_COMPACT_SIZE, the session takes a
+// snapshot of itself (see snapshot.h) and queues it after the last record
+// it includes. the writer thread then writes it to <snapshot>.tmp, starts
+// a new journal, moves the snapshot into place, and moves the new journal
+// over the old one, so the UI thread never waits on the disk. the
+// journal's header holds a hash of the snapshot it follows on from, so a
+// crash between the two moves leaves a journal that's ignored, not one
+// that's replayed twice.
+//
+// sequences are referred to by their index in the session, which the
+// journal tracks itself, since adding and removing sequences while playing
+// only takes effect on the RT thread later. port and inport settings
+// aren't journaled; registering a port writes a new snapshot.
+//
+// each record carries a hash of itself, so replay stops at the first one
+// that was torn or corrupted on disk, rather than applying it
+
+enum journal_kind {JOURNAL_TRIG, JOURNAL_PARAM, JOURNAL_NAME, JOURNAL_OUTPORT, JOURNAL_BPM,
+                    JOURNAL_ADD, JOURNAL_RM, JOURNAL_LINK, JOURNAL_UNLINK, JOURNAL_FANOUT,
+                    JOURNAL_SNAPSHOT};
+
+struct journal_header {
+
+    char magic[4];
+    uint32_t version;
+    uint64_t snapshot;      // hash of the snapshot the records apply to
+
+};
+
+typedef struct {
+
+    uint16_t kind;
+    uint16_t size;      // as written to the file, up to the end of the value
+    int32_t seq;        // index in the session, or -1
+    uint64_t check;     // hash of the record as written, with this zeroed
+
+    union {
+        struct {int32_t step; struct trigger_data trig;} trig;
+        struct {int32_t param, value;} param;   // SEQUENCE_CLEAR_TRIG takes a step
+        int32_t index;      // steps to add, an outport, a fanout or the sequence to link to
+        float bpm;
+        struct snapshot_data *snapshot;     // for JOURNAL_SNAPSHOT, never written
+        char name[SEQUENCE_MAX_NAME_LEN + 1];
+    } v;
+
+} journal_record_t;
+
+typedef struct {
+
+    char *path;             // the snapshot's
+    char *tmp_path;         // where a new snapshot is written
+    char *journal_path;
+    char *journal_tmp_path; // where a new journal is started
+    bool binary;            // the snapshot is .sqb
+
+    jack_ringbuffer_t *rb;
+    pthread_t thread;
+    atomic_bool running;
+    atomic_bool swapping;   // a snapshot is queued, and not yet in place
+    bool swapped;           // whether the last one made it
+    struct snapshot_data *snapshot;     // the last one queued, until it's in place
+    FILE *fp;               // the journal, for the writer thread
+
+    size_t nbytes;          // queued since the last snapshot
+    sq_sequence_t *seqs;    // the session's sequences, in order, as the UI thread sees them
+    int nseqs;
+
+} journal_t;
+
+// constructor and destructor
+journal_t *journal_new(const char*, bool, sq_sequence_t*, int);
+void journal_delete(journal_t*);
+
+// methods (UI thread). each takes the session the edit is made to, and
+// does nothing if it has no journal
+void journal_trig(sq_session_t, sq_sequence_t, int, sq_trigger_t);
+void journal_param(sq_session_t, sq_sequence_t, enum sequence_param, int);
+void journal_name(sq_session_t, sq_sequence_t, const char*);
+void journal_outport(sq_session_t, sq_sequence_t, sq_outport_t);
+void journal_fanout(sq_session_t, sq_sequence_t, uint32_t);
+void journal_bpm(sq_session_t, float);
+void journal_add(sq_session_t, sq_sequence_t);
+void journal_rm(sq_session_t, sq_sequence_t);
+void journal_unlink(sq_session_t, sq_sequence_t);
+void journal_history(sq_session_t, size_t, size_t, bool);
+
+// for changes that aren't journaled record by record (see
+// sq_session_reload): the sequences as they now stand, to be followed by a
+// snapshot
+void journal_reset_seqs(journal_t*, sq_sequence_t*, int);
+
+// a new snapshot can only be queued once the last one is in place (or
+// has failed to be). journal_snapshot queues one after the records it
+// includes, and the journal deletes it when done
+bool journal_wait_snapshot(journal_t*);
+void journal_snapshot(journal_t*, struct snapshot_data*);
+
+// a hash of a snapshot's contents
+uint64_t journal_hash(const char*, size_t);
+
+// replays the journal of the snapshot at path (held in the buffer given)
+// onto the session just loaded from it, if the journal follows on from
+// that snapshot. returns the number of records replayed
+int journal_replay(sq_session_t, const char*, const char*, size_t);
+
+#endif
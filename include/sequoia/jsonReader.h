@@ -0,0 +1,72 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef JSONREADER_H
+#define JSONREADER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define JSONREADER_MAX_STRING 1024
+
+// a pull parser over a NUL-terminated buffer holding a whole document. the
+// caller walks the document in the order it expects it, asking for each
+// value in turn, so nothing is built up in memory. strings are decoded into
+// a buffer inside the reader, which each call reuses. positions can be
+// saved with jsonReader_tell and returned to with jsonReader_seek, for
+// reading objects whose members come in any order.
+//
+// a syntax error is reported once, after which every call returns a
+// default value and every loop ends, so callers only need to check
+// jsonReader_failed at the end
+
+enum json_kind {JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT,
+                    JSON_INVALID};
+
+typedef struct {
+
+    const char *buf;
+    const char *p;
+    bool failed;
+    char str[JSONREADER_MAX_STRING];
+
+} jsonReader_t;
+
+// initializer
+void jsonReader_init(jsonReader_t*, const char*);
+
+// methods
+bool jsonReader_begin_object(jsonReader_t*);
+bool jsonReader_next_key(jsonReader_t*, const char**);
+bool jsonReader_begin_array(jsonReader_t*);
+bool jsonReader_next_element(jsonReader_t*);
+enum json_kind jsonReader_peek(jsonReader_t*);
+double jsonReader_double(jsonReader_t*);
+int jsonReader_int(jsonReader_t*);
+bool jsonReader_bool(jsonReader_t*);
+const char *jsonReader_string(jsonReader_t*);
+void jsonReader_skip(jsonReader_t*);
+const char *jsonReader_tell(jsonReader_t*);
+void jsonReader_seek(jsonReader_t*, const char*);
+bool jsonReader_failed(jsonReader_t*);
+
+#endif
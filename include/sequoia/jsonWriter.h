@@ -0,0 +1,61 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#define JSONWRITER_MAX_DEPTH 16
+
+// writes JSON straight to a FILE as the caller walks its data, with no
+// intermediate tree. keys are given for members of objects, and NULL for
+// elements of arrays (and the top-level value). the output is indented
+// two spaces per level, as json-c's pretty printer does, except inside a
+// compact object, which goes on one line
+
+typedef struct {
+
+    FILE *fp;
+    int depth;
+    bool empty[JSONWRITER_MAX_DEPTH];   // nothing written yet at this depth
+    int compact;        // depth of the outermost compact object, or 0
+
+} jsonWriter_t;
+
+// initializer
+void jsonWriter_init(jsonWriter_t*, FILE*);
+
+// methods
+void jsonWriter_begin_object(jsonWriter_t*, const char*);
+void jsonWriter_begin_compact_object(jsonWriter_t*, const char*);
+void jsonWriter_end_object(jsonWriter_t*);
+void jsonWriter_begin_array(jsonWriter_t*, const char*);
+void jsonWriter_end_array(jsonWriter_t*);
+void jsonWriter_int(jsonWriter_t*, const char*, int);
+void jsonWriter_double(jsonWriter_t*, const char*, double);
+void jsonWriter_bool(jsonWriter_t*, const char*, bool);
+void jsonWriter_string(jsonWriter_t*, const char*, const char*);
+void jsonWriter_null(jsonWriter_t*, const char*);
+
+#endif
@@ -1,22 +1,28 @@
 #ifndef MIDIEVENT_H
 #define MIDIEVENT_H
 
+#include <stdint.h>
 #include <jack/jack.h>
 
-enum midiEventType {MEV_TYPE_NULL, MEV_TYPE_NOTEON, MEV_TYPE_NOTEOFF, MEV_TYPE_CC};
+struct outport_data;
+
+enum midiEventType {MEV_TYPE_NULL, MEV_TYPE_NOTEON, MEV_TYPE_NOTEOFF, MEV_TYPE_CC, MEV_TYPE_THRU};
 
 typedef struct {
     enum midiEventType type;
-    void *buf;              // JACK MIDI port buffer
+    struct outport_data *outport;   // destination port
+    uint32_t fanout;        // more of the session's outports, by index, to copy it to
     jack_nframes_t time;    // buffer frame index
     jack_nframes_t length;  // length of note (for note-on only)
     unsigned char status;   // MIDI status byte
     unsigned char data1;    // MIDI data byte
     unsigned char data2;    // MIDI data byte
+    unsigned char size;     // number of MIDI bytes (1 to 3)
 } midiEvent;
 
-void midiEvent_sort(midiEvent*, size_t);
+// stable sort by time. the scratch buffer must hold at least len/2 events
+void midiEvent_sort(midiEvent*, size_t, midiEvent*);
 
-#define MIDIEVENT_NULL (midiEvent) {MEV_TYPE_NULL, NULL, 0, 0, 0, 0, 0}
+#define MIDIEVENT_NULL (midiEvent) {MEV_TYPE_NULL, NULL, 0, 0, 0, 0, 0, 0, 0}
 
 #endif
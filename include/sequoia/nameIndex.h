@@ -0,0 +1,64 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// an open-addressing hash table from names to the sessions' sequences and
+// ports, for looking them up by name without a scan. the keys are the
+// items' own name fields, not copies, so an item has to be rekeyed when
+// its name changes. several items can share a name, in which case the one
+// inserted first is found, as a scan in session order would. UI thread only
+
+typedef struct {
+
+    const char *name;   // the item's own, or NULL for an empty slot
+    void *item;
+    uint32_t hash;
+    uint32_t order;     // of insertion, to tell apart items of the same name
+
+} nameIndex_entry_t;
+
+typedef struct {
+
+    nameIndex_entry_t *entries;
+    size_t size;        // a power of two
+    size_t count;
+    uint32_t next_order;
+
+} nameIndex_t;
+
+// constructor and destructor (in place)
+void nameIndex_init(nameIndex_t*);
+void nameIndex_free(nameIndex_t*);
+
+// methods
+void nameIndex_insert(nameIndex_t*, const char*, void*);
+void nameIndex_remove(nameIndex_t*, const char*, void*);
+void nameIndex_rekey(nameIndex_t*, const char*, void*);
+void nameIndex_clear(nameIndex_t*);
+void *nameIndex_find(nameIndex_t*, const char*);
+
+#endif
@@ -25,5 +25,6 @@ void offHeap_delete(offHeap_t*);
 // methods
 offNode_t *offHeap_alloc(offHeap_t*);
 void offHeap_free(offHeap_t *offHeap, offNode_t *offNode);
+void offNode_append(offNode_t **list, offNode_t *offNode);
 
 #endif
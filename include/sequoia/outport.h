@@ -23,7 +23,11 @@
 #define OUTPORT_H
 
 #include <jack/midiport.h>
-#include <json-c/json.h> 
+
+#include "stats.h"
+#include "jsonWriter.h"
+#include "jsonReader.h"
+#include "nameIndex.h"
 
 #define OUTPORT_MAX_NAME_LEN 255
 
@@ -34,10 +38,14 @@ struct outport_data {
     jack_client_t *jack_client;
     jack_port_t *jack_port;
     void *buf;
+    nameIndex_t *names;     // of the session it's registered with, if any
+    int index;              // in that session's outports, or -1
+
+    struct outport_counters stats;
 
 };
 
-json_object *outport_get_json(sq_outport_t);
-sq_outport_t outport_malloc_from_json(json_object*);
+void outport_write_json(sq_outport_t, jsonWriter_t*);
+sq_outport_t outport_read_json(jsonReader_t*);
 
 #endif
@@ -0,0 +1,102 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "sequoia.h"
+#include "trigger.h"
+#include "arena.h"
+
+// the trigger array of a sequence, which several sequences may share: a
+// clone shares its source's pattern until either side edits it, while
+// linked sequences share one pattern for good, so that an edit to one is
+// an edit to all. the refcount and linked flag belong to the UI thread.
+// while playing, the trigs are written by the RT thread only, inside
+// pattern_write_begin/pattern_write_end, so that the UI can take a
+// consistent copy of them without a round trip (see pattern_read).
+//
+// a packed pattern keeps only the steps that don't hold the default trig,
+// in order, and has no trigs array. it's never written to, and never
+// linked: an edit makes a new one (see pattern_edit). a lazy sequence
+// keeps its pattern packed until it can be heard, and a long, sparse one
+// plays it packed, through a cursor (see pattern_fits_packed)
+
+#define PATTERN_DENSE_NSTEPS 256    // no longer pattern is played packed
+#define PATTERN_SPARSE_RATIO 4      // nor one with more than a trig per this many steps
+
+struct pattern_step {
+
+    int step;
+    struct trigger_data trig;
+
+};
+
+typedef struct pattern_data {
+
+    struct trigger_data *trigs;     // NULL if packed
+    struct pattern_step *packed;
+    int npacked;
+    int nsteps;
+    int refcount;
+    bool linked;
+    arena_t *arena;     // the arena it was carved from, or NULL if malloc'd
+    atomic_uint version;    // odd while the trigs are being written
+
+} pattern_t;
+
+// constructor and destructor (pattern_unref frees on the last reference)
+pattern_t *pattern_new(int, arena_t*);
+pattern_t *pattern_new_packed(int, int, arena_t*);
+pattern_t *pattern_copy(pattern_t*, arena_t*);
+pattern_t *pattern_pack(pattern_t*, arena_t*);
+pattern_t *pattern_fit(pattern_t*, arena_t*);
+pattern_t *pattern_edit(pattern_t*, int, int, sq_trigger_t, arena_t*);
+void pattern_ref(pattern_t*);
+void pattern_unref(pattern_t*);
+
+// methods
+bool pattern_is_shared(pattern_t*);
+bool pattern_is_packed(pattern_t*);
+bool pattern_fits_packed(int, int);
+size_t pattern_alloc_size(int);
+size_t pattern_packed_alloc_size(int);
+int pattern_search(pattern_t*, int);
+void pattern_read(pattern_t*, int, int, struct trigger_data*);
+
+static inline void pattern_write_begin(pattern_t *pattern) {
+
+    atomic_fetch_add_explicit(&pattern->version, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+}
+
+static inline void pattern_write_end(pattern_t *pattern) {
+
+    atomic_fetch_add_explicit(&pattern->version, 1, memory_order_release);
+
+}
+
+#endif
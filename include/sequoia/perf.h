@@ -0,0 +1,63 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "sequoia.h"
+
+#define PERF_DEFAULT_THRESHOLD 0.5
+
+// timing histograms for the process callback. written by the RT thread only,
+// read (and reset) from any other thread, all with relaxed atomics
+
+typedef struct {
+
+    atomic_ulong hist[PERF_NPHASES][SQ_PERF_NBINS];
+    atomic_ulong max[PERF_NPHASES];
+    atomic_ulong ncycles;
+    atomic_ulong nover;
+    float threshold;    // fraction of the JACK period
+
+} perf_t;
+
+void perf_init(perf_t*);
+void perf_reset(perf_t*);
+void perf_record(perf_t*, enum perf_phase, uint64_t);
+void perf_record_cycle(perf_t*, uint64_t, uint64_t);
+void perf_read(perf_t*, struct sq_perf_stats*);
+
+static inline uint64_t perf_now(void) {
+
+    // monotonic time in ns; clock_gettime is served from the vDSO, no syscall
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#include <stdbool.h>
+
+#include "sequoia.h"
+#include "session.h"
+#include "sequence.h"
+#include "inport.h"
+#include "outport.h"
+#include "pattern.h"
+
+// the difference between a live session and the same session as loaded
+// again from a file, worked out on the UI thread, as one batch for the RT
+// thread to apply at the start of a bar. sequences, inports and outports
+// are matched up by name. a sequence whose trigs and parameters match the
+// file isn't touched, so it keeps its playhead; one that differs gets only
+// the trigs and parameters that differ, or a new pattern once the batch
+// has as many trigs to write in place as one cycle should take (see
+// reload_diff_trigs). so applying it costs at most that many trig writes,
+// plus a few stores per sequence and inport. sequences that are new in the
+// file are made in the live session's arena and added, and those that
+// aren't in it are removed. ports that are new are registered up front;
+// ports that aren't in the file are kept, since a JACK port can't be taken
+// away from under its connections
+
+struct reload_seq {
+
+    sq_sequence_t seq;
+    pattern_t *pattern;     // a new pattern to play, or NULL
+    pattern_t *old;         // the one it replaces, to unref once applied
+    int transpose, div, first, last;
+    bool mute;
+    enum motion_type motion;
+    sq_outport_t outport;
+    uint32_t fanout;
+
+};
+
+struct reload_trig {
+
+    pattern_t *pattern;
+    int step;
+    struct trigger_data trig;
+
+};
+
+struct reload_inport {
+
+    sq_inport_t inport;
+    enum inport_type type;
+    enum record_mode rec_mode;
+    int thru_channel, thru_transpose;
+    sq_sequence_t seqs[INPORT_MAX_NSEQ];
+    int nseqs;
+    sq_outport_t thru[INPORT_MAX_NTHRU];
+    int nthru;
+
+};
+
+typedef struct reload_data {
+
+    float bpm;
+    sq_sequence_t *seqs;        // the session's sequences, in the file's order
+    int nseqs;
+    struct reload_seq *changes; // to sequences that stay
+    int nchanges;
+    struct reload_trig *trigs;  // to patterns that stay
+    int ntrigs, maxtrigs;
+    struct reload_inport inports[SESSION_MAX_NINPORTS];
+    int ninports;
+    sq_sequence_t *added, *removed;
+    int nadded, nremoved;
+    bool done;      // set once applied
+
+} reload_t;
+
+// constructor and destructor (UI thread). the live session must have
+// caught up on adding and removing sequences. the removed sequences are
+// deleted along with the batch, once it has been applied (and the added
+// ones, if it never was)
+reload_t *reload_new(sq_session_t, sq_session_t);
+void reload_delete(reload_t*);
+
+// methods (RT thread, or UI thread if stopped)
+void reload_apply_now(reload_t*, sq_session_t);
+
+#endif
@@ -0,0 +1,50 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef RTCHECK_H
+#define RTCHECK_H
+
+// RT-safety checker, for debug builds (make RTCHECK=1). the process callback
+// marks its thread as RT for its duration, and while it is marked, calls to
+// malloc, free, the printf family, pthread_mutex_lock, usleep and random are
+// reported with a backtrace (once per call site). set SQ_RTCHECK_ABORT in the
+// environment to abort on the first one instead
+//
+// in normal builds, these compile to nothing
+
+#ifdef SQ_RTCHECK
+
+#define RTCHECK_MAX_FRAMES 32
+#define RTCHECK_MAX_NSITES 64
+#define RTCHECK_BOOTSTRAP_SIZE 4096
+
+void rtcheck_enter(void);
+void rtcheck_leave(void);
+
+#else
+
+#define rtcheck_enter()
+#define rtcheck_leave()
+
+#endif
+
+#endif
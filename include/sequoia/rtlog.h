@@ -0,0 +1,72 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef RTLOG_H
+#define RTLOG_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <jack/ringbuffer.h>
+
+#define RTLOG_NRECORDS 256
+#define RTLOG_MAX_STR_LEN 63
+#define RTLOG_POLL_US 10000
+
+// log messages from the RT thread. the RT thread binds a log to itself, and
+// from then on rtlog_write* only copy fixed-size records into a ringbuffer,
+// which a background thread drains, formats and prints. on any thread with
+// no log bound, rtlog_write* print straight to stderr
+
+enum rtlog_arg {RTLOG_ARG_NONE, RTLOG_ARG_INT, RTLOG_ARG_STR};
+
+typedef struct {
+
+    const char *fmt;    // must be a string literal (or otherwise outlive the log)
+    enum rtlog_arg arg;
+    int vi;
+    char vs[RTLOG_MAX_STR_LEN + 1];
+
+} rtlog_record_t;
+
+typedef struct {
+
+    jack_ringbuffer_t *rb;
+    atomic_ulong ndropped;
+    pthread_t thread;
+    atomic_bool running;
+
+} rtlog_t;
+
+// constructor and destructor
+rtlog_t *rtlog_new(void);
+void rtlog_delete(rtlog_t*);
+
+// binds a log to the calling thread (or unbinds, for NULL)
+void rtlog_bind(rtlog_t*);
+
+// methods
+void rtlog_write(const char*);
+void rtlog_write_int(const char*, int);
+void rtlog_write_str(const char*, const char*);
+
+#endif
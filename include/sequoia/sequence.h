@@ -23,20 +23,24 @@
 #define SEQUENCE_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <pthread.h>
 #include <jack/midiport.h>
 #include <jack/ringbuffer.h>
-#include <json-c/json.h>
 
 #include "sequoia.h"
 #include "trigger.h"
 #include "outport.h"
 #include "midiEvent.h"
+#include "stats.h"
+#include "arena.h"
+#include "pattern.h"
 
 // INTERFACE
 
 #define SEQUENCE_MAX_NAME_LEN 255
-#define SEQUENCE_MAX_NSTEPS 256
+#define SEQUENCE_MAX_NSTEPS 65536     // the most an sqb trig record can skip, plus one
 
 struct notification_data {
 
@@ -67,13 +71,20 @@ struct sequence_data {
 
     char name[SEQUENCE_MAX_NAME_LEN + 1];
     int transpose;
-    struct trigger_data *trigs;
+    struct trigger_data *trigs;     // the pattern's, for the RT thread, or NULL if packed
+    pattern_t *pattern;
+    int cursor, cursor_step;    // into a packed pattern, for the RT thread (or -1)
+    struct trigger_data rest;   // the default trig, for the steps a packed pattern leaves out
+    bool recorded;      // an inport records into the trigs from the RT thread
     sq_outport_t outport;
+    uint32_t fanout;    // more of the session's outports, by index, to copy its events to
     bool is_playing;
     int nsteps;
     int step;
-    jack_ringbuffer_t *rb;
+    jack_ringbuffer_t *rb;     // NULL while lazy
+    atomic_bool lazy;   // packed and silent, until sequence_materialize
     int div, idiv;
+    bool trig_pending;  // the current step's trig has yet to fire
     bool mute;
     int first, last;
     struct notification_data noti;
@@ -83,21 +94,62 @@ struct sequence_data {
     float swing;
     enum swing_type swingType;
     bool swingFlag;
+    uint32_t rng;   // state for the probability dice
+    struct sequence_counters stats;
+    arena_t *arena;     // the arena it was carved from, or NULL if malloc'd
+    sq_session_t session;   // the session it was added to, for the edit history
 
 };
 
+// control messages, from the setters to the RT thread
+
+enum sequence_param {SEQUENCE_SET_TRIG, SEQUENCE_CLEAR_TRIG, SEQUENCE_TRANSPOSE, SEQUENCE_PH,
+                        SEQUENCE_DIV, SEQUENCE_MUTE, SEQUENCE_FIRST, SEQUENCE_LAST, SEQUENCE_MOTION,
+                        SEQUENCE_GET_TRIG, SEQUENCE_SWING, SEQUENCE_SWING_TYPE,
+                        SEQUENCE_SET_PATTERN, SEQUENCE_SET_TRIGS};
+
+typedef struct {
+
+    enum sequence_param param;
+
+    // parameter-dependent value fields
+    int vi;
+    int vn;     // a number of steps, for SEQUENCE_SET_TRIGS
+    float vf;
+    bool vb;
+    sq_trigger_t vp;
+    pattern_t *vpat;
+
+    bool *donep;
+
+} sequence_ctrl_msg_t;
+
+sq_sequence_t sequence_new(int, arena_t*);
+sq_sequence_t sequence_new_pattern(pattern_t*, arena_t*, bool);
+size_t sequence_arena_size(int, int, bool);
+void sequence_materialize(sq_sequence_t);
+void sequence_own_pattern(sq_sequence_t);
+bool sequence_edit_packed(sq_sequence_t, int, int, sq_trigger_t);
+void sequence_link_pattern(sq_sequence_t, sq_sequence_t);
+void sequence_set_recorded(sq_sequence_t);
+
 midiEvent sequence_process(sq_sequence_t, jack_nframes_t, jack_nframes_t,
                                         jack_nframes_t, jack_nframes_t);
 
 void sequence_step(sq_sequence_t);
+int sequence_peek_step(sq_sequence_t);
 
-json_object *sequence_get_json(sq_sequence_t);
-sq_sequence_t sequence_malloc_from_json(json_object*);
+void sequence_write_json(sq_sequence_t, jsonWriter_t*, sq_session_t, int);
+size_t sequence_read_json_arena_size(jsonReader_t*, sq_session_t);
+sq_sequence_t sequence_read_json(jsonReader_t*, sq_session_t, arena_t*);
+bool sequence_loads_packed(bool, sq_outport_t, int);
 
 void sequence_reset_now(sq_sequence_t);
 void sequence_set_trig_now(sq_sequence_t, int, sq_trigger_t);
+void sequence_set_trigs_now(sq_sequence_t, int, int, sq_trigger_t);
 void sequence_get_trig_now(sq_sequence_t, int, sq_trigger_t);
 void sequence_clear_trig_now(sq_sequence_t, int);
+void sequence_set_pattern_now(sq_sequence_t, pattern_t*);
 void sequence_set_transpose_now(sq_sequence_t, int);
 void sequence_set_playhead_now(sq_sequence_t, int);
 void sequence_set_first_now(sq_sequence_t, int);
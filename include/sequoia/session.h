@@ -25,16 +25,26 @@
 #include <stdbool.h>
 #include <jack/jack.h>
 #include <jack/midiport.h>
-#include <json-c/json.h> 
 
 #include "sequence.h"
 #include "outport.h"
 #include "inport.h"
 #include "offHeap.h"
-
-#define SESSION_MAX_NSEQ 256
+#include "perf.h"
+#include "rtlog.h"
+#include "history.h"
+#include "journal.h"
+#include "stats.h"
+#include "nameIndex.h"
+
+#define SESSION_MAX_NSEQ 4096
 #define SESSION_MAX_NINPORTS 16
 #define SESSION_MAX_NOUTPORTS 16
+#define SESSION_MAX_NMEVS 8192
+#define SESSION_MAX_NAME_LEN 255
+
+struct reload_data;
+struct snapshot_data;
 
 struct session_data {
 
@@ -45,6 +55,7 @@ struct session_data {
     sq_sequence_t seqs[SESSION_MAX_NSEQ];
 
     bool is_playing;
+    bool offline;   // no JACK client: only loaded, to compare (see sq_session_reload)
     int fps; // frames per step
 
     jack_client_t *jack_client;
@@ -52,16 +63,44 @@ struct session_data {
     jack_nframes_t bs; // buffer size
     jack_ringbuffer_t *rb;
     jack_nframes_t frame;
+    unsigned long step;     // steps since the transport started
+    struct reload_data *reload;     // waiting for the start of the next bar
+    struct snapshot_data *snapshot;     // being captured, a slice per cycle
+    bool *snapshot_donep;
 
     sq_inport_t inports[SESSION_MAX_NINPORTS];
     sq_outport_t outports[SESSION_MAX_NOUTPORTS];
     size_t ninports, noutports;
 
+    midiEvent *mevs;        // events to be written in the current block
+    midiEvent *mevs_tmp;    // scratch space for sorting them
+
     offNode_t **buf_off;    // array of pointers
     size_t len_off;
     size_t idx_off;
     offHeap_t *offHeap;
 
+    perf_t perf;
+    struct session_counters stats;
+    rtlog_t *rtlog;
+    arena_t *arena;     // optional, for sequences made with sq_session_new_sequence
+    history_t *history;     // optional, for undo and redo
+    journal_t *journal;     // optional, for autosave
+    double load_time;       // seconds spent in sq_session_load
+
+    // for finding sequences and ports by name, as the UI thread sees them
+    nameIndex_t seq_names;
+    nameIndex_t outport_names;
+    nameIndex_t inport_names;
+
 };
 
+sq_session_t session_new(const char*, bool);
+struct snapshot_data *session_snapshot(sq_session_t);
+int session_save_file(sq_session_t, const char*, bool);
+void session_compact_journal(sq_session_t);
+sq_sequence_t session_get_sequence_from_name(sq_session_t, const char*);
+sq_outport_t session_get_outport_from_name(sq_session_t, const char*);
+sq_inport_t session_get_inport_from_name(sq_session_t, const char*);
+
 #endif
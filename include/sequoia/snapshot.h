@@ -0,0 +1,71 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+
+#include "sequoia.h"
+#include "session.h"
+#include "sequence.h"
+#include "inport.h"
+#include "outport.h"
+#include "pattern.h"
+
+#define SNAPSHOT_MAX_NSTEPS 4096    // recorded steps copied per cycle
+
+// a consistent, read-only copy of a session, for saving it while it plays.
+// the RT thread fills in what it owns (the tempo, the parameters inports
+// can change, and the trigs of sequences recorded into) at the start of a
+// cycle, or of as many cycles as it takes to copy SNAPSHOT_MAX_NSTEPS
+// recorded steps per cycle; the UI thread copies the rest. the copy is a session of its own,
+// with its own sequences and ports, so the writers take it as they are.
+//
+// patterns that are neither linked nor recorded into aren't copied, but
+// shared, since the UI copies a shared pattern before editing it (see
+// sequence_own_pattern). so a snapshot can be written out on any thread,
+// but it must be deleted on the UI thread, which owns the refcounts
+
+typedef struct snapshot_data {
+
+    struct session_data sesh;   // the copy, made of the ones below
+    struct sequence_data *seqs;
+    pattern_t **patterns;       // the sequences', shared or copied
+    struct inport_data *inports;
+    struct outport_data outports[SESSION_MAX_NOUTPORTS];
+    int next_seq, next_step;    // the recorded trigs not yet copied
+
+} snapshot_t;
+
+// constructor and destructor (UI thread). the session must have caught up
+// on adding and removing sequences, so that they match the RT thread's
+snapshot_t *snapshot_new(sq_session_t);
+void snapshot_delete(snapshot_t*);
+
+// methods (RT thread, or UI thread if stopped). called once per cycle
+// until it returns true
+bool snapshot_capture_now(snapshot_t*, sq_session_t);
+
+#endif
@@ -0,0 +1,141 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef SQB_H
+#define SQB_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sequoia.h"
+
+#define SQB_MAGIC "SQB\0"
+#define SQB_VERSION 2
+#define SQB_BYTE_ORDER 0x01020304   // written natively; a mismatch means another endianness
+#define SQB_NONE UINT32_MAX         // for an absent outport or link
+#define SQB_TRIG_NONE UINT8_MAX     // for a trig without an outport of its own
+
+// the binary session format. a file is a header followed by sections of
+// fixed-width records, so a loader can map it and index straight into it:
+//
+//      header
+//      outports    struct sqb_outport[noutports]
+//      sequences   struct sqb_sequence[nseqs]
+//      inports     struct sqb_inport[ninports]
+//      refs        uint32_t[nrefs], the inports' sequence and thru indices
+//      trigs       struct sqb_trigger[ntrigs]
+//      strings     NUL-terminated names, referred to by offset
+//
+// every section starts on an 8-byte boundary. most steps hold the default
+// trig, so those aren't stored at all: each trig record carries the number
+// of default steps that come before it, and the steps after a sequence's
+// last record are default too
+
+struct sqb_section {
+
+    uint32_t offset;    // from the start of the file
+    uint32_t count;     // in records, or bytes for the strings
+
+};
+
+struct sqb_header {
+
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t name;
+    float bpm;
+    uint32_t reserved;
+
+    struct sqb_section outports;
+    struct sqb_section sequences;
+    struct sqb_section inports;
+    struct sqb_section refs;
+    struct sqb_section trigs;
+    struct sqb_section strings;
+
+};
+
+struct sqb_outport {
+
+    uint32_t name;
+
+};
+
+struct sqb_sequence {
+
+    uint32_t name;
+    int32_t nsteps;
+    int32_t transpose;
+    int32_t clockdivide;
+    int32_t first;
+    int32_t last;
+    int32_t motion;
+    uint32_t mute;
+    uint32_t outport;   // index into the outports, or SQB_NONE
+    uint32_t fanout;    // mask over the outports, more to copy its events to
+    uint32_t link;      // index of an earlier sequence sharing its pattern, or SQB_NONE
+    uint32_t trigs;     // first trig record
+    uint32_t ntrigs;
+
+};
+
+struct sqb_inport {
+
+    uint32_t name;
+    int32_t type;
+    int32_t record_mode;
+    int32_t thru_channel;
+    int32_t thru_transpose;
+    uint32_t seqs;      // first ref, indices into the sequences
+    uint32_t nseqs;
+    uint32_t thru;      // first ref, indices into the outports
+    uint32_t nthru;
+    uint32_t reserved;
+
+};
+
+struct sqb_trigger {
+
+    uint16_t skip;      // default steps before this one
+    uint8_t type;
+    uint8_t channel;
+    uint8_t note_value;
+    uint8_t note_velocity;
+    uint8_t cc_number;
+    uint8_t cc_value;
+    uint8_t outport;    // index into the session's outports, or SQB_TRIG_NONE
+    uint8_t reserved[3];
+    float microtime;
+    float probability;
+    float note_length;
+
+};
+
+int sqb_write(sq_session_t, FILE*);
+sq_session_t sqb_read(const char*, size_t, bool);
+bool sqb_is_sqb(const char*, size_t);
+
+#endif
@@ -0,0 +1,59 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdatomic.h>
+
+// monotonically increasing event counters. they are bumped with relaxed
+// atomics (mostly on the RT thread) and can be read from any thread
+
+#define STATS_INC(counter) atomic_fetch_add_explicit(&(counter), 1, memory_order_relaxed)
+#define STATS_ADD(counter, n) atomic_fetch_add_explicit(&(counter), (n), memory_order_relaxed)
+#define STATS_GET(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+
+struct sequence_counters {
+
+    atomic_ulong events;
+    atomic_ulong prob_skips;
+    atomic_ulong rb_overflows;
+
+};
+
+struct outport_counters {
+
+    atomic_ulong events;
+    atomic_ulong reserve_fails;
+
+};
+
+struct session_counters {
+
+    atomic_ulong noteoffs_scheduled;
+    atomic_ulong noteoffs_delivered;
+    atomic_ulong offheap_exhausted;
+    atomic_ulong mevs_dropped;
+    atomic_ulong rb_overflows;
+
+};
+
+#endif
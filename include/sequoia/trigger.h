@@ -22,7 +22,10 @@
 #ifndef TRIGGER_H
 #define TRIGGER_H
 
-#include <json-c/json.h>
+#include <stdbool.h>
+
+#include "jsonWriter.h"
+#include "jsonReader.h"
 
 #define TRIG_MAX_LENGTH 16.0
 
@@ -40,11 +43,15 @@ struct trigger_data {
     int cc_number;          // [0, 119]
     int cc_value;           // [0, 127]
 
+    int outport;            // index into the session's outports, or -1 for the sequence's
+
 };
 
 void trigger_init(sq_trigger_t);
-json_object *trigger_get_json(sq_trigger_t);
-sq_trigger_t trigger_malloc_from_json(json_object*);
+bool trigger_is_default(sq_trigger_t);
+bool trigger_is_valid(sq_trigger_t);
+void trigger_write_json(sq_trigger_t, jsonWriter_t*, int);
+int trigger_read_json(sq_trigger_t, jsonReader_t*);
 
 
 #endif
@@ -0,0 +1,182 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "sequoia/arena.h"
+
+// LOCAL DECLARATIONS
+
+static int arena_class(size_t);
+
+// PUBLIC CODE
+
+arena_t *arena_new(size_t size, bool hugepages) {
+
+    arena_t *arena;
+    void *base = MAP_FAILED;
+
+    arena = malloc(sizeof(arena_t));
+
+    // hugepages need the size rounded up to a whole hugepage, and may not be
+    // available at all, in which case fall back to normal pages
+    if (hugepages) {
+#ifdef MAP_HUGETLB
+        size = (size + ARENA_HUGEPAGE_SIZE - 1) & ~((size_t) ARENA_HUGEPAGE_SIZE - 1);
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (base == MAP_FAILED) {
+            fprintf(stderr, "arena: hugepages not available, using normal pages\n");
+            hugepages = false;
+        }
+    }
+
+    if (base == MAP_FAILED) {
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "arena: failed to map %zu bytes\n", size);
+        free(arena);
+        return NULL;
+    }
+
+    arena->base = base;
+    arena->size = size;
+    arena->used = 0;
+    arena->hugepages = hugepages;
+
+    // one mlock for the lot (which also faults every page in). this can fail
+    // under a low RLIMIT_MEMLOCK, which isn't fatal: the memory is still usable
+    arena->locked = (mlock(arena->base, arena->size) == 0);
+    if (!arena->locked) {
+        fprintf(stderr, "arena: failed to lock %zu bytes\n", size);
+    }
+
+    for (int i=0; i<ARENA_NCLASSES; i++) {
+        arena->free[i] = NULL;
+    }
+
+    return arena;
+
+}
+
+void arena_delete(arena_t *arena) {
+
+    if (arena->locked) {
+        munlock(arena->base, arena->size);
+    }
+    munmap(arena->base, arena->size);
+    free(arena);
+
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+
+    int class = arena_class(size + ARENA_HEADER_SIZE);
+    size_t block_size;
+    char *block;
+
+    if (class < 0) return NULL;
+
+    // reuse a freed block of the same class if there is one, else bump
+    if (arena->free[class]) {
+        block = (char*) arena->free[class];
+        arena->free[class] = arena->free[class]->next;
+    } else {
+        block_size = (size_t) 1 << (class + ARENA_MIN_CLASS);
+        if (arena->used + block_size > arena->size) return NULL;
+        block = arena->base + arena->used;
+        arena->used += block_size;
+    }
+
+    // the header just records the class
+    *((int*) block) = class;
+
+    return block + ARENA_HEADER_SIZE;
+
+}
+
+void arena_free(arena_t *arena, void *ptr) {
+
+    arena_block_t *block;
+    int class;
+
+    if (!ptr) return;
+
+    block = (arena_block_t*) ((char*) ptr - ARENA_HEADER_SIZE);
+    class = *((int*) block);
+
+    block->next = arena->free[class];
+    arena->free[class] = block;
+
+}
+
+bool arena_owns(arena_t *arena, void *ptr) {
+
+    return ((char*) ptr >= arena->base) && ((char*) ptr < arena->base + arena->size);
+
+}
+
+jack_ringbuffer_t *arena_ringbuffer_new(arena_t *arena, size_t sz) {
+
+    // laid out and initialized the same way as jack_ringbuffer_create, but
+    // with the struct and its buffer in one arena block (and already locked)
+
+    jack_ringbuffer_t *rb;
+    int power_of_two;
+
+    for (power_of_two = 1; (1 << power_of_two) < sz; power_of_two++);
+
+    rb = arena_alloc(arena, sizeof(jack_ringbuffer_t) + (1 << power_of_two));
+    if (!rb) return NULL;
+
+    rb->size = 1 << power_of_two;
+    rb->size_mask = rb->size - 1;
+    rb->write_ptr = 0;
+    rb->read_ptr = 0;
+    rb->buf = (char*) (rb + 1);
+    rb->mlocked = arena->locked;
+
+    return rb;
+
+}
+
+// LOCAL CODE
+
+static int arena_class(size_t size) {
+
+    // the smallest class that fits, or -1 if none does
+
+    for (int class=0; class<ARENA_NCLASSES; class++) {
+        if (size <= ((size_t) 1 << (class + ARENA_MIN_CLASS))) {
+            return class;
+        }
+    }
+
+    return -1;
+
+}
@@ -0,0 +1,272 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sequoia/history.h"
+
+// LOCAL DECLARATIONS
+
+static history_record_t *history_push(history_t*, sq_sequence_t, enum sequence_param);
+static void history_apply_record(history_record_t*, bool);
+
+// PUBLIC CODE
+
+history_t *history_new(size_t size) {
+
+    history_t *history;
+
+    history = malloc(sizeof(history_t));
+
+    history->recs = malloc(size * sizeof(history_record_t));
+    history->size = size;
+    history->len = 0;
+    history->pos = 0;
+    history->group = 0;
+    history->open_group = 0;
+    history->depth = 0;
+
+    return history;
+
+}
+
+void history_delete(history_t *history) {
+
+    free(history->recs);
+    free(history);
+
+}
+
+void history_begin(history_t *history) {
+
+    if (history->depth++ == 0) {
+        history->open_group = history->group++;
+    }
+
+}
+
+void history_end(history_t *history) {
+
+    if (history->depth > 0) {
+        history->depth--;
+    }
+
+}
+
+void history_record_trig(history_t *history, sq_sequence_t seq, int step,
+                            sq_trigger_t before, sq_trigger_t after) {
+
+    history_record_t *rec;
+
+    if (!memcmp(before, after, sizeof(struct trigger_data))) return;
+
+    rec = history_push(history, seq, SEQUENCE_SET_TRIG);
+    rec->step = step;
+    memcpy(&rec->v.t.before, before, sizeof(struct trigger_data));
+    memcpy(&rec->v.t.after, after, sizeof(struct trigger_data));
+
+}
+
+void history_record_int(history_t *history, sq_sequence_t seq, enum sequence_param param,
+                            int before, int after) {
+
+    history_record_t *rec;
+
+    if (before == after) return;
+
+    rec = history_push(history, seq, param);
+    rec->v.i.before = before;
+    rec->v.i.after = after;
+
+}
+
+void history_record_float(history_t *history, sq_sequence_t seq, enum sequence_param param,
+                            float before, float after) {
+
+    history_record_t *rec;
+
+    if (before == after) return;
+
+    rec = history_push(history, seq, param);
+    rec->v.f.before = before;
+    rec->v.f.after = after;
+
+}
+
+bool history_undo_range(history_t *history, size_t *from, size_t *to) {
+
+    // the last group before pos, which becomes the new pos
+
+    unsigned int group;
+
+    if (history->pos == 0) return false;
+
+    group = history->recs[history->pos - 1].group;
+    *to = history->pos;
+    *from = history->pos;
+    while ((*from > 0) && (history->recs[*from - 1].group == group)) {
+        (*from)--;
+    }
+    history->pos = *from;
+
+    return true;
+
+}
+
+bool history_redo_range(history_t *history, size_t *from, size_t *to) {
+
+    // the first group after pos, which the new pos goes past
+
+    unsigned int group;
+
+    if (history->pos == history->len) return false;
+
+    group = history->recs[history->pos].group;
+    *from = history->pos;
+    *to = history->pos;
+    while ((*to < history->len) && (history->recs[*to].group == group)) {
+        (*to)++;
+    }
+    history->pos = *to;
+
+    return true;
+
+}
+
+void history_forget(history_t *history, sq_sequence_t seq) {
+
+    // drops the records for seq, which is leaving the session
+
+    size_t j = 0, pos = history->pos;
+
+    for (size_t i=0; i<history->len; i++) {
+        if (history->recs[i].seq == seq) {
+            if (i < history->pos) pos--;
+        } else {
+            history->recs[j++] = history->recs[i];
+        }
+    }
+
+    history->len = j;
+    history->pos = pos;
+
+}
+
+void history_clear(history_t *history) {
+
+    history->len = 0;
+    history->pos = 0;
+
+}
+
+void history_apply_now(history_t *history, size_t from, size_t to, bool undo) {
+
+    if (undo) {
+        for (size_t i=to; i>from; i--) {
+            history_apply_record(history->recs + i - 1, true);
+        }
+    } else {
+        for (size_t i=from; i<to; i++) {
+            history_apply_record(history->recs + i, false);
+        }
+    }
+
+}
+
+// LOCAL CODE
+
+static history_record_t *history_push(history_t *history, sq_sequence_t seq,
+                                        enum sequence_param param) {
+
+    history_record_t *rec;
+    size_t n;
+
+    // a new edit discards whatever could have been redone
+    history->len = history->pos;
+
+    // when full, make room by dropping the oldest group (or just the oldest
+    // record, if the group being recorded fills the whole history)
+    if (history->len == history->size) {
+        n = 1;
+        if (!(history->depth && (history->recs[0].group == history->open_group))) {
+            while ((n < history->len) && (history->recs[n].group == history->recs[0].group)) {
+                n++;
+            }
+        }
+        memmove(history->recs, history->recs + n, (history->len - n) * sizeof(history_record_t));
+        history->len -= n;
+    }
+
+    rec = history->recs + history->len;
+    rec->seq = seq;
+    rec->group = history->depth ? history->open_group : history->group++;
+    rec->param = param;
+    rec->step = 0;
+
+    history->len++;
+    history->pos = history->len;
+
+    return rec;
+
+}
+
+static void history_apply_record(history_record_t *rec, bool undo) {
+
+    int vi = undo ? rec->v.i.before : rec->v.i.after;
+    float vf = undo ? rec->v.f.before : rec->v.f.after;
+
+    switch (rec->param) {
+        case SEQUENCE_SET_TRIG:
+            sequence_set_trig_now(rec->seq, rec->step, undo ? &rec->v.t.before : &rec->v.t.after);
+            break;
+        case SEQUENCE_TRANSPOSE:
+            sequence_set_transpose_now(rec->seq, vi);
+            break;
+        case SEQUENCE_FIRST:
+            sequence_set_first_now(rec->seq, vi);
+            break;
+        case SEQUENCE_LAST:
+            sequence_set_last_now(rec->seq, vi);
+            break;
+        case SEQUENCE_DIV:
+            sequence_set_clockdivide_now(rec->seq, vi);
+            break;
+        case SEQUENCE_MUTE:
+            sequence_set_mute_now(rec->seq, vi);
+            break;
+        case SEQUENCE_MOTION:
+            sequence_set_motion_now(rec->seq, vi);
+            break;
+        case SEQUENCE_SWING:
+            sequence_set_swing_now(rec->seq, vf);
+            break;
+        case SEQUENCE_SWING_TYPE:
+            sequence_set_swingType_now(rec->seq, vi);
+            break;
+        default:
+            break;
+    }
+
+}
@@ -25,11 +25,21 @@
 
 #include "sequoia.h"
 #include "sequoia/inport.h"
+#include "sequoia/session.h"
+#include "sequoia/rtlog.h"
 
 // LOCAL DECLARATIONS
 
+#define INPORT_RECORD_RB_LENGTH 64
+
 unsigned int smod(int, unsigned int);
 void inport_sanitize_name(sq_inport_t, const char*);
+static void inport_apply_event(sq_inport_t, jack_midi_event_t*, jack_nframes_t);
+static void inport_record_note_on(sq_inport_t, jack_midi_event_t*, jack_nframes_t);
+static void inport_record_note_off(sq_inport_t, jack_midi_event_t*);
+static void inport_record_replace(sq_inport_t);
+static void inport_record_publish(sq_inport_t, sq_sequence_t, int);
+static bool inport_thru_map(sq_inport_t, jack_midi_event_t*, midiEvent*);
 
 // INTERFACE CODE
 
@@ -46,31 +56,73 @@ sq_inport_t sq_inport_new(const char *name) {
     inport->jack_client = NULL;
     inport->jack_port = NULL;
     inport->buf = NULL;
+    inport->nevents = 0;
+    inport->ievent = 0;
+    inport->names = NULL;
 
     inport->nseqs = 0;
 
+    inport->nthru = 0;
+    inport->thru_channel = 0;
+    inport->thru_transpose = 0;
+    memset(inport->thru_notes, 0, sizeof(inport->thru_notes));
+
+    inport->clock = 0;
+    inport->nframes = 0;
+    inport->fps = 0;
+    inport->running = false;
+
+    inport->rec_mode = RECORD_OVERDUB;
+    for (int i=0; i<INPORT_NNOTES; i++) {
+        inport->rec_notes[i].active = false;
+    }
+    for (int i=0; i<INPORT_MAX_NSEQ; i++) {
+        inport->rec_step[i] = -1;
+        inport->rec_ahead[i] = -1;
+    }
+
+    // allocate and lock the ringbuffer for recorded trigs
+    inport->rec_rb = jack_ringbuffer_create(INPORT_RECORD_RB_LENGTH * sizeof(record_msg_t));
+    int err = jack_ringbuffer_mlock(inport->rec_rb);
+    if (err) {
+        fprintf(stderr, "failed to lock ringbuffer\n");
+        exit(1);
+    }
+
     return inport;
 
 }
 
 void sq_inport_delete(sq_inport_t inport) {
 
+    jack_ringbuffer_free(inport->rec_rb);
     free(inport);
 
 }
 
 void sq_inport_set_name(sq_inport_t inport, const char *name) {
 
+    char old_name[INPORT_MAX_NAME_LEN + 1];
+
     if (inport->jack_client) { // if registered
         jack_port_rename(inport->jack_client, inport->jack_port, name);
     }
 
+    strcpy(old_name, inport->name);
     inport_sanitize_name(inport, name); 
 
+    if (inport->names) {
+        nameIndex_rekey(inport->names, old_name, inport);
+    }
+
 }
 
 void sq_inport_set_type(sq_inport_t inport, enum inport_type type) {
 
+    for (int i=0; i<inport->nseqs; i++) {
+        inport_prepare_sequence(type, inport->seqs[i]);
+    }
+
     inport->type = type;
 
 }
@@ -82,125 +134,297 @@ void sq_inport_add_sequence(sq_inport_t inport, sq_sequence_t seq) {
         return;
     }
 
+    inport_prepare_sequence(inport->type, seq);
     inport->seqs[inport->nseqs++] = seq;
 
 }
 
+void sq_inport_add_thru(sq_inport_t inport, sq_outport_t outport) {
+
+    if (inport->nthru >= INPORT_MAX_NTHRU) {
+        fprintf(stderr, "max number of thru outports per inport reached: %d\n", INPORT_MAX_NTHRU);
+        return;
+    }
+
+    inport->thru[inport->nthru++] = outport;
+
+}
+
+void sq_inport_rm_thru(sq_inport_t inport, sq_outport_t outport) {
+
+    int i;
+
+    for (i=0; i<inport->nthru; i++) {
+        if (inport->thru[i] == outport) {
+            break;
+        }
+    }
+
+    if (i < inport->nthru) { // then we found it at i
+        inport->nthru--;
+        for (; i<inport->nthru; i++) {
+            inport->thru[i] = inport->thru[i+1];
+        }
+    }
+
+}
+
+void sq_inport_set_thru_channel(sq_inport_t inport, int channel) {
+
+    // 0 passes the incoming channel through unchanged
+
+    if ((channel < 0) || (channel > 16)) {
+        fprintf(stderr, "thru channel of %d is out of range\n", channel);
+        return;
+    }
+
+    inport->thru_channel = channel;
+
+}
+
+void sq_inport_set_thru_transpose(sq_inport_t inport, int transpose) {
+
+    inport->thru_transpose = transpose;
+
+}
+
+void sq_inport_set_record_mode(sq_inport_t inport, enum record_mode mode) {
+
+    inport->rec_mode = mode;
+
+}
+
+bool sq_inport_read_recorded(sq_inport_t inport, sq_sequence_t *seq, int *step,
+                                sq_trigger_t trig) {
+
+    // pops the next recorded trig, if any. each recorded note is reported once
+    // at its note-on, and again with its final length at the note-off
+
+    record_msg_t msg;
+
+    if (jack_ringbuffer_read_space(inport->rec_rb) < sizeof(record_msg_t)) {
+        return false;
+    }
+
+    jack_ringbuffer_read(inport->rec_rb, (char*) &msg, sizeof(record_msg_t));
+
+    *seq = msg.seq;
+    *step = msg.step;
+    memcpy(trig, &msg.trig, sizeof(struct trigger_data));
+
+    // the RT thread has already written it, but it's only journaled now
+    journal_trig(msg.seq->session, msg.seq, msg.step, &msg.trig);
+
+    return true;
+
+}
+
 // PUBLIC CODE
 
-void inport_process(sq_inport_t inport, jack_nframes_t nframes) {
+void inport_prepare(sq_inport_t inport, jack_nframes_t nframes, jack_nframes_t fps,
+                        bool running) {
 
-    int iarg;
-    bool barg;
+    // fetch the port buffer for this processing block; the events in it
+    // are applied later by inport_process(), at the frame where they land
 
     inport->buf = jack_port_get_buffer(inport->jack_port, nframes);
-    jack_nframes_t count = jack_midi_get_event_count(inport->buf);
+    inport->nevents = jack_midi_get_event_count(inport->buf);
+    inport->ievent = 0;
+
+    inport->clock += inport->nframes;
+    inport->nframes = nframes;
+    inport->fps = fps;
+    inport->running = running;
+
+}
+
+void inport_process(sq_inport_t inport, jack_nframes_t frame, jack_nframes_t step_frame) {
+
+    // apply all pending events with a timestamp at or before frame.
+    // step_frame is the session's frame index within the current step
+
     jack_midi_event_t ev;
 
-    for (int i=0; i<count; i++) {
+    if ((inport->type == INPORT_RECORD) && (inport->rec_mode == RECORD_REPLACE)
+            && inport->running) {
+        inport_record_replace(inport);
+    }
 
-        jack_midi_event_get(&ev, inport->buf, i);
+    while (inport->ievent < inport->nevents) {
 
-        // chan 1 note-on's only, for now
-        if (ev.buffer[0] == 144) {
-
-            switch (inport->type) {
-                case INPORT_NONE:
-                    break;
-                case INPORT_TRANSPOSE:
-                    // bipolar mapping centered at 60
-                    for (int i=0; i<inport->nseqs; i++) {
-                        sequence_set_transpose_now(inport->seqs[i], ev.buffer[1] - 60);
-                    }
-                    break;
-                case INPORT_PLAYHEAD:
-                    // distance from 60 is taken modulo the sequence length
-                    for (int i=0; i<inport->nseqs; i++) {
-                        iarg = smod(ev.buffer[1] - 60, inport->seqs[i]->nsteps);
-                        sequence_set_playhead_now(inport->seqs[i], iarg);
-                    }
-                    break;
-                case INPORT_CLOCKDIVIDE:
-                    // absolute value from 60, plus 1 (so no clockdivide less than 1)
-                    iarg = 1 + abs(ev.buffer[1] - 60);
-                    for (int i=0; i<inport->nseqs; i++) {
-                        sequence_set_clockdivide_now(inport->seqs[i], iarg);
-                    }
-                    break;
-                case INPORT_MUTE:
-                    // even=mute, odd=unmute
-                    barg = ((ev.buffer[1] % 2) == 0);
-                    for (int i=0; i<inport->nseqs; i++) {
-                        sequence_set_mute_now(inport->seqs[i], barg);
-                    }
-                    break;
-                case INPORT_DIRECTION:
-                    fprintf(stderr, "INPORT_DIRECTION not yet implemented\n");
-                    break;
-                case INPORT_FIRST:
-                    // distance from 60 is taken modulo the sequence length
-                    for (int i=0; i<inport->nseqs; i++) {
-                        iarg = smod(ev.buffer[1] - 60, inport->seqs[i]->nsteps);
-                        sequence_set_first_now(inport->seqs[i], iarg);
-                    }
-                    break;
-                case INPORT_LAST:
-                    // distance from 60 is taken modulo the sequence length
-                    for (int i=0; i<inport->nseqs; i++) {
-                        iarg = smod(ev.buffer[1] - 60, inport->seqs[i]->nsteps);
-                        sequence_set_last_now(inport->seqs[i], iarg);
-                    }
-                    break;
-                default:
-                    // this should never happen
-                    fprintf(stderr, "inport has unknown type: %d\n", inport->type);
-                    break;
+        jack_midi_event_get(&ev, inport->buf, inport->ievent);
+        if (ev.time > frame) break;
 
-            }
+        inport_apply_event(inport, &ev, step_frame);
+        inport->ievent++;
+
+    }
+
+}
+
+void inport_prepare_sequence(enum inport_type type, sq_sequence_t seq) {
+
+    // readies seq for an inport of this type to act on from the RT thread.
+    // a recording one writes into its trigs, so it needs a pattern of its
+    // own, unpacked. a mute one can unmute it, and the RT thread can't
+    // materialize it then. the others only change parameters, which a lazy
+    // sequence keeps until it's heard, so it's left as it is
+
+    if (type == INPORT_RECORD) {
+        sequence_set_recorded(seq);
+    } else if (type == INPORT_MUTE) {
+        sequence_materialize(seq);
+    }
+
+}
 
+size_t inport_thru(sq_inport_t inport, midiEvent *mevs, size_t max, size_t *ndropped) {
+
+    // copies the channel messages in this block to each thru outport,
+    // at their original frame offsets. returns the number of mevs written,
+    // and adds the ones that didn't fit in max to ndropped
+
+    jack_midi_event_t ev;
+    midiEvent mev;
+    size_t n = 0;
+
+    if (!inport->nthru) return 0;
+
+    for (jack_nframes_t i=0; i<inport->nevents; i++) {
+
+        jack_midi_event_get(&ev, inport->buf, i);
+        if (!inport_thru_map(inport, &ev, &mev)) continue;
+
+        for (int j=0; j<inport->nthru; j++) {
+            if (!inport->thru[j]->buf) continue;
+            if (n == max) {
+                (*ndropped)++;
+                continue;
+            }
+            mevs[n] = mev;
+            mevs[n++].outport = inport->thru[j];
         }
 
     }
 
+    return n;
+
 }
 
-json_object *inport_get_json(sq_inport_t inport) {
+jack_nframes_t inport_next_event_time(sq_inport_t inport, jack_nframes_t nframes) {
+
+    // returns the timestamp of the next pending event, or nframes if there is none
+
+    jack_midi_event_t ev;
+
+    if (inport->ievent < inport->nevents) {
+        jack_midi_event_get(&ev, inport->buf, inport->ievent);
+        return ev.time;
+    }
+
+    return nframes;
 
-    json_object *jo_inport = json_object_new_object();
+}
 
-    json_object_object_add(jo_inport, "name",
-                            json_object_new_string(inport->name));
+void inport_write_json(sq_inport_t inport, jsonWriter_t *jw) {
 
-    json_object_object_add(jo_inport, "type",
-                            json_object_new_int(inport->type));
+    jsonWriter_begin_object(jw, NULL);
 
-    json_object *seq_array = json_object_new_array();
+    jsonWriter_string(jw, "name", inport->name);
+    jsonWriter_int(jw, "type", inport->type);
+    jsonWriter_int(jw, "record_mode", inport->rec_mode);
+
+    jsonWriter_begin_array(jw, "sequences");
     for (int i=0; i<inport->nseqs; i++) {
-        json_object_array_add(seq_array, json_object_new_string(inport->seqs[i]->name));
+        jsonWriter_string(jw, NULL, inport->seqs[i]->name);
     }
-    json_object_object_add(jo_inport, "sequences", seq_array);
+    jsonWriter_end_array(jw);
 
-    return jo_inport;
+    jsonWriter_begin_array(jw, "thru");
+    for (int i=0; i<inport->nthru; i++) {
+        jsonWriter_string(jw, NULL, inport->thru[i]->name);
+    }
+    jsonWriter_end_array(jw);
 
-}
+    jsonWriter_int(jw, "thru_channel", inport->thru_channel);
+    jsonWriter_int(jw, "thru_transpose", inport->thru_transpose);
 
-sq_inport_t inport_malloc_from_json(json_object *jo_inport) {
+    jsonWriter_end_object(jw);
 
-    sq_inport_t inport;
-    const char *name;
-    json_object *jo_tmp;
-    enum inport_type type;
-    
+}
+
+sq_inport_t inport_read_json(jsonReader_t *jr, sq_session_t sesh) {
 
-    json_object_object_get_ex(jo_inport, "name", &jo_tmp);
-    name = json_object_get_string(jo_tmp);
+    // its sequences and thru outports are named, and must already be in
+    // the session. the members can come in any order, so the name and type
+    // are found first and the lists read on a second pass
 
-    json_object_object_get_ex(jo_inport, "type", &jo_tmp);
-    type = json_object_get_int(jo_tmp);
+    sq_inport_t inport;
+    const char *key, *start, *end;
+    char name[INPORT_MAX_NAME_LEN + 1] = "";
+    int type = INPORT_NONE, rec_mode = -1, thru_channel = -1, thru_transpose = 0;
+    bool has_thru_transpose = false;
+    sq_sequence_t seq;
+    sq_outport_t outport;
+
+    jsonReader_begin_object(jr);
+    start = jsonReader_tell(jr);
+    while (jsonReader_next_key(jr, &key)) {
+        if (!strcmp(key, "name")) {
+            snprintf(name, sizeof(name), "%s", jsonReader_string(jr));
+        } else if (!strcmp(key, "type")) {
+            type = jsonReader_int(jr);
+        } else if (!strcmp(key, "record_mode")) {
+            rec_mode = jsonReader_int(jr);
+        } else if (!strcmp(key, "thru_channel")) {
+            thru_channel = jsonReader_int(jr);
+        } else if (!strcmp(key, "thru_transpose")) {
+            thru_transpose = jsonReader_int(jr);
+            has_thru_transpose = true;
+        } else {
+            jsonReader_skip(jr);
+        }
+    }
+    end = jsonReader_tell(jr);
 
     inport = sq_inport_new(name);
     sq_inport_set_type(inport, type);
 
+    // not present in older session files
+    if (rec_mode >= 0) {
+        sq_inport_set_record_mode(inport, rec_mode);
+    }
+    if (thru_channel >= 0) {
+        sq_inport_set_thru_channel(inport, thru_channel);
+    }
+    if (has_thru_transpose) {
+        sq_inport_set_thru_transpose(inport, thru_transpose);
+    }
+
+    jsonReader_seek(jr, start);
+    while (jsonReader_next_key(jr, &key)) {
+        if (!strcmp(key, "sequences")) {
+            jsonReader_begin_array(jr);
+            while (jsonReader_next_element(jr)) {
+                seq = session_get_sequence_from_name(sesh, jsonReader_string(jr));
+                if (seq) {
+                    sq_inport_add_sequence(inport, seq);
+                }
+            }
+        } else if (!strcmp(key, "thru")) {
+            jsonReader_begin_array(jr);
+            while (jsonReader_next_element(jr)) {
+                outport = session_get_outport_from_name(sesh, jsonReader_string(jr));
+                if (outport) {
+                    sq_inport_add_thru(inport, outport);
+                }
+            }
+        } else {
+            jsonReader_skip(jr);
+        }
+    }
+    jsonReader_seek(jr, end);
+
     return inport;
 
 }
@@ -217,6 +441,24 @@ enum inport_type sq_inport_get_type(sq_inport_t inport) {
 
 }
 
+enum record_mode sq_inport_get_record_mode(sq_inport_t inport) {
+
+    return inport->rec_mode;
+
+}
+
+int sq_inport_get_thru_channel(sq_inport_t inport) {
+
+    return inport->thru_channel;
+
+}
+
+int sq_inport_get_thru_transpose(sq_inport_t inport) {
+
+    return inport->thru_transpose;
+
+}
+
 
 // LOCAL CODE
 
@@ -239,3 +481,267 @@ void inport_sanitize_name(sq_inport_t inport, const char *name) {
 
 }
 
+static void inport_apply_event(sq_inport_t inport, jack_midi_event_t *ev,
+                                jack_nframes_t step_frame) {
+
+    int iarg;
+    bool barg;
+
+    if (inport->type == INPORT_RECORD) {
+        // notes on any channel; a note-on with zero velocity is a note-off
+        if (!inport->running || ev->size < 3) return;
+        if (((ev->buffer[0] & 0xF0) == 0x90) && ev->buffer[2]) {
+            inport_record_note_on(inport, ev, step_frame);
+        } else if (((ev->buffer[0] & 0xF0) == 0x80) || ((ev->buffer[0] & 0xF0) == 0x90)) {
+            inport_record_note_off(inport, ev);
+        }
+        return;
+    }
+
+    // chan 1 note-on's only, for now
+    if (ev->buffer[0] == 144) {
+
+        switch (inport->type) {
+            case INPORT_NONE:
+                break;
+            case INPORT_TRANSPOSE:
+                // bipolar mapping centered at 60
+                for (int i=0; i<inport->nseqs; i++) {
+                    sequence_set_transpose_now(inport->seqs[i], ev->buffer[1] - 60);
+                }
+                break;
+            case INPORT_PLAYHEAD:
+                // distance from 60 is taken modulo the sequence length
+                for (int i=0; i<inport->nseqs; i++) {
+                    iarg = smod(ev->buffer[1] - 60, inport->seqs[i]->nsteps);
+                    sequence_set_playhead_now(inport->seqs[i], iarg);
+                }
+                break;
+            case INPORT_CLOCKDIVIDE:
+                // absolute value from 60, plus 1 (so no clockdivide less than 1)
+                iarg = 1 + abs(ev->buffer[1] - 60);
+                for (int i=0; i<inport->nseqs; i++) {
+                    sequence_set_clockdivide_now(inport->seqs[i], iarg);
+                }
+                break;
+            case INPORT_MUTE:
+                // even=mute, odd=unmute
+                barg = ((ev->buffer[1] % 2) == 0);
+                for (int i=0; i<inport->nseqs; i++) {
+                    sequence_set_mute_now(inport->seqs[i], barg);
+                }
+                break;
+            case INPORT_DIRECTION:
+                rtlog_write("INPORT_DIRECTION not yet implemented\n");
+                break;
+            case INPORT_FIRST:
+                // distance from 60 is taken modulo the sequence length
+                for (int i=0; i<inport->nseqs; i++) {
+                    iarg = smod(ev->buffer[1] - 60, inport->seqs[i]->nsteps);
+                    sequence_set_first_now(inport->seqs[i], iarg);
+                }
+                break;
+            case INPORT_LAST:
+                // distance from 60 is taken modulo the sequence length
+                for (int i=0; i<inport->nseqs; i++) {
+                    iarg = smod(ev->buffer[1] - 60, inport->seqs[i]->nsteps);
+                    sequence_set_last_now(inport->seqs[i], iarg);
+                }
+                break;
+            default:
+                // this should never happen
+                rtlog_write_int("inport has unknown type: %d\n", inport->type);
+                break;
+
+        }
+
+    }
+
+}
+
+static void inport_record_note_on(sq_inport_t inport, jack_midi_event_t *ev,
+                                    jack_nframes_t step_frame) {
+
+    // quantize the note to the nearest step of each target sequence, and keep
+    // the remainder as microtime. this runs on the RT thread, which owns the
+    // trigs while the session is playing, so they are written in place
+
+    sq_sequence_t seq;
+    sq_trigger_t trig;
+    struct record_note *note = inport->rec_notes + (ev->buffer[1] & 0x7F);
+    float fps = inport->fps;
+    float offset, microtime;
+    int step, value;
+
+    note->active = true;
+    note->time = inport->clock + ev->time;
+
+    for (int i=0; i<inport->nseqs; i++) {
+
+        seq = inport->seqs[i];
+
+        // distance from the current step's trig position (halfway through the
+        // first session step of the clock divide), in units of session steps
+        offset = (seq->idiv * fps + step_frame) / fps - 0.5;
+        if (offset < 0.5 * seq->div) {
+            step = seq->step;
+            microtime = offset;
+        } else {
+            step = sequence_peek_step(seq);
+            microtime = offset - seq->div;
+            inport->rec_ahead[i] = step;
+        }
+
+        if (microtime < -0.5) microtime = -0.5;
+        if (microtime >= 0.5) microtime = 0.4999;
+
+        // store the untransposed note, so that it plays back as it was played
+        value = ev->buffer[1] - seq->transpose;
+        if (value < 0) value = 0;
+        if (value > 127) value = 127;
+
+        trig = seq->trigs + step;
+        pattern_write_begin(seq->pattern);
+        trigger_init(trig);
+        trig->type = TRIG_NOTE;
+        trig->channel = (ev->buffer[0] & 0x0F) + 1;
+        trig->microtime = microtime;
+        trig->note_value = value;
+        trig->note_velocity = ev->buffer[2];
+        pattern_write_end(seq->pattern);
+
+        note->steps[i] = step;
+        note->values[i] = value;
+        inport_record_publish(inport, seq, step);
+
+    }
+
+}
+
+static void inport_record_note_off(sq_inport_t inport, jack_midi_event_t *ev) {
+
+    // the note length is the time since the matching note-on
+
+    sq_sequence_t seq;
+    sq_trigger_t trig;
+    struct record_note *note = inport->rec_notes + (ev->buffer[1] & 0x7F);
+    float length;
+
+    if (!note->active) return;
+    note->active = false;
+
+    length = (float) (inport->clock + ev->time - note->time) / inport->fps;
+    if (length > TRIG_MAX_LENGTH) length = TRIG_MAX_LENGTH;
+
+    for (int i=0; i<inport->nseqs; i++) {
+
+        seq = inport->seqs[i];
+        trig = seq->trigs + note->steps[i];
+
+        // only if the trig hasn't been overwritten in the meantime
+        if ((trig->type == TRIG_NOTE) && (trig->note_value == note->values[i])) {
+            pattern_write_begin(seq->pattern);
+            trig->note_length = length;
+            pattern_write_end(seq->pattern);
+            inport_record_publish(inport, seq, note->steps[i]);
+        }
+
+    }
+
+}
+
+static void inport_record_replace(sq_inport_t inport) {
+
+    // in replace mode, each step is cleared as the playhead enters it,
+    // unless a note was just quantized forward onto it
+
+    sq_sequence_t seq;
+
+    for (int i=0; i<inport->nseqs; i++) {
+
+        seq = inport->seqs[i];
+
+        if (seq->step != inport->rec_step[i]) {
+            inport->rec_step[i] = seq->step;
+            if (seq->step != inport->rec_ahead[i]) {
+                sequence_clear_trig_now(seq, seq->step);
+                inport_record_publish(inport, seq, seq->step);
+            }
+            inport->rec_ahead[i] = -1;
+        }
+
+    }
+
+}
+
+static void inport_record_publish(sq_inport_t inport, sq_sequence_t seq, int step) {
+
+    record_msg_t msg;
+
+    if (jack_ringbuffer_write_space(inport->rec_rb) < sizeof(record_msg_t)) {
+        return; // the UI isn't keeping up; the trig itself is already recorded
+    }
+
+    msg.seq = seq;
+    msg.step = step;
+    memcpy(&msg.trig, seq->trigs + step, sizeof(struct trigger_data));
+
+    jack_ringbuffer_write(inport->rec_rb, (const char*) &msg, sizeof(record_msg_t));
+
+}
+
+static bool inport_thru_map(sq_inport_t inport, jack_midi_event_t *ev, midiEvent *mev) {
+
+    // applies the channel remap and transpose to a channel message.
+    // returns false if the event should not be passed through
+
+    unsigned char type, channel;
+    int note;
+    uint16_t *sounding;
+
+    // channel messages only (no sysex or realtime)
+    if ((ev->size < 2) || (ev->size > 3)) return false;
+    if ((ev->buffer[0] < 0x80) || (ev->buffer[0] >= 0xF0)) return false;
+
+    type = ev->buffer[0] & 0xF0;
+    channel = ev->buffer[0] & 0x0F;
+
+    mev->type = MEV_TYPE_THRU;
+    mev->time = ev->time;
+    mev->length = 0;
+    mev->fanout = 0;
+    mev->size = ev->size;
+    mev->status = ev->buffer[0];
+    mev->data1 = ev->buffer[1];
+    mev->data2 = (ev->size > 2) ? ev->buffer[2] : 0;
+
+    if (inport->thru_channel) {
+        mev->status = type | (inport->thru_channel - 1);
+    }
+
+    if ((type == 0x80) || (type == 0x90) || (type == 0xA0)) {
+
+        // sounding notes remember how they were mapped, so that changing the
+        // channel or transpose while a note is held can't leave it stuck
+        sounding = &inport->thru_notes[channel][ev->buffer[1] & 0x7F];
+
+        if (*sounding) {
+            mev->status = type | ((*sounding >> 7) & 0x0F);
+            mev->data1 = *sounding & 0x7F;
+        } else {
+            note = ev->buffer[1] + inport->thru_transpose;
+            if ((note < 0) || (note > 127)) return false;
+            mev->data1 = note;
+        }
+
+        if ((type == 0x90) && mev->data2) {
+            *sounding = 0x8000 | ((mev->status & 0x0F) << 7) | mev->data1;
+        } else if (type != 0xA0) {
+            *sounding = 0;
+        }
+
+    }
+
+    return true;
+
+}
@@ -0,0 +1,768 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sequoia/journal.h"
+#include "sequoia/session.h"
+#include "sequoia/snapshot.h"
+
+// LOCAL DECLARATIONS
+
+#define JOURNAL_FNV_OFFSET 14695981039346656037ULL
+#define JOURNAL_FNV_PRIME 1099511628211ULL
+
+#define JOURNAL_RECORD_SIZE(member) \
+    (offsetof(journal_record_t, v) + sizeof(((journal_record_t*) 0)->v.member))
+
+static char *journal_path_with(const char*, const char*);
+static int journal_index(journal_t*, sq_sequence_t);
+static void journal_push(sq_session_t, journal_record_t*, size_t);
+static void journal_drain(journal_t*);
+static int journal_swap(journal_t*, snapshot_t*);
+static int journal_hash_file(const char*, uint64_t*);
+static int journal_sync_file(const char*);
+static void *journal_thread_main(void*);
+static bool journal_apply(sq_session_t, const journal_record_t*);
+static void journal_apply_param(sq_sequence_t, int, int);
+static sq_sequence_t journal_seq(sq_session_t, int);
+
+// PUBLIC CODE
+
+journal_t *journal_new(const char *path, bool binary, sq_sequence_t *seqs, int nseqs) {
+
+    // starts the writer thread. nothing is written until the session
+    // queues its first snapshot
+
+    journal_t *journal = malloc(sizeof(journal_t));
+
+    journal->path = journal_path_with(path, "");
+    journal->tmp_path = journal_path_with(path, ".tmp");
+    journal->journal_path = journal_path_with(path, ".journal");
+    journal->journal_tmp_path = journal_path_with(path, ".journal.tmp");
+    journal->binary = binary;
+
+    journal->fp = NULL;
+    journal->nbytes = 0;
+    journal->seqs = malloc(SESSION_MAX_NSEQ * sizeof(sq_sequence_t));
+    memcpy(journal->seqs, seqs, nseqs * sizeof(sq_sequence_t));
+    journal->nseqs = nseqs;
+
+    journal->rb = jack_ringbuffer_create(JOURNAL_NRECORDS * sizeof(journal_record_t));
+    atomic_init(&journal->running, true);
+    atomic_init(&journal->swapping, false);
+    journal->swapped = true;
+    journal->snapshot = NULL;
+
+    if (pthread_create(&journal->thread, NULL, journal_thread_main, journal)) {
+        fprintf(stderr, "failed to start journal thread\n");
+        exit(1);
+    }
+
+    return journal;
+
+}
+
+void journal_delete(journal_t *journal) {
+
+    // stops the writer thread, which writes anything still queued on its way out
+
+    atomic_store(&journal->running, false);
+    pthread_join(journal->thread, NULL);
+
+    if (journal->snapshot) {
+        snapshot_delete(journal->snapshot);
+    }
+    if (journal->fp) {
+        fclose(journal->fp);
+    }
+
+    jack_ringbuffer_free(journal->rb);
+    free(journal->seqs);
+    free(journal->journal_tmp_path);
+    free(journal->journal_path);
+    free(journal->tmp_path);
+    free(journal->path);
+    free(journal);
+
+}
+
+void journal_trig(sq_session_t sesh, sq_sequence_t seq, int step, sq_trigger_t trig) {
+
+    journal_record_t rec;
+
+    if (!sesh || !sesh->journal || (step < 0) || (step >= seq->nsteps)) return;
+
+    rec.kind = JOURNAL_TRIG;
+    if ((rec.seq = journal_index(sesh->journal, seq)) < 0) return;
+    rec.v.trig.step = step;
+    rec.v.trig.trig = *trig;
+
+    journal_push(sesh, &rec, JOURNAL_RECORD_SIZE(trig));
+
+}
+
+void journal_param(sq_session_t sesh, sq_sequence_t seq, enum sequence_param param, int value) {
+
+    journal_record_t rec;
+
+    if (!sesh || !sesh->journal) return;
+
+    rec.kind = JOURNAL_PARAM;
+    if ((rec.seq = journal_index(sesh->journal, seq)) < 0) return;
+    rec.v.param.param = param;
+    rec.v.param.value = value;
+
+    journal_push(sesh, &rec, JOURNAL_RECORD_SIZE(param));
+
+}
+
+void journal_name(sq_session_t sesh, sq_sequence_t seq, const char *name) {
+
+    journal_record_t rec;
+    size_t len;
+
+    if (!sesh || !sesh->journal) return;
+
+    rec.kind = JOURNAL_NAME;
+    if ((rec.seq = journal_index(sesh->journal, seq)) < 0) return;
+    len = strlen(name);
+    if (len > SEQUENCE_MAX_NAME_LEN) {
+        len = SEQUENCE_MAX_NAME_LEN;
+    }
+    memcpy(rec.v.name, name, len);
+    rec.v.name[len] = '\0';
+
+    journal_push(sesh, &rec, offsetof(journal_record_t, v) + len + 1);
+
+}
+
+void journal_outport(sq_session_t sesh, sq_sequence_t seq, sq_outport_t outport) {
+
+    journal_record_t rec;
+
+    if (!sesh || !sesh->journal) return;
+
+    rec.kind = JOURNAL_OUTPORT;
+    if ((rec.seq = journal_index(sesh->journal, seq)) < 0) return;
+    rec.v.index = -1;
+    for (int i=0; i<sesh->noutports; i++) {
+        if (sesh->outports[i] == outport) {
+            rec.v.index = i;
+            break;
+        }
+    }
+
+    journal_push(sesh, &rec, JOURNAL_RECORD_SIZE(index));
+
+}
+
+void journal_fanout(sq_session_t sesh, sq_sequence_t seq, uint32_t fanout) {
+
+    // the whole mask, by the indices of the session's outports
+
+    journal_record_t rec;
+
+    if (!sesh || !sesh->journal) return;
+
+    rec.kind = JOURNAL_FANOUT;
+    if ((rec.seq = journal_index(sesh->journal, seq)) < 0) return;
+    rec.v.index = fanout;
+
+    journal_push(sesh, &rec, JOURNAL_RECORD_SIZE(index));
+
+}
+
+void journal_bpm(sq_session_t sesh, float bpm) {
+
+    journal_record_t rec;
+
+    if (!sesh->journal) return;
+
+    rec.kind = JOURNAL_BPM;
+    rec.seq = -1;
+    rec.v.bpm = bpm;
+
+    journal_push(sesh, &rec, JOURNAL_RECORD_SIZE(bpm));
+
+}
+
+void journal_add(sq_session_t sesh, sq_sequence_t seq) {
+
+    // a new sequence goes on the end, and then everything about it is
+    // journaled as edits to it: its parameters, and either the sequence it's
+    // linked to or its trigs. it's already been added, so a snapshot due
+    // now would have it, and must not be followed by the add
+
+    journal_t *journal = sesh->journal;
+    journal_record_t rec;
+    struct trigger_data trig;
+    int link = -1;
+
+    if (!journal || (journal->nseqs == SESSION_MAX_NSEQ)) return;
+
+    if (journal->nbytes >= JOURNAL_COMPACT_SIZE) {
+        journal->seqs[journal->nseqs++] = seq;
+        session_compact_journal(sesh);
+        return;
+    }
+
+    rec.kind = JOURNAL_ADD;
+    rec.seq = -1;
+    rec.v.index = seq->nsteps;
+    journal_push(sesh, &rec, JOURNAL_RECORD_SIZE(index));
+    journal->seqs[journal->nseqs++] = seq;
+
+    journal_name(sesh, seq, seq->name);
+    journal_param(sesh, seq, SEQUENCE_TRANSPOSE, sq_sequence_get_transpose(seq));
+    journal_param(sesh, seq, SEQUENCE_DIV, sq_sequence_get_clockdivide(seq));
+    journal_param(sesh, seq, SEQUENCE_FIRST, sq_sequence_get_first(seq));
+    journal_param(sesh, seq, SEQUENCE_LAST, sq_sequence_get_last(seq));
+    journal_param(sesh, seq, SEQUENCE_MOTION, sq_sequence_get_motion(seq));
+    journal_param(sesh, seq, SEQUENCE_MUTE, sq_sequence_get_mute(seq));
+    journal_outport(sesh, seq, seq->outport);
+    if (seq->fanout) {
+        journal_fanout(sesh, seq, seq->fanout);
+    }
+
+    if (sq_sequence_is_linked(seq)) {
+        for (int i=0; i<journal->nseqs - 1; i++) {
+            if (journal->seqs[i]->pattern == seq->pattern) {
+                link = i;
+                break;
+            }
+        }
+    }
+
+    if (link >= 0) {
+        rec.kind = JOURNAL_LINK;
+        rec.seq = journal_index(journal, seq);
+        rec.v.index = link;
+        journal_push(sesh, &rec, JOURNAL_RECORD_SIZE(index));
+    } else {
+        for (int i=0; i<seq->nsteps; i++) {
+            pattern_read(seq->pattern, i, 1, &trig);
+            if (!trigger_is_default(&trig)) {
+                journal_trig(sesh, seq, i, &trig);
+            }
+        }
+    }
+
+}
+
+void journal_rm(sq_session_t sesh, sq_sequence_t seq) {
+
+    journal_t *journal = sesh->journal;
+    journal_record_t rec;
+
+    if (!journal) return;
+
+    rec.kind = JOURNAL_RM;
+    if ((rec.seq = journal_index(journal, seq)) < 0) return;
+    journal_push(sesh, &rec, offsetof(journal_record_t, v));
+
+    journal->nseqs--;
+    for (int i=rec.seq; i<journal->nseqs; i++) {
+        journal->seqs[i] = journal->seqs[i+1];
+    }
+
+}
+
+void journal_unlink(sq_session_t sesh, sq_sequence_t seq) {
+
+    journal_record_t rec;
+
+    if (!sesh || !sesh->journal) return;
+
+    rec.kind = JOURNAL_UNLINK;
+    if ((rec.seq = journal_index(sesh->journal, seq)) < 0) return;
+
+    journal_push(sesh, &rec, offsetof(journal_record_t, v));
+
+}
+
+void journal_history(sq_session_t sesh, size_t from, size_t to, bool undo) {
+
+    // journals the values an undo or redo of records [from, to) has just
+    // set, in the order it set them. swing isn't saved, so it isn't
+    // journaled either
+
+    history_record_t *hrec;
+
+    if (!sesh->journal) return;
+
+    for (size_t i=0; i<to-from; i++) {
+        hrec = sesh->history->recs + (undo ? to - 1 - i : from + i);
+        if (hrec->param == SEQUENCE_SET_TRIG) {
+            journal_trig(sesh, hrec->seq, hrec->step, undo ? &hrec->v.t.before : &hrec->v.t.after);
+        } else if ((hrec->param != SEQUENCE_SWING) && (hrec->param != SEQUENCE_SWING_TYPE)) {
+            journal_param(sesh, hrec->seq, hrec->param, undo ? hrec->v.i.before : hrec->v.i.after);
+        }
+    }
+
+}
+
+void journal_reset_seqs(journal_t *journal, sq_sequence_t *seqs, int nseqs) {
+
+    memcpy(journal->seqs, seqs, nseqs * sizeof(sq_sequence_t));
+    journal->nseqs = nseqs;
+
+}
+
+bool journal_wait_snapshot(journal_t *journal) {
+
+    while (atomic_load(&journal->swapping)) {
+        usleep(1000);
+    }
+
+    if (journal->snapshot) {
+        snapshot_delete(journal->snapshot);
+        journal->snapshot = NULL;
+    }
+
+    return journal->swapped;
+
+}
+
+void journal_snapshot(journal_t *journal, snapshot_t *snapshot) {
+
+    journal_record_t rec;
+
+    journal->snapshot = snapshot;
+    atomic_store(&journal->swapping, true);
+
+    rec.kind = JOURNAL_SNAPSHOT;
+    rec.seq = -1;
+    rec.v.snapshot = snapshot;
+    rec.size = JOURNAL_RECORD_SIZE(snapshot);
+
+    while (jack_ringbuffer_write_space(journal->rb) < sizeof(journal_record_t)) {
+        usleep(1000);
+    }
+    jack_ringbuffer_write(journal->rb, (const char*) &rec, sizeof(journal_record_t));
+
+    journal->nbytes = 0;
+
+}
+
+uint64_t journal_hash(const char *buf, size_t size) {
+
+    // FNV-1a
+
+    uint64_t hash = JOURNAL_FNV_OFFSET;
+
+    for (size_t i=0; i<size; i++) {
+        hash ^= (unsigned char) buf[i];
+        hash *= JOURNAL_FNV_PRIME;
+    }
+
+    return hash;
+
+}
+
+
+int journal_replay(sq_session_t sesh, const char *path, const char *snapshot, size_t size) {
+
+    // a journal that doesn't follow on from this snapshot is left alone: it
+    // was either overtaken by the snapshot, or belongs to another one. a
+    // record cut short by a crash, or that doesn't match its hash, ends
+    // the replay
+
+    char *journal_path = journal_path_with(path, ".journal");
+    const struct journal_header *hdr;
+    journal_record_t rec;
+    uint64_t check;
+    int fd, n = 0;
+    struct stat st;
+    char *map;
+    size_t pos;
+
+    fd = open(journal_path, O_RDONLY);
+    free(journal_path);
+    if (fd < 0) {
+        return 0;
+    }
+
+    if ((fstat(fd, &st) < 0) || (st.st_size < sizeof(struct journal_header))) {
+        close(fd);
+        return 0;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+
+    hdr = (const struct journal_header*) map;
+    if (memcmp(hdr->magic, JOURNAL_MAGIC, sizeof(hdr->magic)) || (hdr->version != JOURNAL_VERSION)
+            || (hdr->snapshot != journal_hash(snapshot, size))) {
+        munmap(map, st.st_size);
+        return 0;
+    }
+
+    pos = sizeof(struct journal_header);
+    while (pos + offsetof(journal_record_t, v) <= st.st_size) {
+        // records are packed back to back, so copy each one out to align it
+        memcpy(&rec, map + pos, offsetof(journal_record_t, v));
+        if ((rec.size < offsetof(journal_record_t, v)) || (rec.size > sizeof(journal_record_t))
+                || (pos + rec.size > st.st_size)) {
+            break;
+        }
+        memcpy(&rec, map + pos, rec.size);
+        check = rec.check;
+        rec.check = 0;
+        if ((journal_hash((const char*) &rec, rec.size) != check) || !journal_apply(sesh, &rec)) {
+            break;
+        }
+        pos += rec.size;
+        n++;
+    }
+
+    munmap(map, st.st_size);
+
+    return n;
+
+}
+
+// LOCAL CODE
+
+static char *journal_path_with(const char *path, const char *suffix) {
+
+    char *s = malloc(strlen(path) + strlen(suffix) + 1);
+
+    strcpy(s, path);
+    strcat(s, suffix);
+
+    return s;
+
+}
+
+static int journal_index(journal_t *journal, sq_sequence_t seq) {
+
+    for (int i=0; i<journal->nseqs; i++) {
+        if (journal->seqs[i] == seq) {
+            return i;
+        }
+    }
+
+    return -1;
+
+}
+
+static void journal_push(sq_session_t sesh, journal_record_t *rec, size_t size) {
+
+    // the edit being journaled hasn't been made yet, so if the journal is
+    // due a new snapshot, the snapshot goes before it. the UI thread can
+    // afford to wait on a full ring, and a dropped record would be a lost edit
+
+    journal_t *journal = sesh->journal;
+
+    if (journal->nbytes >= JOURNAL_COMPACT_SIZE) {
+        session_compact_journal(sesh);
+    }
+
+    rec->size = size;
+
+    while (jack_ringbuffer_write_space(journal->rb) < sizeof(journal_record_t)) {
+        usleep(1000);
+    }
+    jack_ringbuffer_write(journal->rb, (const char*) rec, sizeof(journal_record_t));
+
+    journal->nbytes += size;
+
+}
+
+static void journal_drain(journal_t *journal) {
+
+    // appends the queued records to the journal, and makes sure they're on
+    // disk before going back to sleep
+
+    journal_record_t rec;
+    bool written = false;
+
+    while (jack_ringbuffer_read_space(journal->rb) >= sizeof(journal_record_t)) {
+        jack_ringbuffer_read(journal->rb, (char*) &rec, sizeof(journal_record_t));
+        if (rec.kind == JOURNAL_SNAPSHOT) {
+            journal->swapped = (journal_swap(journal, rec.v.snapshot) == 0);
+            atomic_store(&journal->swapping, false);
+            written = false;
+        } else if (journal->fp) {
+            rec.check = 0;
+            rec.check = journal_hash((const char*) &rec, rec.size);
+            fwrite(&rec, rec.size, 1, journal->fp);
+            written = true;
+        }
+    }
+
+    if (written && (fflush(journal->fp) || fsync(fileno(journal->fp)))) {
+        fprintf(stderr, "failed to write %s\n", journal->journal_path);
+    }
+
+}
+
+static int journal_swap(journal_t *journal, snapshot_t *snapshot) {
+
+    // writes out the new snapshot, starts a new journal after it, and moves
+    // both into place. if anything fails, the old snapshot and journal
+    // carry on
+
+    struct journal_header hdr;
+    uint64_t hash;
+    FILE *fp;
+
+    if ((session_save_file(&snapshot->sesh, journal->tmp_path, journal->binary) < 0)
+            || (journal_hash_file(journal->tmp_path, &hash) < 0)
+            || (journal_sync_file(journal->tmp_path) < 0)) {
+        fprintf(stderr, "failed to write %s\n", journal->tmp_path);
+        return -1;
+    }
+
+    memcpy(hdr.magic, JOURNAL_MAGIC, sizeof(hdr.magic));
+    hdr.version = JOURNAL_VERSION;
+    hdr.snapshot = hash;
+
+    fp = fopen(journal->journal_tmp_path, "wb");
+    if (!fp) {
+        fprintf(stderr, "failed to open %s for writing\n", journal->journal_tmp_path);
+        return -1;
+    }
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+    if (fflush(fp) || fsync(fileno(fp))) {
+        fprintf(stderr, "failed to write %s\n", journal->journal_tmp_path);
+        fclose(fp);
+        return -1;
+    }
+
+    // the old journal no longer matches once the snapshot moves, so a crash
+    // from here until the next move just loses the (already saved) journal
+    if (rename(journal->tmp_path, journal->path)) {
+        fprintf(stderr, "failed to move %s into place\n", journal->tmp_path);
+        fclose(fp);
+        return -1;
+    }
+    if (rename(journal->journal_tmp_path, journal->journal_path)) {
+        fprintf(stderr, "failed to move %s into place\n", journal->journal_tmp_path);
+    }
+
+    if (journal->fp) {
+        fclose(journal->fp);
+    }
+    journal->fp = fp;
+
+    return 0;
+
+}
+
+static int journal_hash_file(const char *path, uint64_t *hash) {
+
+    int fd;
+    struct stat st;
+    char *map;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if ((fstat(fd, &st) < 0) || (st.st_size == 0)) {
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    *hash = journal_hash(map, st.st_size);
+    munmap(map, st.st_size);
+
+    return 0;
+
+}
+
+static int journal_sync_file(const char *path) {
+
+    int fd, ret;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    ret = fsync(fd);
+    close(fd);
+
+    return ret;
+
+}
+
+static void *journal_thread_main(void *arg) {
+
+    journal_t *journal = arg;
+
+    while (atomic_load(&journal->running)) {
+        journal_drain(journal);
+        usleep(JOURNAL_POLL_US);
+    }
+
+    journal_drain(journal);
+
+    return NULL;
+
+}
+
+static bool journal_apply(sq_session_t sesh, const journal_record_t *rec) {
+
+    // makes the edit through the public API, as it was made in the first
+    // place. returns false for a record that can't be right
+
+    sq_sequence_t seq = NULL;
+
+    if ((rec->kind != JOURNAL_BPM) && (rec->kind != JOURNAL_ADD)) {
+        if (!(seq = journal_seq(sesh, rec->seq))) {
+            return false;
+        }
+    }
+
+    switch (rec->kind) {
+        case JOURNAL_TRIG:
+            if ((rec->size != JOURNAL_RECORD_SIZE(trig))
+                    || (rec->v.trig.step < 0) || (rec->v.trig.step >= seq->nsteps)
+                    || !trigger_is_valid((sq_trigger_t) &rec->v.trig.trig)) {
+                return false;
+            }
+            sq_sequence_set_trig(seq, rec->v.trig.step, (sq_trigger_t) &rec->v.trig.trig);
+            break;
+        case JOURNAL_PARAM:
+            journal_apply_param(seq, rec->v.param.param, rec->v.param.value);
+            break;
+        case JOURNAL_NAME:
+            if (!memchr(rec->v.name, '\0', rec->size - offsetof(journal_record_t, v))) {
+                return false;
+            }
+            sq_sequence_set_name(seq, rec->v.name);
+            break;
+        case JOURNAL_OUTPORT:
+            if ((rec->v.index < -1) || (rec->v.index >= (int) sesh->noutports)) {
+                return false;
+            }
+            sq_sequence_set_outport(seq, (rec->v.index < 0) ? NULL : sesh->outports[rec->v.index]);
+            break;
+        case JOURNAL_FANOUT:
+            if ((uint32_t) rec->v.index >> sesh->noutports) {
+                return false;
+            }
+            for (int i=0; i<sesh->noutports; i++) {
+                if (rec->v.index & (1u << i)) {
+                    sq_sequence_add_fanout(seq, sesh->outports[i]);
+                } else {
+                    sq_sequence_rm_fanout(seq, sesh->outports[i]);
+                }
+            }
+            break;
+        case JOURNAL_BPM:
+            sq_session_set_bpm(sesh, rec->v.bpm);
+            break;
+        case JOURNAL_ADD:
+            if ((rec->v.index <= 0) || (rec->v.index > SEQUENCE_MAX_NSTEPS)
+                    || (sesh->nseqs == SESSION_MAX_NSEQ)) {
+                return false;
+            }
+            sq_session_add_sequence(sesh, sq_session_new_sequence(sesh, rec->v.index));
+            break;
+        case JOURNAL_RM:
+            // inports can't be told about it, since their settings aren't
+            // journaled, so they just lose it
+            for (int i=0; i<sesh->ninports; i++) {
+                sq_inport_t inport = sesh->inports[i];
+                int n = 0;
+                for (int j=0; j<inport->nseqs; j++) {
+                    if (inport->seqs[j] != seq) {
+                        inport->seqs[n++] = inport->seqs[j];
+                    }
+                }
+                inport->nseqs = n;
+            }
+            sq_session_rm_sequence(sesh, seq);
+            sq_sequence_delete(seq);
+            break;
+        case JOURNAL_LINK:
+            if (!journal_seq(sesh, rec->v.index)) {
+                return false;
+            }
+            sequence_link_pattern(seq, journal_seq(sesh, rec->v.index));
+            break;
+        case JOURNAL_UNLINK:
+            sq_sequence_unlink(seq);
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+
+}
+
+static void journal_apply_param(sq_sequence_t seq, int param, int value) {
+
+    switch (param) {
+        case SEQUENCE_CLEAR_TRIG:
+            sq_sequence_clear_trig(seq, value);
+            break;
+        case SEQUENCE_TRANSPOSE:
+            sq_sequence_set_transpose(seq, value);
+            break;
+        case SEQUENCE_DIV:
+            sq_sequence_set_clockdivide(seq, value);
+            break;
+        case SEQUENCE_MUTE:
+            sq_sequence_set_mute(seq, value);
+            break;
+        case SEQUENCE_FIRST:
+            sq_sequence_set_first(seq, value);
+            break;
+        case SEQUENCE_LAST:
+            sq_sequence_set_last(seq, value);
+            break;
+        case SEQUENCE_MOTION:
+            sq_sequence_set_motion(seq, value);
+            break;
+    }
+
+}
+
+static sq_sequence_t journal_seq(sq_session_t sesh, int i) {
+
+    return ((i >= 0) && (i < sesh->nseqs)) ? sesh->seqs[i] : NULL;
+
+}
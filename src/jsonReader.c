@@ -0,0 +1,445 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "sequoia/jsonReader.h"
+
+// LOCAL DECLARATIONS
+
+#define JSONREADER_MAX_DEPTH 64
+
+static void jsonReader_fail(jsonReader_t*, const char*);
+static void jsonReader_ws(jsonReader_t*);
+static bool jsonReader_expect(jsonReader_t*, char);
+static bool jsonReader_literal(jsonReader_t*, const char*);
+static void jsonReader_skip_depth(jsonReader_t*, int);
+static unsigned int jsonReader_hex4(jsonReader_t*);
+static size_t utf8_encode(char*, unsigned int);
+
+// PUBLIC CODE
+
+void jsonReader_init(jsonReader_t *jr, const char *buf) {
+
+    jr->buf = buf;
+    jr->p = buf;
+    jr->failed = false;
+    jr->str[0] = '\0';
+
+}
+
+bool jsonReader_begin_object(jsonReader_t *jr) {
+
+    return jsonReader_expect(jr, '{');
+
+}
+
+bool jsonReader_next_key(jsonReader_t *jr, const char **key) {
+
+    // moves on to the next member of the current object, and returns its
+    // key (valid until the next string is read). false at the end
+
+    if (jr->failed) return false;
+
+    jsonReader_ws(jr);
+    if (*jr->p == '}') {
+        jr->p++;
+        return false;
+    }
+    if (*jr->p == ',') {
+        jr->p++;
+        jsonReader_ws(jr);
+    }
+
+    if (*jr->p != '"') {
+        jsonReader_fail(jr, "expected a key");
+        return false;
+    }
+    *key = jsonReader_string(jr);
+
+    return jsonReader_expect(jr, ':');
+
+}
+
+bool jsonReader_begin_array(jsonReader_t *jr) {
+
+    return jsonReader_expect(jr, '[');
+
+}
+
+bool jsonReader_next_element(jsonReader_t *jr) {
+
+    // moves on to the next element of the current array. false at the end
+
+    if (jr->failed) return false;
+
+    jsonReader_ws(jr);
+    if (*jr->p == ']') {
+        jr->p++;
+        return false;
+    }
+    if (*jr->p == ',') {
+        jr->p++;
+    }
+
+    return true;
+
+}
+
+enum json_kind jsonReader_peek(jsonReader_t *jr) {
+
+    if (jr->failed) return JSON_INVALID;
+
+    jsonReader_ws(jr);
+    switch (*jr->p) {
+        case 'n':
+            return JSON_NULL;
+        case 't':
+        case 'f':
+            return JSON_BOOL;
+        case '"':
+            return JSON_STRING;
+        case '[':
+            return JSON_ARRAY;
+        case '{':
+            return JSON_OBJECT;
+        case '-':
+        case '0' ... '9':
+            return JSON_NUMBER;
+        default:
+            return JSON_INVALID;
+    }
+
+}
+
+double jsonReader_double(jsonReader_t *jr) {
+
+    // parsed by hand rather than with strtod, which depends on the locale.
+    // null reads as 0, for the NaNs and infinities the writer can't express
+
+    uint64_t mantissa = 0;
+    int exponent = 0, exp_sign = 1, exp_digits = 0, ndigits = 0;
+    double sign = 1.;
+
+    if (jr->failed) return 0.;
+
+    jsonReader_ws(jr);
+    if (*jr->p == 'n') {
+        jsonReader_literal(jr, "null");
+        return 0.;
+    }
+
+    if (*jr->p == '-') {
+        sign = -1.;
+        jr->p++;
+    }
+
+    if ((*jr->p < '0') || (*jr->p > '9')) {
+        jsonReader_fail(jr, "expected a number");
+        return 0.;
+    }
+
+    // digits beyond the 19th can't change a double much, so just scale
+    for (; (*jr->p >= '0') && (*jr->p <= '9'); jr->p++) {
+        if (ndigits++ < 19) {
+            mantissa = mantissa * 10 + (*jr->p - '0');
+        } else {
+            exponent++;
+        }
+    }
+    if (*jr->p == '.') {
+        for (jr->p++; (*jr->p >= '0') && (*jr->p <= '9'); jr->p++) {
+            if (ndigits++ < 19) {
+                mantissa = mantissa * 10 + (*jr->p - '0');
+                exponent--;
+            }
+        }
+    }
+    if ((*jr->p == 'e') || (*jr->p == 'E')) {
+        jr->p++;
+        if ((*jr->p == '-') || (*jr->p == '+')) {
+            exp_sign = (*jr->p == '-') ? -1 : 1;
+            jr->p++;
+        }
+        for (; (*jr->p >= '0') && (*jr->p <= '9'); jr->p++) {
+            if (exp_digits < 9) exp_digits = exp_digits * 10 + (*jr->p - '0');
+        }
+        exponent += exp_sign * exp_digits;
+    }
+
+    return sign * (exponent < 0 ? mantissa / pow(10., -exponent) : mantissa * pow(10., exponent));
+
+}
+
+int jsonReader_int(jsonReader_t *jr) {
+
+    return (int) jsonReader_double(jr);
+
+}
+
+bool jsonReader_bool(jsonReader_t *jr) {
+
+    if (jr->failed) return false;
+
+    jsonReader_ws(jr);
+    if (*jr->p == 't') {
+        return jsonReader_literal(jr, "true");
+    }
+    jsonReader_literal(jr, "false");
+
+    return false;
+
+}
+
+const char *jsonReader_string(jsonReader_t *jr) {
+
+    // decodes into jr->str, truncating anything too long for it
+
+    size_t len = 0;
+    char utf8[4];
+    size_t n;
+    unsigned int c, lo;
+
+    jr->str[0] = '\0';
+    if (!jsonReader_expect(jr, '"')) return jr->str;
+
+    while (*jr->p != '"') {
+
+        if (*jr->p == '\0') {
+            jsonReader_fail(jr, "unterminated string");
+            break;
+        }
+
+        if (*jr->p != '\\') {
+            utf8[0] = *jr->p++;
+            n = 1;
+        } else {
+            jr->p++;
+            n = 1;
+            switch (*jr->p++) {
+                case '"': utf8[0] = '"'; break;
+                case '\\': utf8[0] = '\\'; break;
+                case '/': utf8[0] = '/'; break;
+                case 'b': utf8[0] = '\b'; break;
+                case 'f': utf8[0] = '\f'; break;
+                case 'n': utf8[0] = '\n'; break;
+                case 'r': utf8[0] = '\r'; break;
+                case 't': utf8[0] = '\t'; break;
+                case 'u':
+                    c = jsonReader_hex4(jr);
+                    // a surrogate pair encodes one character above the BMP
+                    if ((c >= 0xD800) && (c < 0xDC00) && (jr->p[0] == '\\') && (jr->p[1] == 'u')) {
+                        jr->p += 2;
+                        lo = jsonReader_hex4(jr);
+                        c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+                    }
+                    n = utf8_encode(utf8, c);
+                    break;
+                default:
+                    jsonReader_fail(jr, "bad escape in string");
+                    return jr->str;
+            }
+        }
+
+        if (len + n < JSONREADER_MAX_STRING) {
+            memcpy(jr->str + len, utf8, n);
+            len += n;
+        }
+
+    }
+
+    jr->str[len] = '\0';
+    if (!jr->failed) jr->p++;     // the closing quote
+
+    return jr->str;
+
+}
+
+void jsonReader_skip(jsonReader_t *jr) {
+
+    jsonReader_skip_depth(jr, 0);
+
+}
+
+const char *jsonReader_tell(jsonReader_t *jr) {
+
+    return jr->p;
+
+}
+
+void jsonReader_seek(jsonReader_t *jr, const char *p) {
+
+    if (p) jr->p = p;
+
+}
+
+bool jsonReader_failed(jsonReader_t *jr) {
+
+    return jr->failed;
+
+}
+
+// LOCAL CODE
+
+static void jsonReader_fail(jsonReader_t *jr, const char *msg) {
+
+    int line = 1;
+
+    if (jr->failed) return;
+    jr->failed = true;
+
+    for (const char *q=jr->buf; q<jr->p; q++) {
+        if (*q == '\n') line++;
+    }
+    fprintf(stderr, "json: %s at line %d\n", msg, line);
+
+}
+
+static void jsonReader_ws(jsonReader_t *jr) {
+
+    while ((*jr->p == ' ') || (*jr->p == '\n') || (*jr->p == '\t') || (*jr->p == '\r')) {
+        jr->p++;
+    }
+
+}
+
+static bool jsonReader_expect(jsonReader_t *jr, char c) {
+
+    if (jr->failed) return false;
+
+    jsonReader_ws(jr);
+    if (*jr->p != c) {
+        char msg[16];
+        snprintf(msg, sizeof(msg), "expected '%c'", c);
+        jsonReader_fail(jr, msg);
+        return false;
+    }
+    jr->p++;
+
+    return true;
+
+}
+
+static bool jsonReader_literal(jsonReader_t *jr, const char *lit) {
+
+    size_t n = strlen(lit);
+
+    if (strncmp(jr->p, lit, n)) {
+        jsonReader_fail(jr, "bad literal");
+        return false;
+    }
+    jr->p += n;
+
+    return true;
+
+}
+
+static void jsonReader_skip_depth(jsonReader_t *jr, int depth) {
+
+    const char *key;
+
+    if (depth > JSONREADER_MAX_DEPTH) {
+        jsonReader_fail(jr, "nested too deep");
+        return;
+    }
+
+    switch (jsonReader_peek(jr)) {
+        case JSON_NULL:
+            jsonReader_literal(jr, "null");
+            break;
+        case JSON_BOOL:
+            jsonReader_bool(jr);
+            break;
+        case JSON_NUMBER:
+            jsonReader_double(jr);
+            break;
+        case JSON_STRING:
+            jsonReader_string(jr);
+            break;
+        case JSON_ARRAY:
+            jsonReader_begin_array(jr);
+            while (jsonReader_next_element(jr)) {
+                jsonReader_skip_depth(jr, depth + 1);
+            }
+            break;
+        case JSON_OBJECT:
+            jsonReader_begin_object(jr);
+            while (jsonReader_next_key(jr, &key)) {
+                jsonReader_skip_depth(jr, depth + 1);
+            }
+            break;
+        default:
+            jsonReader_fail(jr, "expected a value");
+            break;
+    }
+
+}
+
+static unsigned int jsonReader_hex4(jsonReader_t *jr) {
+
+    unsigned int c = 0;
+
+    for (int i=0; i<4; i++, jr->p++) {
+        c <<= 4;
+        if ((*jr->p >= '0') && (*jr->p <= '9')) {
+            c |= *jr->p - '0';
+        } else if ((*jr->p >= 'a') && (*jr->p <= 'f')) {
+            c |= *jr->p - 'a' + 10;
+        } else if ((*jr->p >= 'A') && (*jr->p <= 'F')) {
+            c |= *jr->p - 'A' + 10;
+        } else {
+            jsonReader_fail(jr, "bad \\u escape");
+            return '?';
+        }
+    }
+
+    return c;
+
+}
+
+static size_t utf8_encode(char *out, unsigned int c) {
+
+    if (c < 0x80) {
+        out[0] = c;
+        return 1;
+    } else if (c < 0x800) {
+        out[0] = 0xC0 | (c >> 6);
+        out[1] = 0x80 | (c & 0x3F);
+        return 2;
+    } else if (c < 0x10000) {
+        out[0] = 0xE0 | (c >> 12);
+        out[1] = 0x80 | ((c >> 6) & 0x3F);
+        out[2] = 0x80 | (c & 0x3F);
+        return 3;
+    } else {
+        out[0] = 0xF0 | (c >> 18);
+        out[1] = 0x80 | ((c >> 12) & 0x3F);
+        out[2] = 0x80 | ((c >> 6) & 0x3F);
+        out[3] = 0x80 | (c & 0x3F);
+        return 4;
+    }
+
+}
@@ -0,0 +1,231 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <stdio.h>
+#include <math.h>
+
+#include "sequoia/jsonWriter.h"
+
+// LOCAL DECLARATIONS
+
+static void jsonWriter_key(jsonWriter_t*, const char*);
+static void jsonWriter_open(jsonWriter_t*, const char*, char);
+static void jsonWriter_close(jsonWriter_t*, char);
+static void jsonWriter_indent(jsonWriter_t*);
+static void jsonWriter_escaped(jsonWriter_t*, const char*);
+
+// PUBLIC CODE
+
+void jsonWriter_init(jsonWriter_t *jw, FILE *fp) {
+
+    jw->fp = fp;
+    jw->depth = 0;
+    jw->empty[0] = true;
+    jw->compact = 0;
+
+}
+
+void jsonWriter_begin_object(jsonWriter_t *jw, const char *key) {
+
+    jsonWriter_open(jw, key, '{');
+
+}
+
+void jsonWriter_begin_compact_object(jsonWriter_t *jw, const char *key) {
+
+    // an object written on one line, along with anything nested in it
+
+    int depth = jw->depth;
+
+    jsonWriter_open(jw, key, '{');
+    if (!jw->compact && (jw->depth > depth)) {
+        jw->compact = jw->depth;
+    }
+
+}
+
+void jsonWriter_end_object(jsonWriter_t *jw) {
+
+    jsonWriter_close(jw, '}');
+
+}
+
+void jsonWriter_begin_array(jsonWriter_t *jw, const char *key) {
+
+    jsonWriter_open(jw, key, '[');
+
+}
+
+void jsonWriter_end_array(jsonWriter_t *jw) {
+
+    jsonWriter_close(jw, ']');
+
+}
+
+void jsonWriter_int(jsonWriter_t *jw, const char *key, int value) {
+
+    jsonWriter_key(jw, key);
+    fprintf(jw->fp, "%d", value);
+
+}
+
+void jsonWriter_double(jsonWriter_t *jw, const char *key, double value) {
+
+    // enough digits for a float to read back exactly. JSON has no NaN or
+    // infinity, so those are written as null
+
+    char buf[32];
+
+    jsonWriter_key(jw, key);
+    if (isfinite(value)) {
+        // a locale may have made the decimal point a comma
+        snprintf(buf, sizeof(buf), "%.9g", value);
+        for (char *c=buf; *c; c++) {
+            if (*c == ',') *c = '.';
+        }
+        fputs(buf, jw->fp);
+    } else {
+        fputs("null", jw->fp);
+    }
+
+}
+
+void jsonWriter_bool(jsonWriter_t *jw, const char *key, bool value) {
+
+    jsonWriter_key(jw, key);
+    fputs(value ? "true" : "false", jw->fp);
+
+}
+
+void jsonWriter_string(jsonWriter_t *jw, const char *key, const char *value) {
+
+    jsonWriter_key(jw, key);
+    jsonWriter_escaped(jw, value);
+
+}
+
+void jsonWriter_null(jsonWriter_t *jw, const char *key) {
+
+    jsonWriter_key(jw, key);
+    fputs("null", jw->fp);
+
+}
+
+// LOCAL CODE
+
+static void jsonWriter_key(jsonWriter_t *jw, const char *key) {
+
+    // the separator and indent for the next value, and its key if any
+
+    bool first = jw->empty[jw->depth];
+
+    if (!first) {
+        fputc(',', jw->fp);
+    }
+    jw->empty[jw->depth] = false;
+
+    if (jw->compact && (jw->depth >= jw->compact)) {
+        if (!first) {
+            fputc(' ', jw->fp);
+        }
+    } else if (jw->depth > 0) {
+        jsonWriter_indent(jw);
+    }
+
+    if (key) {
+        jsonWriter_escaped(jw, key);
+        fputs(": ", jw->fp);
+    }
+
+}
+
+static void jsonWriter_open(jsonWriter_t *jw, const char *key, char bracket) {
+
+    if (jw->depth + 1 >= JSONWRITER_MAX_DEPTH) {
+        fprintf(stderr, "jsonWriter: nested too deep\n");
+        return;
+    }
+
+    jsonWriter_key(jw, key);
+    fputc(bracket, jw->fp);
+
+    jw->depth++;
+    jw->empty[jw->depth] = true;
+
+}
+
+static void jsonWriter_close(jsonWriter_t *jw, char bracket) {
+
+    bool empty = jw->empty[jw->depth];
+    bool compact = jw->compact && (jw->depth >= jw->compact);
+
+    if (jw->depth == 0) return;
+
+    jw->depth--;
+    if (!empty && !compact) {
+        jsonWriter_indent(jw);
+    }
+    fputc(bracket, jw->fp);
+
+    if (jw->depth < jw->compact) {
+        jw->compact = 0;
+    }
+
+    if (jw->depth == 0) {
+        fputc('\n', jw->fp);
+    }
+
+}
+
+static void jsonWriter_indent(jsonWriter_t *jw) {
+
+    fputc('\n', jw->fp);
+    for (int i=0; i<jw->depth; i++) {
+        fputs("  ", jw->fp);
+    }
+
+}
+
+static void jsonWriter_escaped(jsonWriter_t *jw, const char *s) {
+
+    fputc('"', jw->fp);
+
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if ((c == '"') || (c == '\\')) {
+            fputc('\\', jw->fp);
+            fputc(c, jw->fp);
+        } else if (c == '\n') {
+            fputs("\\n", jw->fp);
+        } else if (c == '\t') {
+            fputs("\\t", jw->fp);
+        } else if (c < 0x20) {
+            fprintf(jw->fp, "\\u%04x", c);
+        } else {
+            fputc(c, jw->fp);
+        }
+    }
+
+    fputc('"', jw->fp);
+
+}
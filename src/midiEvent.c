@@ -21,51 +21,39 @@
 
 #include "sequoia/midiEvent.h"
 
-static void _merge(midiEvent *arr, size_t lenL, size_t lenR) {
+static void _merge(midiEvent *arr, size_t lenL, size_t lenR, midiEvent *tmp) {
 
     // L goes from arr[0,lenL)
     // R goes from arr[lenL,lenL+lenR)
 
+    // only L needs to be copied out: merging from the front, the write
+    // position never overtakes the next unread element of R
+
     size_t i, iL, iR;
-    midiEvent L[lenL], R[lenR];
-    midiEvent tvL, tvR;   // temp values
 
-    // copy into local temp arrays
     for (i=0; i<lenL; i++) {
-        L[i] = arr[i];
-    }
-    for (i=0; i<lenR; i++) {
-        R[i] = arr[lenL + i];
+        tmp[i] = arr[i];
     }
 
-    // fill the original array with ordered data from the temp arrays
-    iL=0;
-    iR=0;
-    for (i=0; i<(lenL+lenR); i++) {
-
-        if (iL >= lenL) {
-            arr[i] = R[iR];
-            iR++;
-        } else if (iR >= lenR) {
-            arr[i] = L[iL];
-            iL++;
+    // fill the original array with ordered data
+    iL = 0;
+    iR = lenL;
+    i = 0;
+    while (iL < lenL) {
+        if ((iR < lenL + lenR) && (arr[iR].time < tmp[iL].time)) {
+            arr[i++] = arr[iR++];
         } else {
-            tvL = L[iL];
-            tvR = R[iR];
-            if (tvL.time <= tvR.time) {
-                arr[i] = tvL;
-                iL++;
-            } else {
-                arr[i] = tvR;
-                iR++;
-            }
+            arr[i++] = tmp[iL++];   // ties go to L, which keeps the sort stable
         }
-
     }
+    // whatever is left of R is already in place
 
 }
 
-void midiEvent_sort(midiEvent *arr, size_t len) {
+void midiEvent_sort(midiEvent *arr, size_t len, midiEvent *tmp) {
+
+    // merge sort, with no allocation (not even on the stack, which is what
+    // it used to do, with VLAs): tmp must hold at least len/2 events
 
     size_t lenL, lenR;
 
@@ -74,10 +62,9 @@ void midiEvent_sort(midiEvent *arr, size_t len) {
     lenL = len / 2;
     lenR = len - lenL;
 
-    midiEvent_sort(arr, lenL);
-    midiEvent_sort(arr + lenL, lenR);
+    midiEvent_sort(arr, lenL, tmp);
+    midiEvent_sort(arr + lenL, lenR, tmp);
 
-    _merge(arr, lenL, lenR);
+    _merge(arr, lenL, lenR, tmp);
 
 }
-
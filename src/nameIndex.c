@@ -0,0 +1,217 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sequoia/nameIndex.h"
+
+// LOCAL DECLARATIONS
+
+#define NAMEINDEX_MIN_SIZE 64
+#define NAMEINDEX_FNV_OFFSET 2166136261u
+#define NAMEINDEX_FNV_PRIME 16777619u
+
+static uint32_t nameIndex_hash(const char*);
+static size_t nameIndex_slot(nameIndex_t*, const char*, void*);
+static void nameIndex_put(nameIndex_t*, const char*, void*, uint32_t, uint32_t);
+static void nameIndex_take(nameIndex_t*, size_t);
+static void nameIndex_grow(nameIndex_t*);
+
+// PUBLIC CODE
+
+void nameIndex_init(nameIndex_t *index) {
+
+    index->entries = calloc(NAMEINDEX_MIN_SIZE, sizeof(nameIndex_entry_t));
+    index->size = NAMEINDEX_MIN_SIZE;
+    index->count = 0;
+    index->next_order = 0;
+
+}
+
+void nameIndex_free(nameIndex_t *index) {
+
+    free(index->entries);
+    index->entries = NULL;
+
+}
+
+void nameIndex_insert(nameIndex_t *index, const char *name, void *item) {
+
+    // kept at most half full, so that the probe sequences stay short
+
+    if (2 * (index->count + 1) > index->size) {
+        nameIndex_grow(index);
+    }
+
+    nameIndex_put(index, name, item, nameIndex_hash(name), index->next_order++);
+
+}
+
+void nameIndex_remove(nameIndex_t *index, const char *name, void *item) {
+
+    size_t slot = nameIndex_slot(index, name, item);
+
+    if (slot < index->size) {
+        nameIndex_take(index, slot);
+    }
+
+}
+
+void nameIndex_rekey(nameIndex_t *index, const char *old_name, void *item) {
+
+    // for after the item's name has changed from old_name. it keeps its
+    // place among items of the same name
+
+    size_t slot = nameIndex_slot(index, old_name, item);
+    nameIndex_entry_t entry;
+
+    if (slot < index->size) {
+        entry = index->entries[slot];
+        nameIndex_take(index, slot);
+        nameIndex_put(index, entry.name, item, nameIndex_hash(entry.name), entry.order);
+    }
+
+}
+
+void nameIndex_clear(nameIndex_t *index) {
+
+    memset(index->entries, 0, index->size * sizeof(nameIndex_entry_t));
+    index->count = 0;
+    index->next_order = 0;
+
+}
+
+void *nameIndex_find(nameIndex_t *index, const char *name) {
+
+    // the whole run of occupied slots from the name's home is searched,
+    // in case an item of the same name went in earlier
+
+    uint32_t hash = nameIndex_hash(name);
+    size_t mask = index->size - 1;
+    nameIndex_entry_t *entry, *found = NULL;
+
+    for (size_t i=hash & mask; index->entries[i].name; i=(i + 1) & mask) {
+        entry = index->entries + i;
+        if ((entry->hash == hash) && !strcmp(entry->name, name)
+                && (!found || (entry->order < found->order))) {
+            found = entry;
+        }
+    }
+
+    return found ? found->item : NULL;
+
+}
+
+// LOCAL CODE
+
+static uint32_t nameIndex_hash(const char *name) {
+
+    // 32-bit FNV-1a
+
+    uint32_t hash = NAMEINDEX_FNV_OFFSET;
+
+    for (; *name; name++) {
+        hash ^= (unsigned char) *name;
+        hash *= NAMEINDEX_FNV_PRIME;
+    }
+
+    return hash;
+
+}
+
+static size_t nameIndex_slot(nameIndex_t *index, const char *name, void *item) {
+
+    // where item is, going by name, or size if it isn't there
+
+    size_t mask = index->size - 1;
+
+    for (size_t i=nameIndex_hash(name) & mask; index->entries[i].name; i=(i + 1) & mask) {
+        if (index->entries[i].item == item) {
+            return i;
+        }
+    }
+
+    return index->size;
+
+}
+
+static void nameIndex_put(nameIndex_t *index, const char *name, void *item,
+                            uint32_t hash, uint32_t order) {
+
+    size_t mask = index->size - 1;
+    size_t i = hash & mask;
+
+    while (index->entries[i].name) {
+        i = (i + 1) & mask;
+    }
+
+    index->entries[i].name = name;
+    index->entries[i].item = item;
+    index->entries[i].hash = hash;
+    index->entries[i].order = order;
+    index->count++;
+
+}
+
+static void nameIndex_take(nameIndex_t *index, size_t slot) {
+
+    // empties slot, then moves back any entry further along the run that
+    // would no longer be found past the gap (so there are no tombstones)
+
+    size_t mask = index->size - 1;
+    size_t home;
+
+    for (size_t i=(slot + 1) & mask; index->entries[i].name; i=(i + 1) & mask) {
+        home = index->entries[i].hash & mask;
+        // entries whose home lies cyclically in (slot, i] stay where they are
+        if ((slot <= i) ? ((slot < home) && (home <= i)) : ((slot < home) || (home <= i))) {
+            continue;
+        }
+        index->entries[slot] = index->entries[i];
+        slot = i;
+    }
+
+    index->entries[slot].name = NULL;
+    index->entries[slot].item = NULL;
+    index->count--;
+
+}
+
+static void nameIndex_grow(nameIndex_t *index) {
+
+    nameIndex_entry_t *old = index->entries;
+    size_t old_size = index->size;
+
+    index->size *= 2;
+    index->entries = calloc(index->size, sizeof(nameIndex_entry_t));
+    index->count = 0;
+
+    for (size_t i=0; i<old_size; i++) {
+        if (old[i].name) {
+            nameIndex_put(index, old[i].name, old[i].item, old[i].hash, old[i].order);
+        }
+    }
+
+    free(old);
+
+}
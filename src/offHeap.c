@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "sequoia/offHeap.h"
+#include "sequoia/rtlog.h"
 
 offHeap_t *offHeap_new(size_t n) {
 
@@ -42,7 +43,7 @@ offNode_t *offHeap_alloc(offHeap_t *offHeap) {
 
     // check if avail queue is empty
     if (offHeap->savail == 0) {
-        fprintf(stderr, "offHeap_alloc: heap is full (queue is empty)\n");
+        rtlog_write("offHeap_alloc: heap is full (queue is empty)\n");
         return NULL;
     }
 
@@ -63,7 +64,7 @@ void offHeap_free(offHeap_t *offHeap, offNode_t *offNode) {
     // check if avail queue is full
     // (this shouldn't happen, unless you try to double-free something)
     if (offHeap->savail == offHeap->n) {
-        fprintf(stderr, "offHeap_alloc: heap is empty (queue is full)\n");
+        rtlog_write("offHeap_free: heap is empty (queue is full)\n");
         return;
     }
 
@@ -77,3 +78,16 @@ void offHeap_free(offHeap_t *offHeap, offNode_t *offNode) {
 
 }
 
+void offNode_append(offNode_t **list, offNode_t *offNode) {
+
+    // follow the linked list until next == NULL, and append the node there
+
+    while (*list) {
+        list = &((*list)->next);
+    }
+
+    offNode->next = NULL;
+    *list = offNode;
+
+}
+
@@ -19,6 +19,7 @@
 
 */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <jack/jack.h>
@@ -43,6 +44,11 @@ sq_outport_t sq_outport_new(const char *name) {
     outport->jack_client = NULL;
     outport->jack_port = NULL;
     outport->buf = NULL;
+    outport->names = NULL;
+    outport->index = -1;
+
+    atomic_init(&outport->stats.events, 0);
+    atomic_init(&outport->stats.reserve_fails, 0);
 
     return outport;
 
@@ -56,12 +62,19 @@ void sq_outport_delete(sq_outport_t outport) {
 
 void sq_outport_set_name(sq_outport_t outport, const char *name) {
 
+    char old_name[OUTPORT_MAX_NAME_LEN + 1];
+
     if (outport->jack_client) { // if registered
         jack_port_rename(outport->jack_client, outport->jack_port, name);
     }
 
+    strcpy(old_name, outport->name);
     outport_sanitize_name(outport, name); 
 
+    if (outport->names) {
+        nameIndex_rekey(outport->names, old_name, outport);
+    }
+
 }
 
 char *sq_outport_get_name(sq_outport_t outport) {
@@ -70,31 +83,38 @@ char *sq_outport_get_name(sq_outport_t outport) {
 
 }
 
-// PUBLIC CODE
+void sq_outport_get_stats(sq_outport_t outport, struct sq_outport_stats *stats) {
+
+    stats->events = STATS_GET(outport->stats.events);
+    stats->reserve_fails = STATS_GET(outport->stats.reserve_fails);
 
-json_object *outport_get_json(sq_outport_t outport) {
+}
 
-    json_object *jo_outport = json_object_new_object();
+// PUBLIC CODE
 
-    json_object_object_add(jo_outport, "name",
-                            json_object_new_string(sq_outport_get_name(outport)));
+void outport_write_json(sq_outport_t outport, jsonWriter_t *jw) {
 
-    return jo_outport;
+    jsonWriter_begin_object(jw, NULL);
+    jsonWriter_string(jw, "name", sq_outport_get_name(outport));
+    jsonWriter_end_object(jw);
 
 }
 
-sq_outport_t outport_malloc_from_json(json_object *jo_outport) {
-
-    sq_outport_t outport;
-    const char *name;
-    json_object *jo_tmp;
+sq_outport_t outport_read_json(jsonReader_t *jr) {
 
-    json_object_object_get_ex(jo_outport, "name", &jo_tmp);
-    name = json_object_get_string(jo_tmp);
+    const char *key;
+    char name[OUTPORT_MAX_NAME_LEN + 1] = "";
 
-    outport = sq_outport_new(name);
+    jsonReader_begin_object(jr);
+    while (jsonReader_next_key(jr, &key)) {
+        if (!strcmp(key, "name")) {
+            snprintf(name, sizeof(name), "%s", jsonReader_string(jr));
+        } else {
+            jsonReader_skip(jr);
+        }
+    }
 
-    return outport;
+    return sq_outport_new(name);
 
 }
 
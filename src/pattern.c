@@ -0,0 +1,318 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sequoia/pattern.h"
+
+// LOCAL DECLARATIONS
+
+static int pattern_count(pattern_t*);
+
+// PUBLIC CODE
+
+pattern_t *pattern_new(int nsteps, arena_t *arena) {
+
+    // the struct and its trigs go in one block, from the arena if there's
+    // room, else from the heap
+
+    pattern_t *pattern = NULL;
+
+    if (arena) {
+        pattern = arena_alloc(arena, pattern_alloc_size(nsteps));
+    }
+
+    if (pattern) {
+        pattern->arena = arena;
+    } else {
+        pattern = malloc(pattern_alloc_size(nsteps));
+        pattern->arena = NULL;
+    }
+
+    pattern->trigs = (struct trigger_data*) (pattern + 1);
+    pattern->packed = NULL;
+    pattern->npacked = 0;
+    pattern->nsteps = nsteps;
+    pattern->refcount = 1;
+    pattern->linked = false;
+    atomic_init(&pattern->version, 0);
+
+    for (int i=0; i<nsteps; i++) {
+        trigger_init(pattern->trigs + i);
+    }
+
+    return pattern;
+
+}
+
+pattern_t *pattern_new_packed(int nsteps, int npacked, arena_t *arena) {
+
+    // room for npacked steps, for the caller to fill in, in order. one that
+    // only a lazy sequence will hold can come from the heap, but one that's
+    // to be played should come from the arena, like any other pattern
+
+    pattern_t *pattern = NULL;
+
+    if (arena) {
+        pattern = arena_alloc(arena, pattern_packed_alloc_size(npacked));
+    }
+
+    if (pattern) {
+        pattern->arena = arena;
+    } else {
+        pattern = malloc(pattern_packed_alloc_size(npacked));
+        pattern->arena = NULL;
+    }
+
+    pattern->trigs = NULL;
+    pattern->packed = (struct pattern_step*) (pattern + 1);
+    pattern->npacked = npacked;
+    pattern->nsteps = nsteps;
+    pattern->refcount = 1;
+    pattern->linked = false;
+    atomic_init(&pattern->version, 0);
+
+    return pattern;
+
+}
+
+pattern_t *pattern_copy(pattern_t *pattern, arena_t *arena) {
+
+    // the copy is never packed
+
+    pattern_t *copy = pattern_new(pattern->nsteps, arena);
+
+    if (pattern_is_packed(pattern)) {
+        for (int i=0; i<pattern->npacked; i++) {
+            copy->trigs[pattern->packed[i].step] = pattern->packed[i].trig;
+        }
+    } else {
+        memcpy(copy->trigs, pattern->trigs, pattern->nsteps * sizeof(struct trigger_data));
+    }
+
+    return copy;
+
+}
+
+pattern_t *pattern_pack(pattern_t *pattern, arena_t *arena) {
+
+    // a packed copy of pattern, which mustn't be written to meanwhile
+
+    pattern_t *packed;
+    int n;
+
+    if (pattern_is_packed(pattern)) {
+        packed = pattern_new_packed(pattern->nsteps, pattern->npacked, arena);
+        memcpy(packed->packed, pattern->packed, pattern->npacked * sizeof(struct pattern_step));
+        return packed;
+    }
+
+    packed = pattern_new_packed(pattern->nsteps, pattern_count(pattern), arena);
+
+    n = 0;
+    for (int i=0; i<pattern->nsteps; i++) {
+        if (!trigger_is_default(pattern->trigs + i)) {
+            packed->packed[n].step = i;
+            packed->packed[n++].trig = pattern->trigs[i];
+        }
+    }
+
+    return packed;
+
+}
+
+pattern_t *pattern_fit(pattern_t *pattern, arena_t *arena) {
+
+    // a copy of pattern for a sequence to play, packed or not by how sparse
+    // it is
+
+    if (pattern_fits_packed(pattern->nsteps, pattern_count(pattern))) {
+        return pattern_pack(pattern, arena);
+    }
+
+    return pattern_copy(pattern, arena);
+
+}
+
+pattern_t *pattern_edit(pattern_t *pattern, int first, int n, sq_trigger_t trigs,
+                            arena_t *arena) {
+
+    // a copy of packed pattern, with the n steps from first set to trigs.
+    // the steps outside them are copied over in two runs, either side of
+    // the edit. it's unpacked if it's no longer sparse enough to play packed
+
+    int lo = pattern_search(pattern, first), hi = pattern_search(pattern, first + n);
+    int count = lo + (pattern->npacked - hi), k;
+    pattern_t *edited;
+
+    for (int i=0; i<n; i++) {
+        if (!trigger_is_default(trigs + i)) count++;
+    }
+
+    if (!pattern_fits_packed(pattern->nsteps, count)) {
+        edited = pattern_copy(pattern, arena);
+        memcpy(edited->trigs + first, trigs, n * sizeof(struct trigger_data));
+        return edited;
+    }
+
+    edited = pattern_new_packed(pattern->nsteps, count, arena);
+
+    memcpy(edited->packed, pattern->packed, lo * sizeof(struct pattern_step));
+    k = lo;
+    for (int i=0; i<n; i++) {
+        if (!trigger_is_default(trigs + i)) {
+            edited->packed[k].step = first + i;
+            edited->packed[k++].trig = trigs[i];
+        }
+    }
+    memcpy(edited->packed + k, pattern->packed + hi,
+            (pattern->npacked - hi) * sizeof(struct pattern_step));
+
+    return edited;
+
+}
+
+void pattern_ref(pattern_t *pattern) {
+
+    pattern->refcount++;
+
+}
+
+void pattern_unref(pattern_t *pattern) {
+
+    if (--pattern->refcount > 0) {
+        // a pattern left with one sequence is no longer linked to anything
+        if (pattern->refcount == 1) pattern->linked = false;
+        return;
+    }
+
+    if (pattern->arena) {
+        arena_free(pattern->arena, pattern);
+    } else {
+        free(pattern);
+    }
+
+}
+
+bool pattern_is_shared(pattern_t *pattern) {
+
+    return pattern->refcount > 1;
+
+}
+
+bool pattern_is_packed(pattern_t *pattern) {
+
+    return !pattern->trigs;
+
+}
+
+bool pattern_fits_packed(int nsteps, int npacked) {
+
+    // whether a pattern holding npacked trigs is played packed. a short one
+    // is cheap enough as it is, and is edited in place
+
+    return (nsteps > PATTERN_DENSE_NSTEPS) && (npacked * PATTERN_SPARSE_RATIO <= nsteps);
+
+}
+
+size_t pattern_alloc_size(int nsteps) {
+
+    return sizeof(pattern_t) + nsteps * sizeof(struct trigger_data);
+
+}
+
+size_t pattern_packed_alloc_size(int npacked) {
+
+    return sizeof(pattern_t) + npacked * sizeof(struct pattern_step);
+
+}
+
+int pattern_search(pattern_t *pattern, int step) {
+
+    // the index of a packed pattern's first step from step on, by bisection.
+    // it doesn't allocate, so the RT thread can use it too
+
+    int lo = 0, hi = pattern->npacked, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (pattern->packed[mid].step < step) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+
+}
+
+void pattern_read(pattern_t *pattern, int first, int n, struct trigger_data *trigs) {
+
+    // copies out n trigs from first, retrying if the RT thread wrote to
+    // them in the meantime (a seqlock read). a packed pattern is never
+    // written to, and its steps are found by bisection
+
+    unsigned int v0, v1;
+
+    if (pattern_is_packed(pattern)) {
+        for (int i=0; i<n; i++) {
+            trigger_init(trigs + i);
+        }
+        for (int i=pattern_search(pattern, first);
+                (i<pattern->npacked) && (pattern->packed[i].step < first + n); i++) {
+            trigs[pattern->packed[i].step - first] = pattern->packed[i].trig;
+        }
+        return;
+    }
+
+    do {
+        while ((v0 = atomic_load_explicit(&pattern->version, memory_order_acquire)) & 1);
+        memcpy(trigs, pattern->trigs + first, n * sizeof(struct trigger_data));
+        atomic_thread_fence(memory_order_acquire);
+        v1 = atomic_load_explicit(&pattern->version, memory_order_relaxed);
+    } while (v0 != v1);
+
+}
+
+// LOCAL CODE
+
+static int pattern_count(pattern_t *pattern) {
+
+    // the steps that don't hold the default trig
+
+    int n = 0;
+
+    if (pattern_is_packed(pattern)) {
+        return pattern->npacked;
+    }
+
+    for (int i=0; i<pattern->nsteps; i++) {
+        if (!trigger_is_default(pattern->trigs + i)) n++;
+    }
+
+    return n;
+
+}
@@ -0,0 +1,100 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+#include "sequoia/perf.h"
+
+// LOCAL DECLARATIONS
+
+static inline int perf_bin(uint64_t);
+
+// PUBLIC CODE
+
+void perf_init(perf_t *perf) {
+
+    perf->threshold = PERF_DEFAULT_THRESHOLD;
+    perf_reset(perf);
+
+}
+
+void perf_reset(perf_t *perf) {
+
+    for (int i=0; i<PERF_NPHASES; i++) {
+        for (int j=0; j<SQ_PERF_NBINS; j++) {
+            atomic_store_explicit(&perf->hist[i][j], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&perf->max[i], 0, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&perf->ncycles, 0, memory_order_relaxed);
+    atomic_store_explicit(&perf->nover, 0, memory_order_relaxed);
+
+}
+
+void perf_record(perf_t *perf, enum perf_phase phase, uint64_t ns) {
+
+    atomic_fetch_add_explicit(&perf->hist[phase][perf_bin(ns)], 1, memory_order_relaxed);
+
+    // there is only one writer, so a plain load and store is enough here
+    if (ns > atomic_load_explicit(&perf->max[phase], memory_order_relaxed)) {
+        atomic_store_explicit(&perf->max[phase], ns, memory_order_relaxed);
+    }
+
+}
+
+void perf_record_cycle(perf_t *perf, uint64_t ns, uint64_t period_ns) {
+
+    // records the whole callback, and checks it against the period
+
+    perf_record(perf, PERF_CYCLE, ns);
+
+    atomic_fetch_add_explicit(&perf->ncycles, 1, memory_order_relaxed);
+    if (ns > perf->threshold * period_ns) {
+        atomic_fetch_add_explicit(&perf->nover, 1, memory_order_relaxed);
+    }
+
+}
+
+void perf_read(perf_t *perf, struct sq_perf_stats *stats) {
+
+    for (int i=0; i<PERF_NPHASES; i++) {
+        for (int j=0; j<SQ_PERF_NBINS; j++) {
+            stats->hist[i][j] = atomic_load_explicit(&perf->hist[i][j], memory_order_relaxed);
+        }
+        stats->max[i] = atomic_load_explicit(&perf->max[i], memory_order_relaxed);
+    }
+
+    stats->ncycles = atomic_load_explicit(&perf->ncycles, memory_order_relaxed);
+    stats->nover = atomic_load_explicit(&perf->nover, memory_order_relaxed);
+    stats->threshold = perf->threshold;
+
+}
+
+// LOCAL CODE
+
+static inline int perf_bin(uint64_t ns) {
+
+    // bin i holds durations in [2^i, 2^(i+1)) ns
+
+    int bin = 63 - __builtin_clzll(ns | 1);
+
+    return (bin < SQ_PERF_NBINS) ? bin : SQ_PERF_NBINS - 1;
+
+}
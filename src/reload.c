@@ -0,0 +1,570 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sequoia/reload.h"
+
+// LOCAL DECLARATIONS
+
+#define RELOAD_MIN_NTRIGS 64
+#define RELOAD_MAX_NTRIGS 1024      // trigs written in place by the RT thread
+
+static sq_sequence_t reload_add_seq(reload_t*, sq_session_t, sq_session_t, sq_sequence_t);
+static void reload_inports(reload_t*, sq_session_t, sq_session_t);
+static void reload_patterns(reload_t*, sq_session_t, sq_session_t, pattern_t**);
+static bool reload_pattern_kept(reload_t*, sq_session_t, int*, int);
+static bool reload_diff_trigs(reload_t*, sq_sequence_t, pattern_t*, struct trigger_data*);
+static bool reload_params_differ(sq_sequence_t, sq_sequence_t, sq_outport_t, uint32_t);
+static sq_sequence_t reload_seq(reload_t*, sq_session_t, sq_sequence_t);
+static sq_outport_t reload_outport(sq_session_t, sq_outport_t);
+static uint32_t reload_fanout(sq_session_t, sq_session_t, uint32_t);
+static bool reload_is_removed(reload_t*, sq_sequence_t);
+static inline bool reload_trigs_equal(sq_trigger_t, sq_trigger_t);
+
+// PUBLIC CODE
+
+reload_t *reload_new(sq_session_t sesh, sq_session_t file) {
+
+    // the file's sequences are matched to the first live sequence of the
+    // same name and length that isn't already taken. one whose length has
+    // changed is a new sequence
+
+    reload_t *reload = malloc(sizeof(reload_t));
+    sq_outport_t outport;
+    uint32_t fanout;
+    sq_sequence_t seq, src;
+    pattern_t **patterns;
+    bool *matched;
+    int n = file->nseqs;
+
+    reload->bpm = file->bpm;
+    reload->seqs = malloc((n + 1) * sizeof(sq_sequence_t));
+    reload->nseqs = n;
+    reload->changes = malloc((n + 1) * sizeof(struct reload_seq));
+    reload->nchanges = 0;
+    reload->trigs = malloc(RELOAD_MIN_NTRIGS * sizeof(struct reload_trig));
+    reload->ntrigs = 0;
+    reload->maxtrigs = RELOAD_MIN_NTRIGS;
+    reload->ninports = 0;
+    reload->added = malloc((n + 1) * sizeof(sq_sequence_t));
+    reload->nadded = 0;
+    reload->removed = malloc((sesh->nseqs + 1) * sizeof(sq_sequence_t));
+    reload->nremoved = 0;
+    reload->done = false;
+
+    // new outports first, for the sequences and inports to play through
+    for (int i=0; i<file->noutports; i++) {
+        if (!session_get_outport_from_name(sesh, file->outports[i]->name)) {
+            outport = sq_outport_new(file->outports[i]->name);
+            if (sq_session_register_outport(sesh, outport)) {
+                sq_outport_delete(outport);
+            }
+        }
+    }
+
+    matched = calloc(sesh->nseqs + 1, sizeof(bool));
+    for (int i=0; i<n; i++) {
+        src = file->seqs[i];
+        seq = NULL;
+        for (int j=0; j<sesh->nseqs; j++) {
+            if (!matched[j] && (sesh->seqs[j]->nsteps == src->nsteps)
+                    && !strcmp(sesh->seqs[j]->name, src->name)) {
+                matched[j] = true;
+                seq = sesh->seqs[j];
+                break;
+            }
+        }
+        reload->seqs[i] = seq ? seq : reload_add_seq(reload, sesh, file, src);
+    }
+    for (int j=0; j<sesh->nseqs; j++) {
+        if (!matched[j]) {
+            reload->removed[reload->nremoved++] = sesh->seqs[j];
+        }
+    }
+    free(matched);
+
+    // a lazy sequence that the file makes audible is materialized now,
+    // since the batch can't do it on the RT thread
+    for (int i=0; i<n; i++) {
+        src = file->seqs[i];
+        if ((reload->seqs[i]->session == sesh) && !src->mute && src->outport) {
+            sequence_materialize(reload->seqs[i]);
+        }
+    }
+
+    // the inports before the patterns, since a sequence that's recorded
+    // into has to have a pattern of its own
+    reload_inports(reload, sesh, file);
+
+    patterns = calloc(n + 1, sizeof(pattern_t*));
+    reload_patterns(reload, sesh, file, patterns);
+
+    for (int i=0; i<n; i++) {
+        seq = reload->seqs[i];
+        src = file->seqs[i];
+        outport = reload_outport(sesh, src->outport);
+        fanout = reload_fanout(sesh, file, src->fanout);
+        if (seq->session != sesh) {
+            // a new one, which nothing plays yet
+            pattern_unref(seq->pattern);
+            sequence_set_pattern_now(seq, patterns[i]);
+        } else if (patterns[i] || reload_params_differ(seq, src, outport, fanout)) {
+            struct reload_seq *change = reload->changes + reload->nchanges++;
+            change->seq = seq;
+            change->pattern = patterns[i];
+            change->old = seq->pattern;
+            change->transpose = src->transpose;
+            change->div = src->div;
+            change->first = src->first;
+            change->last = src->last;
+            change->mute = src->mute;
+            change->motion = src->motion;
+            change->outport = outport;
+            change->fanout = fanout;
+        }
+    }
+    free(patterns);
+
+    for (int i=0; i<reload->nadded; i++) {
+        reload->added[i]->session = sesh;
+    }
+
+    return reload;
+
+}
+
+void reload_delete(reload_t *reload) {
+
+    // once the batch is applied, the old patterns and the removed sequences
+    // are let go of. if it never was, the new ones are
+
+    struct reload_seq *change;
+
+    for (int i=0; i<reload->nchanges; i++) {
+        change = reload->changes + i;
+        if (change->pattern) {
+            pattern_unref(reload->done ? change->old : change->pattern);
+        }
+    }
+
+    if (reload->done) {
+        for (int i=0; i<reload->nremoved; i++) {
+            reload->removed[i]->session = NULL;
+            sq_sequence_delete(reload->removed[i]);
+        }
+    } else {
+        for (int i=0; i<reload->nadded; i++) {
+            reload->added[i]->session = NULL;
+            sq_sequence_delete(reload->added[i]);
+        }
+    }
+
+    free(reload->removed);
+    free(reload->added);
+    free(reload->trigs);
+    free(reload->changes);
+    free(reload->seqs);
+    free(reload);
+
+}
+
+void reload_apply_now(reload_t *reload, sq_session_t sesh) {
+
+    // everything at once, between two steps. the sequences are set in the
+    // file's order, and only the parameters that differ are set, so that
+    // nothing else (a clock divide's count, say) is reset
+
+    struct reload_seq *change;
+    struct reload_trig *trig;
+    struct reload_inport *target;
+    sq_inport_t inport;
+    sq_sequence_t seq;
+
+    for (int i=0; i<reload->nremoved; i++) {
+        reload->removed[i]->is_playing = false;
+    }
+    for (int i=0; i<reload->nseqs; i++) {
+        reload->seqs[i]->is_playing = sesh->go;
+        sesh->seqs[i] = reload->seqs[i];
+    }
+    sesh->nseqs = reload->nseqs;
+
+    for (int i=0; i<reload->nchanges; i++) {
+        change = reload->changes + i;
+        seq = change->seq;
+        if (change->pattern) {
+            sequence_set_pattern_now(seq, change->pattern);
+        }
+        if (seq->transpose != change->transpose) {
+            sequence_set_transpose_now(seq, change->transpose);
+        }
+        if (seq->div != change->div) {
+            sequence_set_clockdivide_now(seq, change->div);
+        }
+        if (seq->first != change->first) {
+            sequence_set_first_now(seq, change->first);
+        }
+        if (seq->last != change->last) {
+            sequence_set_last_now(seq, change->last);
+        }
+        if (seq->mute != change->mute) {
+            sequence_set_mute_now(seq, change->mute);
+        }
+        if (seq->motion != change->motion) {
+            sequence_set_motion_now(seq, change->motion);
+        }
+        seq->outport = change->outport;
+        seq->fanout = change->fanout;
+    }
+
+    for (int i=0; i<reload->ntrigs; i++) {
+        trig = reload->trigs + i;
+        pattern_write_begin(trig->pattern);
+        trig->pattern->trigs[trig->step] = trig->trig;
+        pattern_write_end(trig->pattern);
+    }
+
+    for (int i=0; i<reload->ninports; i++) {
+        target = reload->inports + i;
+        inport = target->inport;
+        if ((inport->nseqs != target->nseqs)
+                || memcmp(inport->seqs, target->seqs, target->nseqs * sizeof(sq_sequence_t))) {
+            // the recording state is kept by position in the list
+            for (int j=0; j<INPORT_NNOTES; j++) {
+                inport->rec_notes[j].active = false;
+            }
+            for (int j=0; j<INPORT_MAX_NSEQ; j++) {
+                inport->rec_step[j] = -1;
+                inport->rec_ahead[j] = -1;
+            }
+            memcpy(inport->seqs, target->seqs, target->nseqs * sizeof(sq_sequence_t));
+            inport->nseqs = target->nseqs;
+        }
+        memcpy(inport->thru, target->thru, target->nthru * sizeof(sq_outport_t));
+        inport->nthru = target->nthru;
+        inport->type = target->type;
+        inport->rec_mode = target->rec_mode;
+        inport->thru_channel = target->thru_channel;
+        inport->thru_transpose = target->thru_transpose;
+    }
+
+}
+
+// LOCAL CODE
+
+static sq_sequence_t reload_add_seq(reload_t *reload, sq_session_t sesh, sq_session_t file,
+                                        sq_sequence_t src) {
+
+    // a copy of src in the live session, all but its pattern (see
+    // reload_patterns). it isn't in the session until the batch is applied
+
+    sq_sequence_t seq = sq_session_new_sequence(sesh, src->nsteps);
+
+    sq_sequence_set_name(seq, src->name);
+    sq_sequence_set_mute(seq, src->mute);
+    sq_sequence_set_transpose(seq, src->transpose);
+    sq_sequence_set_clockdivide(seq, src->div);
+    sq_sequence_set_first(seq, src->first);
+    sq_sequence_set_last(seq, src->last);
+    sq_sequence_set_motion(seq, src->motion);
+    sq_sequence_set_outport(seq, reload_outport(sesh, src->outport));
+    seq->fanout = reload_fanout(sesh, file, src->fanout);
+    sequence_reset_now(seq);
+
+    reload->added[reload->nadded++] = seq;
+
+    return seq;
+
+}
+
+static void reload_inports(reload_t *reload, sq_session_t sesh, sq_session_t file) {
+
+    // every live inport gets the file's settings, registering it first if
+    // it's new. one that isn't in the file keeps its own, less the
+    // sequences being removed
+
+    struct reload_inport *target;
+    sq_inport_t inport, src;
+    sq_sequence_t seq;
+    sq_outport_t outport;
+
+    for (int i=0; i<file->ninports; i++) {
+        if (!session_get_inport_from_name(sesh, file->inports[i]->name)) {
+            inport = sq_inport_new(file->inports[i]->name);
+            if (sq_session_register_inport(sesh, inport)) {
+                sq_inport_delete(inport);
+            }
+        }
+    }
+
+    for (int i=0; i<sesh->ninports; i++) {
+
+        inport = sesh->inports[i];
+        target = reload->inports + reload->ninports++;
+        target->inport = inport;
+        target->nseqs = 0;
+        target->nthru = 0;
+
+        if ((src = session_get_inport_from_name(file, inport->name))) {
+            for (int j=0; j<src->nseqs; j++) {
+                if ((seq = reload_seq(reload, file, src->seqs[j]))) {
+                    target->seqs[target->nseqs++] = seq;
+                }
+            }
+            for (int j=0; j<src->nthru; j++) {
+                if ((outport = reload_outport(sesh, src->thru[j]))) {
+                    target->thru[target->nthru++] = outport;
+                }
+            }
+        } else {
+            src = inport;
+            for (int j=0; j<src->nseqs; j++) {
+                if (!reload_is_removed(reload, src->seqs[j])) {
+                    target->seqs[target->nseqs++] = src->seqs[j];
+                }
+            }
+            memcpy(target->thru, src->thru, src->nthru * sizeof(sq_outport_t));
+            target->nthru = src->nthru;
+        }
+
+        target->type = src->type;
+        target->rec_mode = src->rec_mode;
+        target->thru_channel = src->thru_channel;
+        target->thru_transpose = src->thru_transpose;
+
+        for (int j=0; j<target->nseqs; j++) {
+            inport_prepare_sequence(target->type, target->seqs[j]);
+        }
+
+    }
+
+}
+
+static void reload_patterns(reload_t *reload, sq_session_t sesh, sq_session_t file,
+                                pattern_t **patterns) {
+
+    // the file's sequences are grouped by the pattern they share. a group
+    // whose live sequences already share a pattern among themselves alone
+    // (or, for a group of one, have one that isn't linked) keeps it, and
+    // gets the trigs that differ written into it, unless it's packed. any
+    // other group gets a new pattern in patterns, copied from the file's:
+    // linked if shared, and otherwise packed if it's long and sparse, unless
+    // an inport records into it (see reload_inports), which needs its trigs
+
+    struct trigger_data *trigs;
+    pattern_t *src, *pattern;
+    int *group;
+    bool *seen;
+    int k;
+
+    trigs = malloc(SEQUENCE_MAX_NSTEPS * sizeof(struct trigger_data));
+    group = malloc((file->nseqs + 1) * sizeof(int));
+    seen = calloc(file->nseqs + 1, sizeof(bool));
+
+    for (int i=0; i<file->nseqs; i++) {
+
+        if (seen[i]) continue;
+
+        src = file->seqs[i]->pattern;
+        k = 0;
+        for (int j=i; j<file->nseqs; j++) {
+            if (file->seqs[j]->pattern == src) {
+                group[k++] = j;
+                seen[j] = true;
+            }
+        }
+
+        if (!reload_pattern_kept(reload, sesh, group, k)
+                || !reload_diff_trigs(reload, reload->seqs[i], src, trigs)) {
+            if ((k > 1) || reload->seqs[i]->recorded) {
+                pattern = pattern_copy(src, sesh->arena);
+            } else {
+                pattern = pattern_fit(src, sesh->arena);
+            }
+            pattern->linked = (k > 1);
+            for (int j=0; j<k; j++) {
+                if (j > 0) pattern_ref(pattern);
+                patterns[group[j]] = pattern;
+            }
+        }
+
+    }
+
+    free(seen);
+    free(group);
+    free(trigs);
+
+}
+
+static bool reload_pattern_kept(reload_t *reload, sq_session_t sesh, int *group, int k) {
+
+    // new sequences aren't in the session yet, and always get a new pattern
+
+    pattern_t *pattern = reload->seqs[group[0]]->pattern;
+    sq_sequence_t seq;
+    int n = 0;
+
+    for (int j=0; j<k; j++) {
+        seq = reload->seqs[group[j]];
+        if ((seq->session != sesh) || (seq->pattern != pattern)) {
+            return false;
+        }
+    }
+
+    if (k == 1) {
+        return !pattern->linked;
+    }
+    if (!pattern->linked) {
+        return false;
+    }
+
+    for (int i=0; i<sesh->nseqs; i++) {
+        if (sesh->seqs[i]->pattern == pattern) n++;
+    }
+
+    return n == k;
+
+}
+
+static bool reload_diff_trigs(reload_t *reload, sq_sequence_t seq, pattern_t *src,
+                                struct trigger_data *trigs) {
+
+    // queues the trigs of src that differ from seq's, to be written in place.
+    // either may be packed, but seq's can't be written in place once it's
+    // materialized, so it returns false instead if there are any. it does
+    // the same once the batch has RELOAD_MAX_NTRIGS, to bound the RT
+    // thread's work, since a new pattern is only a pointer to swap
+
+    int first = reload->ntrigs;
+    struct reload_trig *trig;
+    struct trigger_data want;
+
+    pattern_read(seq->pattern, 0, seq->nsteps, trigs);
+
+    for (int step=0; step<seq->nsteps; step++) {
+        pattern_read(src, step, 1, &want);
+        if (reload_trigs_equal(trigs + step, &want)) continue;
+        if (reload->ntrigs == RELOAD_MAX_NTRIGS) {
+            reload->ntrigs = first;
+            return false;
+        }
+        if (reload->ntrigs == reload->maxtrigs) {
+            reload->maxtrigs *= 2;
+            reload->trigs = realloc(reload->trigs, reload->maxtrigs * sizeof(struct reload_trig));
+        }
+        trig = reload->trigs + reload->ntrigs++;
+        trig->step = step;
+        trig->trig = want;
+    }
+
+    if (reload->ntrigs == first) {
+        return true;
+    }
+
+    sequence_materialize(seq);
+    if (pattern_is_packed(seq->pattern)) {
+        reload->ntrigs = first;
+        return false;
+    }
+
+    // copy on write, if it's a clone's. the copy has the same trigs
+    sequence_own_pattern(seq);
+    for (int i=first; i<reload->ntrigs; i++) {
+        reload->trigs[i].pattern = seq->pattern;
+    }
+
+    return true;
+
+}
+
+static bool reload_params_differ(sq_sequence_t seq, sq_sequence_t src, sq_outport_t outport,
+                                    uint32_t fanout) {
+
+    return (seq->transpose != src->transpose) || (seq->div != src->div)
+            || (seq->first != src->first) || (seq->last != src->last)
+            || (seq->mute != src->mute) || (seq->motion != src->motion)
+            || (seq->outport != outport) || (seq->fanout != fanout);
+
+}
+
+static sq_sequence_t reload_seq(reload_t *reload, sq_session_t file, sq_sequence_t seq) {
+
+    // the live sequence standing for one of the file's
+
+    for (int i=0; i<file->nseqs; i++) {
+        if (file->seqs[i] == seq) {
+            return reload->seqs[i];
+        }
+    }
+
+    return NULL;
+
+}
+
+static sq_outport_t reload_outport(sq_session_t sesh, sq_outport_t outport) {
+
+    // the live outport of the same name as outport, from either session
+
+    return outport ? session_get_outport_from_name(sesh, outport->name) : NULL;
+
+}
+
+static uint32_t reload_fanout(sq_session_t sesh, sq_session_t file, uint32_t fanout) {
+
+    // the file's fanout, over the live outports of the same names
+
+    uint32_t live = 0;
+    sq_outport_t outport;
+
+    for (int i=0; i<file->noutports; i++) {
+        if ((fanout & (1u << i)) && (outport = reload_outport(sesh, file->outports[i]))) {
+            live |= 1u << outport->index;
+        }
+    }
+
+    return live;
+
+}
+
+static bool reload_is_removed(reload_t *reload, sq_sequence_t seq) {
+
+    for (int i=0; i<reload->nremoved; i++) {
+        if (reload->removed[i] == seq) {
+            return true;
+        }
+    }
+
+    return false;
+
+}
+
+static inline bool reload_trigs_equal(sq_trigger_t a, sq_trigger_t b) {
+
+    // the other fields of a null trig aren't saved, so they don't count
+
+    return ((a->type == TRIG_NULL) && (b->type == TRIG_NULL))
+            || !memcmp(a, b, sizeof(struct trigger_data));
+
+}
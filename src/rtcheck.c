@@ -0,0 +1,315 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "sequoia/rtcheck.h"
+
+#ifdef SQ_RTCHECK
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+
+// LOCAL DECLARATIONS
+
+#define RTCHECK_TRAP(name) \
+    if (rtcheck_in_rt) rtcheck_report(name, __builtin_return_address(0))
+
+// initial-exec, so that reading the flag can't itself allocate
+static __thread bool rtcheck_in_rt __attribute__((tls_model("initial-exec"))) = false;
+
+static void *rtcheck_sites[RTCHECK_MAX_NSITES];
+static int rtcheck_nsites = 0;
+
+// dlsym can allocate while we look up the real allocator, so the first few
+// allocations are served from here
+static char rtcheck_bootstrap[RTCHECK_BOOTSTRAP_SIZE] __attribute__((aligned(16)));
+static size_t rtcheck_bootstrap_used = 0;
+static bool rtcheck_initializing = false;
+
+static void *(*real_malloc)(size_t);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_realloc)(void*, size_t);
+static void (*real_free)(void*);
+static int (*real_vfprintf)(FILE*, const char*, va_list);
+static int (*real_puts)(const char*);
+static int (*real_fputs)(const char*, FILE*);
+static int (*real_pthread_mutex_lock)(pthread_mutex_t*);
+static int (*real_usleep)(useconds_t);
+static long (*real_random)(void);
+
+static void rtcheck_init(void);
+static void rtcheck_report(const char*, void*);
+static void *rtcheck_bootstrap_alloc(size_t);
+static bool rtcheck_is_bootstrap(void*);
+
+// PUBLIC CODE
+
+void rtcheck_enter(void) {
+
+    rtcheck_in_rt = true;
+
+}
+
+void rtcheck_leave(void) {
+
+    rtcheck_in_rt = false;
+
+}
+
+// INTERPOSED CODE
+
+void *malloc(size_t size) {
+
+    if (!real_malloc) {
+        if (rtcheck_initializing) return rtcheck_bootstrap_alloc(size);
+        rtcheck_init();
+    }
+
+    RTCHECK_TRAP("malloc");
+
+    return real_malloc(size);
+
+}
+
+void *calloc(size_t n, size_t size) {
+
+    if (!real_calloc) {
+        if (rtcheck_initializing) return rtcheck_bootstrap_alloc(n * size);
+        rtcheck_init();
+    }
+
+    RTCHECK_TRAP("calloc");
+
+    return real_calloc(n, size);
+
+}
+
+void *realloc(void *ptr, size_t size) {
+
+    if (!real_realloc) rtcheck_init();
+
+    RTCHECK_TRAP("realloc");
+
+    return real_realloc(ptr, size);
+
+}
+
+void free(void *ptr) {
+
+    if (rtcheck_is_bootstrap(ptr)) return;
+    if (!real_free) rtcheck_init();
+
+    RTCHECK_TRAP("free");
+
+    real_free(ptr);
+
+}
+
+int vfprintf(FILE *stream, const char *fmt, va_list ap) {
+
+    if (!real_vfprintf) rtcheck_init();
+
+    RTCHECK_TRAP("vfprintf");
+
+    return real_vfprintf(stream, fmt, ap);
+
+}
+
+int vprintf(const char *fmt, va_list ap) {
+
+    if (!real_vfprintf) rtcheck_init();
+
+    RTCHECK_TRAP("vprintf");
+
+    return real_vfprintf(stdout, fmt, ap);
+
+}
+
+int fprintf(FILE *stream, const char *fmt, ...) {
+
+    va_list ap;
+    int ret;
+
+    if (!real_vfprintf) rtcheck_init();
+
+    RTCHECK_TRAP("fprintf");
+
+    va_start(ap, fmt);
+    ret = real_vfprintf(stream, fmt, ap);
+    va_end(ap);
+
+    return ret;
+
+}
+
+int printf(const char *fmt, ...) {
+
+    va_list ap;
+    int ret;
+
+    if (!real_vfprintf) rtcheck_init();
+
+    RTCHECK_TRAP("printf");
+
+    va_start(ap, fmt);
+    ret = real_vfprintf(stdout, fmt, ap);
+    va_end(ap);
+
+    return ret;
+
+}
+
+int puts(const char *s) {
+
+    if (!real_puts) rtcheck_init();
+
+    RTCHECK_TRAP("puts");
+
+    return real_puts(s);
+
+}
+
+int fputs(const char *s, FILE *stream) {
+
+    if (!real_fputs) rtcheck_init();
+
+    RTCHECK_TRAP("fputs");
+
+    return real_fputs(s, stream);
+
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+
+    if (!real_pthread_mutex_lock) rtcheck_init();
+
+    RTCHECK_TRAP("pthread_mutex_lock");
+
+    return real_pthread_mutex_lock(mutex);
+
+}
+
+int usleep(useconds_t usec) {
+
+    if (!real_usleep) rtcheck_init();
+
+    RTCHECK_TRAP("usleep");
+
+    return real_usleep(usec);
+
+}
+
+long random(void) {
+
+    if (!real_random) rtcheck_init();
+
+    RTCHECK_TRAP("random");
+
+    return real_random();
+
+}
+
+// LOCAL CODE
+
+__attribute__((constructor))
+static void rtcheck_init(void) {
+
+    if (real_malloc || rtcheck_initializing) return;
+
+    rtcheck_initializing = true;
+
+    real_calloc = dlsym(RTLD_NEXT, "calloc");
+    real_malloc = dlsym(RTLD_NEXT, "malloc");
+    real_realloc = dlsym(RTLD_NEXT, "realloc");
+    real_free = dlsym(RTLD_NEXT, "free");
+    real_vfprintf = dlsym(RTLD_NEXT, "vfprintf");
+    real_puts = dlsym(RTLD_NEXT, "puts");
+    real_fputs = dlsym(RTLD_NEXT, "fputs");
+    real_pthread_mutex_lock = dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    real_usleep = dlsym(RTLD_NEXT, "usleep");
+    real_random = dlsym(RTLD_NEXT, "random");
+
+    rtcheck_initializing = false;
+
+}
+
+static void rtcheck_report(const char *name, void *site) {
+
+    // everything in here runs with the RT flag cleared, so that reporting
+    // (which allocates and locks) doesn't report itself
+
+    void *frames[RTCHECK_MAX_FRAMES];
+    int nframes;
+
+    rtcheck_in_rt = false;
+
+    for (int i=0; i<rtcheck_nsites; i++) {
+        if (rtcheck_sites[i] == site) {
+            rtcheck_in_rt = true;
+            return;
+        }
+    }
+    if (rtcheck_nsites < RTCHECK_MAX_NSITES) {
+        rtcheck_sites[rtcheck_nsites++] = site;
+    }
+
+    fprintf(stderr, "rtcheck: %s called from the process thread\n", name);
+    nframes = backtrace(frames, RTCHECK_MAX_FRAMES);
+    backtrace_symbols_fd(frames, nframes, STDERR_FILENO);
+
+    if (getenv("SQ_RTCHECK_ABORT")) {
+        abort();
+    }
+
+    rtcheck_in_rt = true;
+
+}
+
+static void *rtcheck_bootstrap_alloc(size_t size) {
+
+    void *ptr;
+
+    size = (size + 15) & ~((size_t) 15);
+    if (rtcheck_bootstrap_used + size > RTCHECK_BOOTSTRAP_SIZE) return NULL;
+
+    ptr = rtcheck_bootstrap + rtcheck_bootstrap_used;
+    rtcheck_bootstrap_used += size;
+
+    return ptr;     // already zeroed, being static
+
+}
+
+static bool rtcheck_is_bootstrap(void *ptr) {
+
+    return ((char*) ptr >= rtcheck_bootstrap)
+            && ((char*) ptr < rtcheck_bootstrap + RTCHECK_BOOTSTRAP_SIZE);
+
+}
+
+#endif
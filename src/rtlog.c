@@ -0,0 +1,173 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sequoia/rtlog.h"
+
+// LOCAL DECLARATIONS
+
+static __thread rtlog_t *rtlog_bound = NULL;
+
+static void rtlog_push(enum rtlog_arg, const char*, int, const char*);
+static void rtlog_drain(rtlog_t*);
+static void *rtlog_thread_main(void*);
+
+// PUBLIC CODE
+
+rtlog_t *rtlog_new(void) {
+
+    rtlog_t *rtlog = malloc(sizeof(rtlog_t));
+
+    rtlog->rb = jack_ringbuffer_create(RTLOG_NRECORDS * sizeof(rtlog_record_t));
+    if (jack_ringbuffer_mlock(rtlog->rb)) {
+        fprintf(stderr, "failed to lock ringbuffer\n");
+        exit(1);
+    }
+
+    atomic_init(&rtlog->ndropped, 0);
+    atomic_init(&rtlog->running, true);
+
+    if (pthread_create(&rtlog->thread, NULL, rtlog_thread_main, rtlog)) {
+        fprintf(stderr, "failed to start logger thread\n");
+        exit(1);
+    }
+
+    return rtlog;
+
+}
+
+void rtlog_delete(rtlog_t *rtlog) {
+
+    // stops the logger thread, which prints anything still queued on its way out
+
+    atomic_store(&rtlog->running, false);
+    pthread_join(rtlog->thread, NULL);
+
+    jack_ringbuffer_free(rtlog->rb);
+    free(rtlog);
+
+}
+
+void rtlog_bind(rtlog_t *rtlog) {
+
+    rtlog_bound = rtlog;
+
+}
+
+void rtlog_write(const char *fmt) {
+
+    rtlog_push(RTLOG_ARG_NONE, fmt, 0, NULL);
+
+}
+
+void rtlog_write_int(const char *fmt, int vi) {
+
+    rtlog_push(RTLOG_ARG_INT, fmt, vi, NULL);
+
+}
+
+void rtlog_write_str(const char *fmt, const char *vs) {
+
+    rtlog_push(RTLOG_ARG_STR, fmt, 0, vs);
+
+}
+
+// LOCAL CODE
+
+static void rtlog_push(enum rtlog_arg arg, const char *fmt, int vi, const char *vs) {
+
+    rtlog_t *rtlog = rtlog_bound;
+    rtlog_record_t rec;
+
+    if (!rtlog) {
+        // not on a bound (RT) thread, so stdio is fine
+        if (arg == RTLOG_ARG_INT) {
+            fprintf(stderr, fmt, vi);
+        } else if (arg == RTLOG_ARG_STR) {
+            fprintf(stderr, fmt, vs);
+        } else {
+            fprintf(stderr, "%s", fmt);
+        }
+        return;
+    }
+
+    // a full ring drops the record rather than wait
+    if (jack_ringbuffer_write_space(rtlog->rb) < sizeof(rtlog_record_t)) {
+        atomic_fetch_add_explicit(&rtlog->ndropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    rec.fmt = fmt;
+    rec.arg = arg;
+    rec.vi = vi;
+    if (arg == RTLOG_ARG_STR) {
+        strncpy(rec.vs, vs, RTLOG_MAX_STR_LEN);
+        rec.vs[RTLOG_MAX_STR_LEN] = '\0';
+    } else {
+        rec.vs[0] = '\0';
+    }
+
+    jack_ringbuffer_write(rtlog->rb, (const char*) &rec, sizeof(rtlog_record_t));
+
+}
+
+static void rtlog_drain(rtlog_t *rtlog) {
+
+    rtlog_record_t rec;
+    unsigned long ndropped;
+
+    while (jack_ringbuffer_read_space(rtlog->rb) >= sizeof(rtlog_record_t)) {
+        jack_ringbuffer_read(rtlog->rb, (char*) &rec, sizeof(rtlog_record_t));
+        if (rec.arg == RTLOG_ARG_INT) {
+            fprintf(stderr, rec.fmt, rec.vi);
+        } else if (rec.arg == RTLOG_ARG_STR) {
+            fprintf(stderr, rec.fmt, rec.vs);
+        } else {
+            fprintf(stderr, "%s", rec.fmt);
+        }
+    }
+
+    ndropped = atomic_exchange_explicit(&rtlog->ndropped, 0, memory_order_relaxed);
+    if (ndropped) {
+        fprintf(stderr, "rtlog: %lu messages dropped\n", ndropped);
+    }
+
+}
+
+static void *rtlog_thread_main(void *arg) {
+
+    rtlog_t *rtlog = arg;
+
+    while (atomic_load(&rtlog->running)) {
+        rtlog_drain(rtlog);
+        usleep(RTLOG_POLL_US);
+    }
+
+    rtlog_drain(rtlog);
+
+    return NULL;
+
+}
@@ -28,94 +28,169 @@
 #include "sequoia.h"
 #include "sequoia/sequence.h"
 #include "sequoia/midiEvent.h"
+#include "sequoia/rtlog.h"
+#include "sequoia/pattern.h"
+#include "sequoia/session.h"
+#include "sequoia/history.h"
 
 // LOCAL DECLARATIONS
 
 #define SEQUENCE_RB_LENGTH 16
 
-enum sequence_param {SEQUENCE_SET_TRIG, SEQUENCE_CLEAR_TRIG, SEQUENCE_TRANSPOSE, SEQUENCE_PH,
-                        SEQUENCE_DIV, SEQUENCE_MUTE, SEQUENCE_FIRST, SEQUENCE_LAST, SEQUENCE_MOTION,
-                        SEQUENCE_GET_TRIG, SEQUENCE_SWING, SEQUENCE_SWING_TYPE};
-
-typedef struct {
-
-    enum sequence_param param;
-
-    // parameter-dependent value fields
-    int vi;
-    float vf;
-    bool vb;
-    sq_trigger_t vp;
-
-    bool *donep;
-
-} sequence_ctrl_msg_t;
-
-static void sequence_ringbuffer_write(sq_sequence_t, sequence_ctrl_msg_t*);
+static bool sequence_ringbuffer_write(sq_sequence_t, sequence_ctrl_msg_t*);
 static void sequence_serve_ctrl_msgs(sq_sequence_t);
 static void notification_data_init(struct notification_data*);
+static int sequence_next_step(sq_sequence_t, bool*);
+static inline float sequence_random(sq_sequence_t);
+static inline sq_trigger_t sequence_trig(sq_sequence_t);
+static sq_sequence_t sequence_alloc(pattern_t*, arena_t*, bool);
+static jack_ringbuffer_t *sequence_rb_new(arena_t*);
+static void sequence_copy_params(sq_sequence_t, sq_sequence_t);
+static inline history_t *sequence_history(sq_sequence_t);
+static bool sequence_swap_pattern(sq_sequence_t, pattern_t*);
+static void sequence_read_json_trigs(jsonReader_t*, const char*, sq_trigger_t, int);
 
 // INTERFACE CODE
 
 sq_sequence_t sq_sequence_new(int nsteps) {
 
-    sq_sequence_t seq;
+    return sequence_new(nsteps, NULL);
+
+}
+
+sq_sequence_t sequence_new(int nsteps, arena_t *arena) {
+
+    // a long sequence starts out packed, as it's empty
 
     if (nsteps > SEQUENCE_MAX_NSTEPS) {
         fprintf(stderr, "nsteps of %d exceeds max of %d\n", nsteps, SEQUENCE_MAX_NSTEPS);
         exit(1);
     }
 
-    seq = malloc(sizeof(struct sequence_data));
+    if (pattern_fits_packed(nsteps, 0)) {
+        return sequence_alloc(pattern_new_packed(nsteps, 0, arena), arena, false);
+    }
 
-    seq->nsteps = nsteps;
-    seq->name[0] = '\0';
-    seq->transpose = 0;
+    return sequence_alloc(pattern_new(nsteps, arena), arena, false);
 
-    seq->div = 1;
+}
 
-    // TODO switch to mallocing dynamically?
-    seq->trigs = malloc(seq->nsteps * sizeof(struct trigger_data));
-    for (int i=0; i<seq->nsteps; i++) {
-        trigger_init(seq->trigs + i);
-    }
+sq_sequence_t sequence_new_pattern(pattern_t *pattern, arena_t *arena, bool lazy) {
 
-    // allocate and lock ringbuffer (universal ringbuffer length?)
-    seq->rb = jack_ringbuffer_create(SEQUENCE_RB_LENGTH * sizeof(sequence_ctrl_msg_t));
-    int err = jack_ringbuffer_mlock(seq->rb);
-    if (err) {
-        fprintf(stderr, "failed to lock ringbuffer\n");
-        exit(1);
+    // a sequence playing pattern, taking over the caller's reference to it.
+    // a lazy one, whose pattern must be packed, steps along with the session
+    // but can't be heard, and has no ringbuffer, until it's materialized
+
+    return sequence_alloc(pattern, arena, lazy);
+
+}
+
+sq_sequence_t sq_sequence_clone(sq_sequence_t src) {
+
+    // a copy of src, sharing its trigs until either one edits them. a
+    // pattern that is linked, or that an inport records into from the RT
+    // thread, can't be copied on write, so the clone gets its own right away
+
+    sq_sequence_t seq;
+    pattern_t *pattern;
+
+    if (src->pattern->linked || src->recorded) {
+        pattern = pattern_copy(src->pattern, src->arena);
+    } else {
+        pattern = src->pattern;
+        pattern_ref(pattern);
     }
 
-    seq->is_playing = false;
+    seq = sequence_alloc(pattern, src->arena,
+                            atomic_load_explicit(&src->lazy, memory_order_relaxed));
+    sequence_copy_params(seq, src);
 
-    seq->outport = NULL;
+    return seq;
 
-    seq->mute = false;
+}
 
-    seq->first = 0;
-    seq->last = seq->nsteps - 1;
+sq_sequence_t sq_sequence_new_linked(sq_sequence_t src) {
 
-    seq->motion = MOTION_FORWARD;
-    seq->bounce_forward = true;
+    // a new sequence playing the same pattern as src, with its own
+    // parameters. edits to either are edits to both
 
-    seq->swing = 0.0;
-    seq->swingType = SWING_ALTERNATE;
+    sq_sequence_t seq;
 
-    notification_data_init(&seq->noti);
-    seq->noti_enable = false;
+    sequence_own_pattern(src);
+    src->pattern->linked = true;
+    pattern_ref(src->pattern);
 
-    sequence_reset_now(seq);
+    seq = sequence_alloc(src->pattern, src->arena, false);
+    sequence_copy_params(seq, src);
 
     return seq;
 
 }
 
+void sq_sequence_unlink(sq_sequence_t seq) {
+
+    // gives seq a pattern of its own, if it shares one
+
+    sequence_materialize(seq);
+
+    if (pattern_is_shared(seq->pattern)) {
+        journal_unlink(seq->session, seq);
+        sequence_swap_pattern(seq, pattern_copy(seq->pattern, seq->arena));
+    }
+
+}
+
+bool sq_sequence_is_linked(sq_sequence_t seq) {
+
+    return seq->pattern->linked;
+
+}
+
 void sq_sequence_delete(sq_sequence_t seq) {
 
-    free(seq->trigs);
-    free(seq);
+    pattern_unref(seq->pattern);
+
+    // a lazy sequence's ringbuffer may have come from the heap once its
+    // arena was full
+    if (seq->rb && seq->arena && arena_owns(seq->arena, seq->rb)) {
+        arena_free(seq->arena, seq->rb);
+    } else if (seq->rb) {
+        jack_ringbuffer_free(seq->rb);
+    }
+
+    if (seq->arena) {
+        arena_free(seq->arena, seq);
+    } else {
+        free(seq);
+    }
+
+}
+
+size_t sequence_arena_size(int nsteps, int ntrigs, bool lazy) {
+
+    // what a loader carves from an arena for a sequence of nsteps holding
+    // ntrigs trigs: three blocks (struct, pattern and ringbuffer), each
+    // rounded up to a power of two (the ringbuffer's twice over). the
+    // pattern is packed if it's sparse enough, and a lazy one only needs
+    // the struct
+
+    size_t rb_size = 1, size = 0;
+    size_t sizes[3];
+
+    while (rb_size < SEQUENCE_RB_LENGTH * sizeof(sequence_ctrl_msg_t)) rb_size <<= 1;
+
+    sizes[0] = sizeof(struct sequence_data);
+    sizes[1] = pattern_fits_packed(nsteps, ntrigs) ? pattern_packed_alloc_size(ntrigs)
+                                                    : pattern_alloc_size(nsteps);
+    sizes[2] = sizeof(jack_ringbuffer_t) + rb_size;
+
+    for (int i=0; i<(lazy ? 1 : 3); i++) {
+        size_t block = (size_t) 1 << ARENA_MIN_CLASS;
+        while (block < sizes[i] + ARENA_HEADER_SIZE) block <<= 1;
+        size += block;
+    }
+
+    return size;
 
 }
 
@@ -123,6 +198,11 @@ void sq_sequence_set_name(sq_sequence_t seq, const char *name) {
 
     // this parameter is safe to touch directly (for now)
 
+    char old_name[SEQUENCE_MAX_NAME_LEN + 1];
+
+    journal_name(seq->session, seq, name);
+
+    strcpy(old_name, seq->name);
     if (strlen(name) <= SEQUENCE_MAX_NAME_LEN) {
         strcpy(seq->name, name);
     } else {
@@ -130,16 +210,76 @@ void sq_sequence_set_name(sq_sequence_t seq, const char *name) {
         seq->name[SEQUENCE_MAX_NAME_LEN] = '\0';
     }
 
+    // the session looks its sequences up by name
+    if (seq->session) {
+        nameIndex_rekey(&seq->session->seq_names, old_name, seq);
+    }
+
 }
 
 void sq_sequence_set_outport(sq_sequence_t seq, sq_outport_t outport) {
 
+    // a lazy sequence is materialized once it can be heard
+    if (outport && !seq->mute) {
+        sequence_materialize(seq);
+    }
+
+    journal_outport(seq->session, seq, outport);
+
     seq->outport = outport;
 
 }
 
+void sq_sequence_add_fanout(sq_sequence_t seq, sq_outport_t outport) {
+
+    // the sequence's events are copied to outport as well as to its own, for
+    // one pattern to drive several instruments. outport is referred to by
+    // its index in the session it's registered with, so it must be registered
+    // first. the sequence still needs an outport of its own to be heard
+
+    if (outport->index < 0) {
+        fprintf(stderr, "fanout outport %s isn't registered\n", outport->name);
+        return;
+    }
+
+    journal_fanout(seq->session, seq, seq->fanout | (1u << outport->index));
+
+    seq->fanout |= 1u << outport->index;
+
+}
+
+void sq_sequence_rm_fanout(sq_sequence_t seq, sq_outport_t outport) {
+
+    if (outport->index < 0) return;
+
+    journal_fanout(seq->session, seq, seq->fanout & ~(1u << outport->index));
+
+    seq->fanout &= ~(1u << outport->index);
+
+}
+
 void sq_sequence_set_trig(sq_sequence_t seq, int step, sq_trigger_t trig) {
 
+    struct trigger_data before;
+
+    if ((step < 0) || (step >= seq->nsteps)) {
+        fprintf(stderr, "step index %d out of range\n", step);
+        return;
+    }
+
+    if (sequence_history(seq)) {
+        pattern_read(seq->pattern, step, 1, &before);
+        history_record_trig(sequence_history(seq), seq, step, &before, trig);
+    }
+
+    journal_trig(seq->session, seq, step, trig);
+
+    if (sequence_edit_packed(seq, step, 1, trig)) {
+        return;
+    }
+
+    sequence_own_pattern(seq);
+
     if (seq->is_playing) {
 
         sequence_ctrl_msg_t msg;
@@ -150,10 +290,10 @@ void sq_sequence_set_trig(sq_sequence_t seq, int step, sq_trigger_t trig) {
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -166,46 +306,118 @@ void sq_sequence_set_trig(sq_sequence_t seq, int step, sq_trigger_t trig) {
 
 void sq_sequence_get_trig(sq_sequence_t seq, size_t step, sq_trigger_t trig) {
 
+    sq_sequence_get_trigs(seq, step, 1, trig);
+
+}
+
+void sq_sequence_get_trigs(sq_sequence_t seq, int first, int n, sq_trigger_t trigs) {
+
+    // copies out n trigs starting from step first, into an array of n. this
+    // doesn't need a message even while playing: it's a lock-free read that
+    // retries if the RT thread writes to the pattern meanwhile
+
+    if ((first < 0) || (n < 0) || (first + n > seq->nsteps)) {
+        fprintf(stderr, "step range [%d, %d) out of range\n", first, first + n);
+        return;
+    }
+
+    pattern_read(seq->pattern, first, n, trigs);
+
+}
+
+void sq_sequence_set_trigs(sq_sequence_t seq, int first, int n, sq_trigger_t trigs) {
+
+    // copies in n trigs starting from step first, from an array of n, in
+    // one message. they are recorded in the history as one edit
+
+    history_t *history;
+    struct trigger_data before;
+
+    if ((first < 0) || (n < 0) || (first + n > seq->nsteps)) {
+        fprintf(stderr, "step range [%d, %d) out of range\n", first, first + n);
+        return;
+    }
+
+    if ((history = sequence_history(seq))) {
+        history_begin(history);
+        for (int i=0; i<n; i++) {
+            pattern_read(seq->pattern, first + i, 1, &before);
+            history_record_trig(history, seq, first + i, &before, trigs + i);
+        }
+        history_end(history);
+    }
+
+    for (int i=0; i<n; i++) {
+        journal_trig(seq->session, seq, first + i, trigs + i);
+    }
+
+    if (sequence_edit_packed(seq, first, n, trigs)) {
+        return;
+    }
+
+    sequence_own_pattern(seq);
+
     if (seq->is_playing) {
 
         sequence_ctrl_msg_t msg;
-        msg.param = SEQUENCE_GET_TRIG;
-        msg.vi = step;
-        msg.vp = trig;
+        msg.param = SEQUENCE_SET_TRIGS;
+        msg.vi = first;
+        msg.vn = n;
+        msg.vp = trigs;
 
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
 
-        sequence_get_trig_now(seq, step, trig);
+        sequence_set_trigs_now(seq, first, n, trigs);
 
     }
 
-    
 }
 
 void sq_sequence_clear_trig(sq_sequence_t seq, int step) {
 
+    struct trigger_data before, cleared;
+
+    if ((step < 0) || (step >= seq->nsteps)) {
+        fprintf(stderr, "step index %d out of range\n", step);
+        return;
+    }
+
+    pattern_read(seq->pattern, step, 1, &before);
+    cleared = before;
+    cleared.type = TRIG_NULL;
+    if (sequence_history(seq)) {
+        history_record_trig(sequence_history(seq), seq, step, &before, &cleared);
+    }
+    journal_param(seq->session, seq, SEQUENCE_CLEAR_TRIG, step);
+
+    if (sequence_edit_packed(seq, step, 1, &cleared)) {
+        return;
+    }
+
+    sequence_own_pattern(seq);
+
     if (seq->is_playing) {
 
         sequence_ctrl_msg_t msg;
-        msg.param = SEQUENCE_SET_TRIG;
+        msg.param = SEQUENCE_CLEAR_TRIG;
         msg.vi = step;
 
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -218,6 +430,13 @@ void sq_sequence_clear_trig(sq_sequence_t seq, int step) {
 
 void sq_sequence_set_transpose(sq_sequence_t seq, int transpose) {
 
+    if (sequence_history(seq)) {
+        history_record_int(sequence_history(seq), seq, SEQUENCE_TRANSPOSE,
+                            seq->transpose, transpose);
+    }
+
+    journal_param(seq->session, seq, SEQUENCE_TRANSPOSE, transpose);
+
     if (seq->is_playing) {
 
         sequence_ctrl_msg_t msg;
@@ -227,10 +446,10 @@ void sq_sequence_set_transpose(sq_sequence_t seq, int transpose) {
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -252,10 +471,10 @@ void sq_sequence_set_playhead(sq_sequence_t seq, int ph) {
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -268,6 +487,12 @@ void sq_sequence_set_playhead(sq_sequence_t seq, int ph) {
 
 void sq_sequence_set_motion(sq_sequence_t seq, enum motion_type motion) {
 
+    if (sequence_history(seq)) {
+        history_record_int(sequence_history(seq), seq, SEQUENCE_MOTION, seq->motion, motion);
+    }
+
+    journal_param(seq->session, seq, SEQUENCE_MOTION, motion);
+
     if (seq->is_playing) {
 
         sequence_ctrl_msg_t msg;
@@ -277,10 +502,10 @@ void sq_sequence_set_motion(sq_sequence_t seq, enum motion_type motion) {
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -299,6 +524,12 @@ enum motion_type sq_sequence_get_motion(sq_sequence_t seq) {
 
 void sq_sequence_set_first(sq_sequence_t seq, int first) {
 
+    if (sequence_history(seq)) {
+        history_record_int(sequence_history(seq), seq, SEQUENCE_FIRST, seq->first, first);
+    }
+
+    journal_param(seq->session, seq, SEQUENCE_FIRST, first);
+
     if (seq->is_playing) {
 
         sequence_ctrl_msg_t msg;
@@ -308,10 +539,10 @@ void sq_sequence_set_first(sq_sequence_t seq, int first) {
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -324,6 +555,12 @@ void sq_sequence_set_first(sq_sequence_t seq, int first) {
 
 void sq_sequence_set_last(sq_sequence_t seq, int last) {
 
+    if (sequence_history(seq)) {
+        history_record_int(sequence_history(seq), seq, SEQUENCE_LAST, seq->last, last);
+    }
+
+    journal_param(seq->session, seq, SEQUENCE_LAST, last);
+
     if (seq->is_playing) {
 
         sequence_ctrl_msg_t msg;
@@ -333,10 +570,10 @@ void sq_sequence_set_last(sq_sequence_t seq, int last) {
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -349,6 +586,12 @@ void sq_sequence_set_last(sq_sequence_t seq, int last) {
 
 void sq_sequence_set_clockdivide(sq_sequence_t seq, int div) {
 
+    if (sequence_history(seq)) {
+        history_record_int(sequence_history(seq), seq, SEQUENCE_DIV, seq->div, div);
+    }
+
+    journal_param(seq->session, seq, SEQUENCE_DIV, div);
+
     if (seq->is_playing) {
 
         sequence_ctrl_msg_t msg;
@@ -358,10 +601,10 @@ void sq_sequence_set_clockdivide(sq_sequence_t seq, int div) {
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -374,7 +617,19 @@ void sq_sequence_set_clockdivide(sq_sequence_t seq, int div) {
 
 void sq_sequence_set_mute(sq_sequence_t seq, bool mute) {
 
-    if (seq->is_playing) {
+    if (!mute && seq->outport) {
+        sequence_materialize(seq);
+    }
+
+    if (sequence_history(seq)) {
+        history_record_int(sequence_history(seq), seq, SEQUENCE_MUTE, seq->mute, mute);
+    }
+
+    journal_param(seq->session, seq, SEQUENCE_MUTE, mute);
+
+    // the RT thread doesn't look at a lazy sequence's mute, so it's set in
+    // place, and muting doesn't materialize it
+    if (seq->is_playing && !atomic_load_explicit(&seq->lazy, memory_order_relaxed)) {
 
         sequence_ctrl_msg_t msg;
         msg.param = SEQUENCE_MUTE;
@@ -383,10 +638,10 @@ void sq_sequence_set_mute(sq_sequence_t seq, bool mute) {
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -399,6 +654,10 @@ void sq_sequence_set_mute(sq_sequence_t seq, bool mute) {
 
 void sq_sequence_set_swing(sq_sequence_t seq, float swing) {
 
+    if (sequence_history(seq)) {
+        history_record_float(sequence_history(seq), seq, SEQUENCE_SWING, seq->swing, swing);
+    }
+
     if (seq->is_playing) {
 
         sequence_ctrl_msg_t msg;
@@ -408,10 +667,10 @@ void sq_sequence_set_swing(sq_sequence_t seq, float swing) {
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -424,6 +683,11 @@ void sq_sequence_set_swing(sq_sequence_t seq, float swing) {
 
 void sq_sequence_set_swingType(sq_sequence_t seq, enum swing_type swingType) {
 
+    if (sequence_history(seq)) {
+        history_record_int(sequence_history(seq), seq, SEQUENCE_SWING_TYPE,
+                            seq->swingType, swingType);
+    }
+
     if (seq->is_playing) {
 
         sequence_ctrl_msg_t msg;
@@ -433,10 +697,10 @@ void sq_sequence_set_swingType(sq_sequence_t seq, enum swing_type swingType) {
         bool done = false;
         msg.donep = &done;
 
-        sequence_ringbuffer_write(seq, &msg);
-
-        while (!done) {
-            usleep(1000);
+        if (sequence_ringbuffer_write(seq, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
 
     } else {
@@ -449,47 +713,54 @@ void sq_sequence_set_swingType(sq_sequence_t seq, enum swing_type swingType) {
 
 void sq_sequence_pprint(sq_sequence_t seq) {
 
-    if (seq->is_playing) {
+    // prints a consistent copy of the trigs, so it works while playing
 
-        printf("Cannot print sequence while playing.\nTry stopping the session first.\n");
+    int charCount = 0;
+    bool newLineLast = false;
+    struct trigger_data *trigs = malloc(seq->nsteps * sizeof(struct trigger_data));
 
-    } else {
+    pattern_read(seq->pattern, 0, seq->nsteps, trigs);
 
-        int charCount = 0;
-        bool newLineLast = false;
+    for (int step = 0; step < seq->nsteps; step++) {
 
-        for (int step = 0; step < seq->nsteps; step++) {
+        if (charCount == 0) {
+            printf("|");
+            charCount += 1;
+        }
 
-            if (charCount == 0) {
-                printf("|");
-                charCount += 1;
-            }
+        if (trigs[step].type == TRIG_NULL) {
+            printf("....|");
+            charCount += 5;
+            newLineLast = false;
+        } else if (trigs[step].type == TRIG_NOTE) {
+            printf("N%03d|", trigs[step].note_value);
+            charCount += 5;
+            newLineLast = false;
+        } else if (trigs[step].type == TRIG_CC) {
+            printf("C%03d|", trigs[step].cc_value);
+            charCount += 5;
+            newLineLast = false;
+        }
 
-            if (seq->trigs[step].type == TRIG_NULL) {
-                printf("....|");
-                charCount += 5;
-                newLineLast = false;
-            } else if (seq->trigs[step].type == TRIG_NOTE) {
-                printf("N%03d|", seq->trigs[step].note_value);
-                charCount += 5;
-                newLineLast = false;
-            } else if (seq->trigs[step].type == TRIG_CC) {
-                printf("C%03d|", seq->trigs[step].cc_value);
-                charCount += 5;
-                newLineLast = false;
-            }
+        if (charCount == 81) {
+            printf("\n");
+            newLineLast = true;
+            charCount = 0;
+        }
 
-            if (charCount == 81) {
-                printf("\n");
-                newLineLast = true;
-                charCount = 0;
-            }
+    }
 
-        }
+    if (!newLineLast) printf("\n");
 
-        if (!newLineLast) printf("\n");
+    free(trigs);
 
-    }
+}
+
+void sq_sequence_get_stats(sq_sequence_t seq, struct sq_sequence_stats *stats) {
+
+    stats->events = STATS_GET(seq->stats.events);
+    stats->prob_skips = STATS_GET(seq->stats.prob_skips);
+    stats->rb_overflows = STATS_GET(seq->stats.rb_overflows);
 
 }
 
@@ -644,10 +915,111 @@ int sq_sequence_get_last(sq_sequence_t seq) {
 
 // PUBLIC CODE
 
+void sequence_materialize(sq_sequence_t seq) {
+
+    // gives a lazy sequence a pattern to play, unpacked unless it's long and
+    // sparse, and its ringbuffer. the RT thread leaves both alone until lazy
+    // is cleared, and from then on plays the sequence like any other. the
+    // packed pattern is let go of, as a snapshot may still share it
+
+    pattern_t *packed = seq->pattern;
+
+    if (!atomic_load_explicit(&seq->lazy, memory_order_relaxed)) return;
+
+    if (pattern_is_packed(packed)) {
+        seq->pattern = pattern_fit(packed, seq->arena);
+        seq->trigs = seq->pattern->trigs;
+        seq->cursor = -1;
+    }
+    seq->rb = sequence_rb_new(seq->arena);
+
+    atomic_store_explicit(&seq->lazy, false, memory_order_release);
+
+    if (seq->pattern != packed) {
+        pattern_unref(packed);
+    }
+
+}
+
+void sequence_own_pattern(sq_sequence_t seq) {
+
+    // copy on write: before editing a pattern shared with a clone, take a
+    // copy of it. linked patterns are edited in place, for every sequence,
+    // and a packed one, which can't be, is unpacked
+
+    sequence_materialize(seq);
+
+    if (pattern_is_packed(seq->pattern)
+            || (pattern_is_shared(seq->pattern) && !seq->pattern->linked)) {
+        sequence_swap_pattern(seq, pattern_copy(seq->pattern, seq->arena));
+    }
+
+}
+
+bool sequence_edit_packed(sq_sequence_t seq, int first, int n, sq_trigger_t trigs) {
+
+    // a packed pattern isn't written in place: the edit makes a new one,
+    // packed again if it's still sparse enough, which is swapped in. returns
+    // false, having done nothing, if seq's pattern isn't packed
+
+    pattern_t *pattern;
+
+    sequence_materialize(seq);
+
+    if (!pattern_is_packed(seq->pattern)) {
+        return false;
+    }
+
+    if ((first < 0) || (n < 0) || (first + n > seq->nsteps)) {
+        fprintf(stderr, "step range [%d, %d) out of range\n", first, first + n);
+        return true;
+    }
+
+    pattern = pattern_edit(seq->pattern, first, n, trigs, seq->arena);
+    if (!sequence_swap_pattern(seq, pattern)) {
+        pattern_unref(pattern);
+    }
+
+    return true;
+
+}
+
+void sequence_link_pattern(sq_sequence_t seq, sq_sequence_t src) {
+
+    // makes seq play src's pattern, linked, in place of its own. both must
+    // have the same number of steps
+
+    if (seq->nsteps != src->nsteps) {
+        fprintf(stderr, "can't link sequences of %d and %d steps\n", seq->nsteps, src->nsteps);
+        return;
+    }
+
+    sequence_own_pattern(src);
+    src->pattern->linked = true;
+    pattern_ref(src->pattern);
+
+    if (!sequence_swap_pattern(seq, src->pattern)) {
+        pattern_unref(src->pattern);
+    }
+
+}
+
+void sequence_set_recorded(sq_sequence_t seq) {
+
+    // an inport may record into seq's trigs from the RT thread,
+    // which can't copy on write, so make sure it has a pattern of its own,
+    // unpacked
+
+    sequence_own_pattern(seq);
+    seq->recorded = true;
+
+}
+
 void sequence_reset_now(sq_sequence_t seq) {
 
     seq->idiv = 0;
     seq->step = seq->first;
+    seq->trig_pending = true;
 
     seq->swingFlag = false;
 
@@ -666,7 +1038,13 @@ midiEvent sequence_process(sq_sequence_t seq, jack_nframes_t fps,
     midiEvent mev; // tmp value
 
     if (start + len > fps) {   // this should never happen
-        fprintf(stderr, "sequence_process() crossed step boundary: %s\n", seq->name);
+        rtlog_write_str("sequence_process() crossed step boundary: %s\n", seq->name);
+        return MIDIEVENT_NULL;
+    }
+
+    // a lazy sequence can't be heard, and has nothing to serve
+    if (atomic_load_explicit(&seq->lazy, memory_order_acquire)) {
+        seq->trig_pending = false;
         return MIDIEVENT_NULL;
     }
 
@@ -675,49 +1053,69 @@ midiEvent sequence_process(sq_sequence_t seq, jack_nframes_t fps,
 
     float frac;
 
+    // each step's trig is considered once, in the chunk where it lands
+    if (seq->idiv || !seq->trig_pending) return MIDIEVENT_NULL;
+
+    trig = sequence_trig(seq);
+
+    frac = 0.5 + trig->microtime;
+    if (seq->swingType == SWING_ODD) {
+        // determines swing by step number
+        if (seq->step % 2) {
+            // odd-numbered steps get swing (zero-indexed)
+            frac += (0.5 - trig->microtime)*seq->swing;
+        }
+    } else if (seq->swingType == SWING_ALTERNATE) {
+        // determines swing by step-wise alternating flag
+        if (seq->swingFlag) {
+            frac += (0.5 - trig->microtime)*seq->swing;
+        }
+    }
+    frame_trig = fps * frac;  // integer assignment rounds down
+
+    if (frame_trig >= start + len) return MIDIEVENT_NULL;    // not yet
+
+    seq->trig_pending = false;
+
     // output JACK MIDI
-    if (!seq->mute && seq->outport && !seq->idiv) {
-        trig = seq->trigs + seq->step;
-        if (trig->type != TRIG_NULL) {
-            if (trig->probability >= ((float) random()) / RAND_MAX) {
-
-                frac = 0.5 + trig->microtime;
-                if (seq->swingType == SWING_ODD) {
-                    // determines swing by step number
-                    if (seq->step % 2) {
-                        // odd-numbered steps get swing (zero-indexed)
-                        frac += (0.5 - trig->microtime)*seq->swing;
-                    }
-                } else if (seq->swingType == SWING_ALTERNATE) {
-                    // determines swing by step-wise alternating flag
-                    if (seq->swingFlag) {
-                        frac += (0.5 - trig->microtime)*seq->swing;
-                    }
-                }
-                frame_trig = fps * frac;  // integer assignment rounds down
-
-                if ((frame_trig >= start) && (frame_trig < start + len)) {
-
-                    mev.buf = seq->outport->buf;
-                    mev.time = frame_trig - start;
-                    if (trig->type == TRIG_NOTE) {
-                        mev.type = MEV_TYPE_NOTEON;
-                        mev.status = 143 + trig->channel;   // note on
-                        mev.data1 = trig->note_value + seq->transpose;
-                        mev.data2 = trig->note_velocity;
-                        mev.length = trig->note_length * fps;
-                    } else if (trig->type == TRIG_CC) {
-                        mev.type = MEV_TYPE_CC;
-                        mev.status = 175 + trig->channel;   // control change
-                        mev.data1 = trig->cc_number;
-                        mev.data2 = trig->cc_value;
-                    }
-
-                    return mev;
+    if (!seq->mute && seq->outport && (trig->type != TRIG_NULL)) {
 
-                }
-            }
+        // roll the dice
+        if (trig->probability < sequence_random(seq)) {
+            STATS_INC(seq->stats.prob_skips);
+            return MIDIEVENT_NULL;
+        }
+
+        // a tempo change can leave the trig's frame behind the chunk we're in;
+        // rather than skip it, fire it at the start of the chunk
+        if (frame_trig < start) frame_trig = start;
+
+        // a trig with an outport of its own plays through that one alone.
+        // the fanout is left for the session to copy the event into
+        mev.outport = seq->outport;
+        mev.fanout = seq->fanout;
+        if ((trig->outport >= 0) && seq->session && (trig->outport < seq->session->noutports)) {
+            mev.outport = seq->session->outports[trig->outport];
+            mev.fanout = 0;
         }
+        mev.time = buf_offset + frame_trig - start;
+        mev.size = 3;
+        if (trig->type == TRIG_NOTE) {
+            mev.type = MEV_TYPE_NOTEON;
+            mev.status = 143 + trig->channel;   // note on
+            mev.data1 = trig->note_value + seq->transpose;
+            mev.data2 = trig->note_velocity;
+            mev.length = trig->note_length * fps;
+        } else if (trig->type == TRIG_CC) {
+            mev.type = MEV_TYPE_CC;
+            mev.status = 175 + trig->channel;   // control change
+            mev.data1 = trig->cc_number;
+            mev.data2 = trig->cc_value;
+        }
+
+        STATS_INC(seq->stats.events);
+        return mev;
+
     }
 
     return MIDIEVENT_NULL;
@@ -727,51 +1125,12 @@ midiEvent sequence_process(sq_sequence_t seq, jack_nframes_t fps,
 void sequence_step(sq_sequence_t seq) {
 
     seq->idiv++;
+    seq->trig_pending = true;
 
     if (seq->idiv == seq->div) {
 
         // increment
-        if (seq->motion == MOTION_FORWARD) {
-
-            if (seq->step == seq->last) {
-                seq->step = seq->first;
-            } else if (++(seq->step) == seq->nsteps) {
-                seq->step = 0;
-            }
-
-        } else if (seq->motion == MOTION_BACKWARD) {
-
-            if (seq->step == seq->first) {
-                seq->step = seq->last;
-            } else if (--(seq->step) == -1) {
-                seq->step = seq->nsteps - 1;
-            }
-
-        } else if (seq->motion == MOTION_BOUNCE) {
-
-            if (seq->step == seq->last) {
-                seq->step--;
-                seq->bounce_forward = false;
-            } else if (seq->step == seq->first) {
-                seq->step++;
-                seq->bounce_forward = true;
-            } else {
-                if (seq->bounce_forward) {
-                    if (seq->step == (seq->nsteps-1)) {
-                        seq->step = 0;
-                    } else {
-                        seq->step++;
-                    }
-                } else {
-                    if (seq->step == 0) {
-                        seq->step = seq->nsteps - 1;
-                    } else {
-                        seq->step--;
-                    }
-                }
-            }
-
-        }
+        seq->step = sequence_next_step(seq, &seq->bounce_forward);
 
         // and send a notification
         if (seq->noti_enable) {
@@ -789,124 +1148,274 @@ void sequence_step(sq_sequence_t seq) {
 
 }
 
-json_object *sequence_get_json(sq_sequence_t seq) {
-
-    json_object *jo_sequence = json_object_new_object();
+int sequence_peek_step(sq_sequence_t seq) {
 
-    json_object_object_add(jo_sequence, "name",
-                            json_object_new_string(seq->name));
+    // the step that will follow the current one, without advancing
 
-    json_object_object_add(jo_sequence, "nsteps",
-                            json_object_new_int(sq_sequence_get_nsteps(seq)));
+    bool bounce_forward = seq->bounce_forward;
 
-    json_object_object_add(jo_sequence, "mute",
-                            json_object_new_boolean(sq_sequence_get_mute(seq)));
+    return sequence_next_step(seq, &bounce_forward);
 
-    json_object_object_add(jo_sequence, "transpose",
-                            json_object_new_int(sq_sequence_get_transpose(seq)));
+}
 
-    json_object_object_add(jo_sequence, "clockdivide",
-                            json_object_new_int(sq_sequence_get_clockdivide(seq)));
+void sequence_write_json(sq_sequence_t seq, jsonWriter_t *jw, sq_session_t sesh, int link) {
 
-    json_object_object_add(jo_sequence, "first",
-                            json_object_new_int(sq_sequence_get_first(seq)));
+    // link is the index of the sequence whose pattern this one shares, or -1.
+    // the trigs are read one at a time, consistently even while playing.
+    // only the steps that don't hold the default trig are written, each
+    // with its index. the fanout is written by name, from sesh's outports
 
-    json_object_object_add(jo_sequence, "last",
-                            json_object_new_int(sq_sequence_get_last(seq)));
+    struct trigger_data trig;
 
-    json_object_object_add(jo_sequence, "last",
-                            json_object_new_int(sq_sequence_get_last(seq)));
+    jsonWriter_begin_object(jw, NULL);
 
-    json_object_object_add(jo_sequence, "motion",
-                            json_object_new_int(sq_sequence_get_motion(seq)));
+    jsonWriter_string(jw, "name", seq->name);
+    jsonWriter_int(jw, "nsteps", sq_sequence_get_nsteps(seq));
+    jsonWriter_bool(jw, "mute", sq_sequence_get_mute(seq));
+    jsonWriter_int(jw, "transpose", sq_sequence_get_transpose(seq));
+    jsonWriter_int(jw, "clockdivide", sq_sequence_get_clockdivide(seq));
+    jsonWriter_int(jw, "first", sq_sequence_get_first(seq));
+    jsonWriter_int(jw, "last", sq_sequence_get_last(seq));
+    jsonWriter_int(jw, "motion", sq_sequence_get_motion(seq));
 
-    json_object *trigger_array = json_object_new_array();
+    jsonWriter_begin_array(jw, "triggers");
     for (int i=0; i<seq->nsteps; i++) {
-        json_object_array_add(trigger_array, trigger_get_json(seq->trigs + i));
+        pattern_read(seq->pattern, i, 1, &trig);
+        if (!trigger_is_default(&trig)) {
+            trigger_write_json(&trig, jw, i);
+        }
     }
-    json_object_object_add(jo_sequence, "triggers", trigger_array);
+    jsonWriter_end_array(jw);
 
     if (seq->outport) {
-        json_object_object_add(jo_sequence, "outport",
-                                json_object_new_string(seq->outport->name));
+        jsonWriter_string(jw, "outport", seq->outport->name);
     } else {
-        json_object_object_add(jo_sequence, "outport", NULL);
+        jsonWriter_null(jw, "outport");
+    }
+
+    if (seq->fanout) {
+        jsonWriter_begin_array(jw, "fanout");
+        for (int i=0; i<sesh->noutports; i++) {
+            if (seq->fanout & (1u << i)) {
+                jsonWriter_string(jw, NULL, sesh->outports[i]->name);
+            }
+        }
+        jsonWriter_end_array(jw);
+    }
+
+    if (link >= 0) {
+        jsonWriter_int(jw, "link", link);
     }
 
-    return jo_sequence;
+    jsonWriter_end_object(jw);
 
 }
 
-sq_sequence_t sequence_malloc_from_json(json_object *jo_seq) {
+size_t sequence_read_json_arena_size(jsonReader_t *jr, sq_session_t sesh) {
+
+    // what sequence_read_json will carve from the arena for this sequence,
+    // counting its trigs without reading them. the session's outports must
+    // be in already
+
+    const char *key;
+    int nsteps = 0, ntrigs = 0, link = -1;
+    bool mute = false;
+    sq_outport_t outport = NULL;
+
+    jsonReader_begin_object(jr);
+    while (jsonReader_next_key(jr, &key)) {
+        if (!strcmp(key, "nsteps")) {
+            nsteps = jsonReader_int(jr);
+        } else if (!strcmp(key, "mute")) {
+            mute = jsonReader_bool(jr);
+        } else if (!strcmp(key, "link")) {
+            link = jsonReader_int(jr);
+        } else if (!strcmp(key, "outport") && (jsonReader_peek(jr) == JSON_STRING)) {
+            outport = session_get_outport_from_name(sesh, jsonReader_string(jr));
+        } else if (!strcmp(key, "triggers") && (jsonReader_peek(jr) == JSON_ARRAY)) {
+            jsonReader_begin_array(jr);
+            while (jsonReader_next_element(jr)) {
+                jsonReader_skip(jr);
+                ntrigs++;
+            }
+        } else {
+            jsonReader_skip(jr);
+        }
+    }
 
-    struct json_object *jo_tmp, *jo_trig;
-    const char *name;
-    int nsteps, transpose, clockdivide, first, last;
-    bool mute;
-    enum motion_type motion;
-    sq_sequence_t seq;
-    sq_trigger_t trig;
+    if (nsteps <= 0) {
+        return 0;
+    }
 
-    // first extract the top-level attributes
+    return sequence_arena_size(nsteps, ntrigs, sequence_loads_packed(mute, outport, link));
 
-    json_object_object_get_ex(jo_seq, "name", &jo_tmp);
-    name = json_object_get_string(jo_tmp);
+}
 
-    json_object_object_get_ex(jo_seq, "nsteps", &jo_tmp);
-    nsteps = json_object_get_int(jo_tmp);
+sq_sequence_t sequence_read_json(jsonReader_t *jr, sq_session_t sesh, arena_t *arena) {
+
+    // the trigs are parsed straight into the new sequence's pattern. the
+    // members can come in any order, and the trigs can only be read once
+    // nsteps is known, so they are read on a second pass. a sequence that
+    // is linked to an earlier one in the session shares its pattern, and
+    // one that can't be heard is packed, and left lazy. a long one is read
+    // into a scratch pattern first, to be packed if it's sparse enough.
+    //
+    // a trig with a "step" goes to that step, and one without to the step
+    // after the previous one, so both the sparse form and the older dense
+    // one, listing every step in order, are read
+
+    const char *key, *triggers = NULL, *fanout = NULL, *end;
+    char name[SEQUENCE_MAX_NAME_LEN + 1] = "";
+    char outport[OUTPORT_MAX_NAME_LEN + 1] = "";
+    int nsteps = 0, transpose = 0, clockdivide = 1, first = 0, last = -1, link = -1;
+    bool mute = false;
+    enum motion_type motion = MOTION_FORWARD;
+    sq_sequence_t seq;
+    sq_outport_t outport_tmp = NULL;
+    pattern_t *pattern;
 
-    json_object_object_get_ex(jo_seq, "mute", &jo_tmp);
-    mute = json_object_get_boolean(jo_tmp);
+    // first extract the top-level attributes
 
-    json_object_object_get_ex(jo_seq, "transpose", &jo_tmp);
-    transpose = json_object_get_int(jo_tmp);
+    jsonReader_begin_object(jr);
+    while (jsonReader_next_key(jr, &key)) {
+        if (!strcmp(key, "name")) {
+            snprintf(name, sizeof(name), "%s", jsonReader_string(jr));
+        } else if (!strcmp(key, "nsteps")) {
+            nsteps = jsonReader_int(jr);
+        } else if (!strcmp(key, "mute")) {
+            mute = jsonReader_bool(jr);
+        } else if (!strcmp(key, "transpose")) {
+            transpose = jsonReader_int(jr);
+        } else if (!strcmp(key, "clockdivide")) {
+            clockdivide = jsonReader_int(jr);
+        } else if (!strcmp(key, "first")) {
+            first = jsonReader_int(jr);
+        } else if (!strcmp(key, "last")) {
+            last = jsonReader_int(jr);
+        } else if (!strcmp(key, "motion")) {
+            motion = jsonReader_int(jr);
+        } else if (!strcmp(key, "link")) {
+            link = jsonReader_int(jr);
+        } else if (!strcmp(key, "outport") && (jsonReader_peek(jr) == JSON_STRING)) {
+            snprintf(outport, sizeof(outport), "%s", jsonReader_string(jr));
+        } else if (!strcmp(key, "triggers")) {
+            triggers = jsonReader_tell(jr);
+            jsonReader_skip(jr);
+        } else if (!strcmp(key, "fanout") && (jsonReader_peek(jr) == JSON_ARRAY)) {
+            fanout = jsonReader_tell(jr);
+            jsonReader_skip(jr);
+        } else {
+            jsonReader_skip(jr);
+        }
+    }
+    end = jsonReader_tell(jr);
 
-    json_object_object_get_ex(jo_seq, "clockdivide", &jo_tmp);
-    clockdivide = json_object_get_int(jo_tmp);
+    if (jsonReader_failed(jr) || (nsteps <= 0)) {
+        return NULL;
+    }
 
-    json_object_object_get_ex(jo_seq, "first", &jo_tmp);
-    first = json_object_get_int(jo_tmp);
+    if (link >= sq_session_get_nseqs(sesh)) {
+        link = -1;
+    }
+    if (outport[0]) {
+        outport_tmp = session_get_outport_from_name(sesh, outport);
+    }
 
-    json_object_object_get_ex(jo_seq, "last", &jo_tmp);
-    last = json_object_get_int(jo_tmp);
+    // malloc the sequence, with its triggers or the pattern of the sequence
+    // it's linked to
 
-    json_object_object_get_ex(jo_seq, "motion", &jo_tmp);
-    motion = json_object_get_int(jo_tmp);
+    if (nsteps > SEQUENCE_MAX_NSTEPS) {
+        fprintf(stderr, "nsteps of %d exceeds max of %d\n", nsteps, SEQUENCE_MAX_NSTEPS);
+        return NULL;
+    }
 
-    // malloc and init the sequence
+    if (link >= 0) {
+        seq = sequence_new(nsteps, arena);
+        sequence_link_pattern(seq, sq_session_get_seq(sesh, link));
+    } else if (sequence_loads_packed(mute, outport_tmp, link)) {
+        pattern = pattern_new(nsteps, NULL);
+        sequence_read_json_trigs(jr, triggers, pattern->trigs, nsteps);
+        seq = sequence_new_pattern(pattern_pack(pattern, NULL), arena, true);
+        pattern_unref(pattern);
+    } else if (nsteps > PATTERN_DENSE_NSTEPS) {
+        pattern = pattern_new(nsteps, NULL);
+        sequence_read_json_trigs(jr, triggers, pattern->trigs, nsteps);
+        seq = sequence_new_pattern(pattern_fit(pattern, arena), arena, false);
+        pattern_unref(pattern);
+    } else {
+        seq = sequence_new_pattern(pattern_new(nsteps, arena), arena, false);
+        sequence_read_json_trigs(jr, triggers, seq->trigs, nsteps);
+    }
 
-    seq = sq_sequence_new(nsteps);
+    // then init it
     sq_sequence_set_name(seq, name);
     sq_sequence_set_mute(seq, mute);
     sq_sequence_set_transpose(seq, transpose);
     sq_sequence_set_clockdivide(seq, clockdivide);
     sq_sequence_set_first(seq, first);
-    sq_sequence_set_last(seq, last);
+    sq_sequence_set_last(seq, (last < 0) ? nsteps - 1 : last);
     sq_sequence_set_motion(seq, motion);
 
-    // then set the triggers
-    json_object_object_get_ex(jo_seq, "triggers", &jo_tmp);
-    for (int i=0; i<nsteps; i++) {
-        jo_trig = json_object_array_get_idx(jo_tmp, i);
-        // trigs get copied into seqs, so we don't need to malloc them
-        trig = trigger_malloc_from_json(jo_trig);
-        sq_sequence_set_trig(seq, i, trig);
+    if (outport_tmp) {
+        sq_sequence_set_outport(seq, outport_tmp);
     }
 
+    if (fanout) {
+        jsonReader_seek(jr, fanout);
+        jsonReader_begin_array(jr);
+        while (jsonReader_next_element(jr)) {
+            outport_tmp = session_get_outport_from_name(sesh, jsonReader_string(jr));
+            if (outport_tmp) {
+                sq_sequence_add_fanout(seq, outport_tmp);
+            }
+        }
+    }
+
+    jsonReader_seek(jr, end);
+
     return seq;
 
 }
 
+bool sequence_loads_packed(bool mute, sq_outport_t outport, int link) {
+
+    // a sequence that can't be heard, muted or with nowhere to play, is
+    // loaded packed, unless it's linked (packed patterns never are)
+
+    return (link < 0) && (mute || !outport);
+
+}
+
 void sequence_set_trig_now(sq_sequence_t seq, int step_index, sq_trigger_t trig) {
 
     // this is a "copy-in" operation
 
     if ( (step_index < 0) || (step_index >= seq->nsteps) ) {
-        fprintf(stderr, "step index %d out of range\n", step_index);
+        rtlog_write_int("step index %d out of range\n", step_index);
         return;
     }
 
+    // a packed pattern has been edited already, by replacing it
+    if (!seq->trigs) return;
+
+    pattern_write_begin(seq->pattern);
     memcpy(seq->trigs + step_index, trig, sizeof(struct trigger_data));
+    pattern_write_end(seq->pattern);
+
+}
+
+void sequence_set_trigs_now(sq_sequence_t seq, int first, int n, sq_trigger_t trigs) {
+
+    if ((first < 0) || (n < 0) || (first + n > seq->nsteps)) {
+        rtlog_write_int("step range from %d out of range\n", first);
+        return;
+    }
+
+    if (!seq->trigs) return;
+
+    pattern_write_begin(seq->pattern);
+    memcpy(seq->trigs + first, trigs, n * sizeof(struct trigger_data));
+    pattern_write_end(seq->pattern);
 
 }
 
@@ -915,23 +1424,41 @@ void sequence_get_trig_now(sq_sequence_t seq, int step_index, sq_trigger_t trig)
     // this is a "copy-out" operation
 
     if ( (step_index < 0) || (step_index >= seq->nsteps) ) {
-        fprintf(stderr, "step index %d out of range\n", step_index);
+        rtlog_write_int("step index %d out of range\n", step_index);
         return;
     }
 
-    memcpy(trig, seq->trigs + step_index, sizeof(struct trigger_data));
+    if (seq->trigs) {
+        memcpy(trig, seq->trigs + step_index, sizeof(struct trigger_data));
+    } else {
+        pattern_read(seq->pattern, step_index, 1, trig);
+    }
 
 }
 
 void sequence_clear_trig_now(sq_sequence_t seq, int step_index) {
 
     if ( (step_index < 0) || (step_index >= seq->nsteps) ) {
-        fprintf(stderr, "step index %d out of range\n", step_index);
+        rtlog_write_int("step index %d out of range\n", step_index);
         return;
     }
 
+    if (!seq->trigs) return;
+
     sq_trigger_t trig = seq->trigs + step_index;
+    pattern_write_begin(seq->pattern);
     trig->type = TRIG_NULL;
+    pattern_write_end(seq->pattern);
+
+}
+
+void sequence_set_pattern_now(sq_sequence_t seq, pattern_t *pattern) {
+
+    // the UI thread holds on to the old pattern until this is done
+
+    seq->pattern = pattern;
+    seq->trigs = pattern->trigs;
+    seq->cursor = -1;
 
 }
 
@@ -949,7 +1476,7 @@ void sequence_set_transpose_now(sq_sequence_t seq, int transpose) {
 void sequence_set_playhead_now(sq_sequence_t seq, int ph) {
 
     if ( (ph < 0) || (ph >= seq->nsteps) ) {
-        fprintf(stderr, "playhead value out of range: %d\n", ph);
+        rtlog_write_int("playhead value out of range: %d\n", ph);
         return;
     }
 
@@ -965,7 +1492,7 @@ void sequence_set_playhead_now(sq_sequence_t seq, int ph) {
 void sequence_set_first_now(sq_sequence_t seq, int first) {
 
     if ( (first < 0) || (first >= seq->nsteps) ) {
-        fprintf(stderr, "first value out of range: %d\n", first);
+        rtlog_write_int("first value out of range: %d\n", first);
         return;
     }
 
@@ -982,7 +1509,7 @@ void sequence_set_first_now(sq_sequence_t seq, int first) {
 void sequence_set_last_now(sq_sequence_t seq, int last) {
 
     if ( (last < 0) || (last >= seq->nsteps) ) {
-        fprintf(stderr, "last value out of range: %d\n", last);
+        rtlog_write_int("last value out of range: %d\n", last);
         return;
     }
 
@@ -998,7 +1525,7 @@ void sequence_set_last_now(sq_sequence_t seq, int last) {
 void sequence_set_clockdivide_now(sq_sequence_t seq, int div) {
 
     if (div < 1) {
-        fprintf(stderr, "clock divide of %d is out of range (must be >= 1)\n", div);
+        rtlog_write_int("clock divide of %d is out of range (must be >= 1)\n", div);
         return;
     }
 
@@ -1050,16 +1577,24 @@ void sequence_set_swingType_now(sq_sequence_t seq, enum swing_type swingType) {
 
 // STATIC CODE
 
-static void sequence_ringbuffer_write(sq_sequence_t seq, sequence_ctrl_msg_t *msg) {
+static bool sequence_ringbuffer_write(sq_sequence_t seq, sequence_ctrl_msg_t *msg) {
+
+    // returns false if the message was dropped. a lazy sequence is
+    // materialized first, since it has nowhere to put the message
+
+    sequence_materialize(seq);
 
     int avail = jack_ringbuffer_write_space(seq->rb);
     if (avail < sizeof(sequence_ctrl_msg_t)) {
         fprintf(stderr, "sequence ringbuffer: overflow\n");
-        return;
+        STATS_INC(seq->stats.rb_overflows);
+        return false;
     }
 
     jack_ringbuffer_write(seq->rb, (const char*) msg, sizeof(sequence_ctrl_msg_t));
 
+    return true;
+
 }
 
 static void sequence_serve_ctrl_msgs(sq_sequence_t seq) {
@@ -1092,6 +1627,10 @@ static void sequence_serve_ctrl_msgs(sq_sequence_t seq) {
             sequence_get_trig_now(seq, msg.vi, msg.vp);
         } else if (msg.param == SEQUENCE_SWING) {
             sequence_set_swing_now(seq, msg.vf);
+        } else if (msg.param == SEQUENCE_SET_TRIGS) {
+            sequence_set_trigs_now(seq, msg.vi, msg.vn, msg.vp);
+        } else if (msg.param == SEQUENCE_SET_PATTERN) {
+            sequence_set_pattern_now(seq, msg.vpat);
         }
 
         *msg.donep = true;
@@ -1127,3 +1666,294 @@ static void notification_data_init(struct notification_data *noti) {
 
 }
 
+static int sequence_next_step(sq_sequence_t seq, bool *bounce_forward) {
+
+    // computes the step after the current one, according to the motion type.
+    // bounce_forward is updated in place (bounce motion only)
+
+    int step = seq->step;
+
+    if (seq->motion == MOTION_FORWARD) {
+
+        if (step == seq->last) {
+            step = seq->first;
+        } else if (++step == seq->nsteps) {
+            step = 0;
+        }
+
+    } else if (seq->motion == MOTION_BACKWARD) {
+
+        if (step == seq->first) {
+            step = seq->last;
+        } else if (--step == -1) {
+            step = seq->nsteps - 1;
+        }
+
+    } else if (seq->motion == MOTION_BOUNCE) {
+
+        // turn around at either end (and stay put on a one-step loop), then
+        // wrap around the ends of the pattern like the other motions do
+
+        if (seq->first == seq->last) {
+            step = seq->first;
+        } else {
+            if (step == seq->last) {
+                *bounce_forward = false;
+            } else if (step == seq->first) {
+                *bounce_forward = true;
+            }
+            if (*bounce_forward) {
+                if (++step == seq->nsteps) {
+                    step = 0;
+                }
+            } else {
+                if (--step == -1) {
+                    step = seq->nsteps - 1;
+                }
+            }
+        }
+
+    }
+
+    return step;
+
+}
+
+static inline sq_trigger_t sequence_trig(sq_sequence_t seq) {
+
+    // the current step's trig. a packed pattern is played through a cursor,
+    // the index of its first step from cursor_step on, which follows the
+    // playhead a step at a time either way, and searches again after a
+    // jump (a wrap, a new playhead or a new pattern)
+
+    pattern_t *pattern = seq->pattern;
+    int step = seq->step, c = seq->cursor;
+
+    if (seq->trigs) {
+        return seq->trigs + step;
+    }
+
+    if ((c >= 0) && (step == seq->cursor_step + 1)) {
+        if ((c < pattern->npacked) && (pattern->packed[c].step == seq->cursor_step)) c++;
+    } else if ((c >= 0) && (step == seq->cursor_step - 1)) {
+        if ((c > 0) && (pattern->packed[c - 1].step == step)) c--;
+    } else if ((c < 0) || (step != seq->cursor_step)) {
+        c = pattern_search(pattern, step);
+    }
+
+    seq->cursor = c;
+    seq->cursor_step = step;
+
+    if ((c < pattern->npacked) && (pattern->packed[c].step == step)) {
+        return &pattern->packed[c].trig;
+    }
+
+    return &seq->rest;
+
+}
+
+static inline float sequence_random(sq_sequence_t seq) {
+
+    // xorshift32, uniform on [0, 1]. libc's random() takes a lock, so it has
+    // no place on the RT thread
+
+    uint32_t x = seq->rng;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    seq->rng = x;
+
+    return (float) x / UINT32_MAX;
+
+}
+
+static sq_sequence_t sequence_alloc(pattern_t *pattern, arena_t *arena, bool lazy) {
+
+    // takes over the caller's reference to pattern. a lazy sequence has no
+    // ringbuffer
+
+    sq_sequence_t seq = NULL;
+
+    // carve the sequence from the arena, which is already locked; if it's
+    // full, fall back to the heap
+    if (arena) {
+        seq = arena_alloc(arena, sizeof(struct sequence_data));
+        if (!seq) {
+            fprintf(stderr, "arena exhausted, allocating sequence from the heap\n");
+        }
+    }
+
+    if (seq) {
+        seq->arena = arena;
+    } else {
+        seq = malloc(sizeof(struct sequence_data));
+        seq->arena = NULL;
+    }
+
+    if (lazy) {
+        seq->rb = NULL;
+        atomic_init(&seq->lazy, true);
+    } else {
+        seq->rb = sequence_rb_new(seq->arena);
+        atomic_init(&seq->lazy, false);
+    }
+
+    seq->pattern = pattern;
+    seq->trigs = pattern->trigs;
+    seq->cursor = -1;
+    seq->cursor_step = 0;
+    trigger_init(&seq->rest);
+    seq->nsteps = pattern->nsteps;
+    seq->recorded = false;
+    seq->session = NULL;
+    seq->name[0] = '\0';
+    seq->transpose = 0;
+
+    seq->div = 1;
+
+    seq->is_playing = false;
+
+    seq->outport = NULL;
+    seq->fanout = 0;
+
+    seq->mute = false;
+
+    seq->first = 0;
+    seq->last = seq->nsteps - 1;
+
+    seq->motion = MOTION_FORWARD;
+    seq->bounce_forward = true;
+
+    seq->swing = 0.0;
+    seq->swingType = SWING_ALTERNATE;
+
+    seq->rng = random() | 1;    // any nonzero seed will do
+
+    notification_data_init(&seq->noti);
+    seq->noti_enable = false;
+
+    atomic_init(&seq->stats.events, 0);
+    atomic_init(&seq->stats.prob_skips, 0);
+    atomic_init(&seq->stats.rb_overflows, 0);
+
+    sequence_reset_now(seq);
+
+    return seq;
+
+}
+
+static jack_ringbuffer_t *sequence_rb_new(arena_t *arena) {
+
+    // from the arena if there's room, else from the heap, locked either way
+
+    jack_ringbuffer_t *rb = NULL;
+
+    if (arena) {
+        rb = arena_ringbuffer_new(arena, SEQUENCE_RB_LENGTH * sizeof(sequence_ctrl_msg_t));
+    }
+
+    if (!rb) {
+        rb = jack_ringbuffer_create(SEQUENCE_RB_LENGTH * sizeof(sequence_ctrl_msg_t));
+        if (jack_ringbuffer_mlock(rb)) {
+            fprintf(stderr, "failed to lock ringbuffer\n");
+            exit(1);
+        }
+    }
+
+    return rb;
+
+}
+
+static void sequence_copy_params(sq_sequence_t seq, sq_sequence_t src) {
+
+    // everything but the pattern, for a clone or a linked sequence
+
+    strcpy(seq->name, src->name);
+    seq->transpose = src->transpose;
+    seq->div = src->div;
+    seq->outport = src->outport;
+    seq->fanout = src->fanout;
+    seq->mute = src->mute;
+    seq->first = src->first;
+    seq->last = src->last;
+    seq->motion = src->motion;
+    seq->swing = src->swing;
+    seq->swingType = src->swingType;
+
+    sequence_reset_now(seq);
+
+}
+
+static bool sequence_swap_pattern(sq_sequence_t seq, pattern_t *pattern) {
+
+    // installs pattern in place of seq's current one, and drops the
+    // reference to the old one once the RT thread has let go of it. returns
+    // false (and leaves the caller's reference to pattern alone) if the
+    // message was dropped
+
+    pattern_t *old;
+
+    sequence_materialize(seq);
+    old = seq->pattern;
+
+    if (seq->is_playing) {
+
+        sequence_ctrl_msg_t msg;
+        msg.param = SEQUENCE_SET_PATTERN;
+        msg.vpat = pattern;
+
+        bool done = false;
+        msg.donep = &done;
+
+        if (!sequence_ringbuffer_write(seq, &msg)) {
+            return false;
+        }
+        while (!done) {
+            usleep(1000);
+        }
+
+    } else {
+
+        sequence_set_pattern_now(seq, pattern);
+
+    }
+
+    pattern_unref(old);
+
+    return true;
+
+}
+
+static void sequence_read_json_trigs(jsonReader_t *jr, const char *triggers, sq_trigger_t trigs,
+                                        int nsteps) {
+
+    // into trigs, which hold the default trig to begin with
+
+    struct trigger_data trig;
+    int i = 0, step;
+
+    if (!triggers) return;
+
+    jsonReader_seek(jr, triggers);
+    jsonReader_begin_array(jr);
+    while (jsonReader_next_element(jr)) {
+        step = trigger_read_json(&trig, jr);
+        if (step < 0) {
+            step = i;
+        }
+        if (step < nsteps) {
+            trigs[step] = trig;
+        }
+        i = step + 1;
+    }
+
+}
+
+static inline history_t *sequence_history(sq_sequence_t seq) {
+
+    // edits are only recorded for sequences in a session with a history
+
+    return seq->session ? seq->session->history : NULL;
+
+}
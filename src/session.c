@@ -20,21 +20,35 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "sequoia.h"
 #include "sequoia/session.h"
 #include "sequoia/midiEvent.h"
+#include "sequoia/rtcheck.h"
+#include "sequoia/sqb.h"
+#include "sequoia/snapshot.h"
+#include "sequoia/reload.h"
 
 // LOCAL DECLARATIONS
 
 #define STEPS_PER_BEAT 4
+#define BEATS_PER_BAR 4
 #define SECONDS_PER_MINUTE 60
 #define DEFAULT_BPM 120.00 
+#define SESSION_MIN_BPM 30  // for sizing the note-off buffer
 #define SESSION_RB_LENGTH 16
+#define SESSION_SAVE_BUFSIZE 65536
 
-enum session_param {SESSION_GO, SESSION_BPM, SESSION_ADD_SEQ, SESSION_RM_SEQ};
+enum session_param {SESSION_GO, SESSION_BPM, SESSION_ADD_SEQ, SESSION_RM_SEQ, SESSION_HISTORY,
+                    SESSION_SYNC, SESSION_SNAPSHOT, SESSION_RELOAD};
 
 typedef struct {
 
@@ -46,100 +60,123 @@ typedef struct {
     bool vb;
     sq_sequence_t vp;
 
+    // for SESSION_HISTORY, the range of records to apply
+    size_t from, to;
+    snapshot_t *snapshot;   // for SESSION_SNAPSHOT, to fill in
+    reload_t *reload;       // for SESSION_RELOAD, to apply at the next bar
+    bool *donep;    // for SESSION_HISTORY, SESSION_SYNC and SESSION_SNAPSHOT
+
 } session_ctrl_msg_t ;
 
 static void session_set_bpm_now(sq_session_t, float);
 static void session_add_sequence_now(sq_session_t, sq_sequence_t);
 static void session_rm_sequence_now(sq_session_t, sq_sequence_t);
+static bool session_apply_history(sq_session_t, size_t, size_t, bool);
 static inline jack_nframes_t min_nframes(jack_nframes_t, jack_nframes_t);
-static void session_ringbuffer_write(sq_session_t, session_ctrl_msg_t*);
+static inline bool session_write_midi(sq_outport_t, midiEvent*, unsigned char*);
+static bool session_ringbuffer_write(sq_session_t, session_ctrl_msg_t*);
 static void session_reset_frame_counter(sq_session_t );
+static void session_reload_now(sq_session_t, reload_t*);
 static void session_serve_ctrl_msgs(sq_session_t);
+static void session_serve_inports(sq_session_t, jack_nframes_t);
+static jack_nframes_t session_next_inport_event(sq_session_t, jack_nframes_t);
 static int session_process(jack_nframes_t, void*);
 static void session_set_bpm_now(sq_session_t, float);
 static void session_add_sequence_now(sq_session_t, sq_sequence_t);
 static void session_rm_sequence_now(sq_session_t, sq_sequence_t);
-static json_object *session_get_json(sq_session_t);
-static sq_session_t session_malloc_from_json(json_object*);
-static sq_sequence_t session_get_sequence_from_name(sq_session_t, const char*);
-static sq_outport_t session_get_outport_from_name(sq_session_t, const char*);
+static void session_write_json(sq_session_t, jsonWriter_t*);
+static sq_session_t session_read_json(jsonReader_t*, bool);
+static sq_session_t session_load_file(const char*, bool);
+static bool session_filename_is_sqb(const char*);
+static void session_sync(sq_session_t);
 
 sq_session_t sq_session_new(const char *client_name) {
 
-    sq_session_t sesh;
-
-    sesh = malloc(sizeof(struct session_data));
+    return session_new(client_name, false);
 
-    // initialize struct members
-    sesh->go = false;
-    sesh->nseqs = 0;
-    sesh->ninports = 0;
-    sesh->noutports = 0;
-    sesh->is_playing = false;
+}
 
-    // seed random number generator with system time
-    srandom(time(NULL));
+void sq_session_delete(sq_session_t sesh) {
 
-    // open jack client
-    sesh->jack_client = jack_client_open(client_name, JackNoStartServer, NULL);
-	if (sesh->jack_client == NULL) {
-        fprintf(stderr, "sequoia failed to open JACK client\n");
-        exit(1);
-	}
+    // frees the sq_session_t struct (but not its sequences, ports, etc).
+    // sequences made with sq_session_new_sequence live in the session's
+    // arena, so they must be deleted first
 
-    // get jack server parameters
-    sesh->sr = jack_get_sample_rate(sesh->jack_client);
-    sesh->bs = jack_get_buffer_size(sesh->jack_client);
+    // sequences and ports that outlive the session stop recording edits
+    // and renames into it
+    for (int i=0; i<sesh->nseqs; i++) {
+        sesh->seqs[i]->session = NULL;
+    }
+    for (int i=0; i<sesh->ninports; i++) {
+        sesh->inports[i]->names = NULL;
+    }
+    for (int i=0; i<sesh->noutports; i++) {
+        sesh->outports[i]->names = NULL;
+    }
+    nameIndex_free(&sesh->seq_names);
+    nameIndex_free(&sesh->outport_names);
+    nameIndex_free(&sesh->inport_names);
+    if (sesh->history) {
+        history_delete(sesh->history);
+    }
+    if (sesh->journal) {
+        journal_delete(sesh->journal);
+    }
+    if (sesh->arena) {
+        arena_delete(sesh->arena);
+    }
+    if (!sesh->offline) {
+        offHeap_delete(sesh->offHeap);
+        rtlog_delete(sesh->rtlog);
+        jack_ringbuffer_free(sesh->rb);
+        free(sesh->buf_off);
+        free(sesh->mevs);
+        free(sesh->mevs_tmp);
+    }
+    free(sesh);
 
-    session_set_bpm_now(sesh, DEFAULT_BPM);    // this also sets fps
+}
 
-    session_reset_frame_counter(sesh);
+void sq_session_disconnect_jack(sq_session_t sesh) {
 
-    // set jack process callback
-	jack_set_process_callback(sesh->jack_client, session_process, sesh);
+    if (sesh->offline) return;
 
-    // allocate and lock ringbuffer
-    sesh->rb = jack_ringbuffer_create(SESSION_RB_LENGTH * sizeof(session_ctrl_msg_t));
-    int err = jack_ringbuffer_mlock(sesh->rb);
-    if (err) {
-        fprintf(stderr, "failed to lock ringbuffer\n");
-        exit(1);
+    // a snapshot still being written out needs the client's name
+    if (sesh->journal) {
+        journal_wait_snapshot(sesh->journal);
     }
 
-    // allocate and initialize note-off buffer, plus offHeap
-    sesh->len_off = sesh->fps * TRIG_MAX_LENGTH;
-    sesh->buf_off = malloc(sizeof(offNode_t*) * sesh->len_off);
-    for (size_t i=0; i<sesh->len_off; i++) {
-        sesh->buf_off[i] = NULL;
+    if (jack_client_close(sesh->jack_client)) {
+        fprintf(stderr, "sequoia failed to disconnect jack client\n");
     }
-    sesh->idx_off = 0;
-    sesh->offHeap = offHeap_new(SESSION_MAX_NSEQ * SEQUENCE_MAX_NSTEPS);
 
-    // activate jack client
-	if (jack_activate(sesh->jack_client)) {
-		fprintf(stderr, "failed to activate client\n");
-        exit(1);
-	}
+}
 
-    return sesh;
+int sq_session_init_arena(sq_session_t sesh, size_t size, bool hugepages) {
 
-}
+    // set aside size bytes of locked memory (optionally in hugepages) for
+    // sq_session_new_sequence to carve sequences from
 
-void sq_session_delete(sq_session_t sesh) {
+    if (sesh->arena) {
+        fprintf(stderr, "session already has an arena\n");
+        return -1;
+    }
 
-    // frees the sq_session_t struct (but not its sequences, ports, etc)
+    sesh->arena = arena_new(size, hugepages);
+    if (!sesh->arena) {
+        return -1;
+    }
 
-    offHeap_delete(sesh->offHeap);
-    free(sesh->buf_off);
-    free(sesh);
+    return 0;
 
 }
 
-void sq_session_disconnect_jack(sq_session_t sesh) {
+sq_sequence_t sq_session_new_sequence(sq_session_t sesh, int nsteps) {
 
-    if (jack_client_close(sesh->jack_client)) {
-        fprintf(stderr, "sequoia failed to disconnect jack client\n");
-    }
+    // like sq_sequence_new, but from the session's arena if it has one. the
+    // sequence still has to be added with sq_session_add_sequence
+
+    return sequence_new(nsteps, sesh->arena);
 
 }
 
@@ -152,19 +189,30 @@ int sq_session_register_outport(sq_session_t sesh, sq_outport_t outport) {
         return -1;
     }
 
-    jack_port = jack_port_register(sesh->jack_client, outport->name,
-                                    JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
-
-    if (!jack_port) {
-        fprintf(stderr, "failed to create JACK port\n");
-        return -1;
+    if (sesh->offline) {
+        jack_port = NULL;
+    } else {
+        jack_port = jack_port_register(sesh->jack_client, outport->name,
+                                        JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+        if (!jack_port) {
+            fprintf(stderr, "failed to create JACK port\n");
+            return -1;
+        }
     }
 
     outport->jack_client = sesh->jack_client;
     outport->jack_port = jack_port;
+    outport->names = &sesh->outport_names;
+    outport->index = sesh->noutports;
 
     sesh->outports[sesh->noutports] = outport;
     sesh->noutports++;
+    nameIndex_insert(&sesh->outport_names, outport->name, outport);
+
+    // ports aren't journaled, so the journal needs a new snapshot
+    if (sesh->journal) {
+        session_compact_journal(sesh);
+    }
 
     return 0;
 
@@ -179,19 +227,28 @@ int sq_session_register_inport(sq_session_t sesh, sq_inport_t inport) {
         return -1;
     }
 
-    jack_port = jack_port_register(sesh->jack_client, inport->name,
-                                    JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
-
-    if (!jack_port) {
-        fprintf(stderr, "failed to create JACK port\n");
-        return -1;
+    if (sesh->offline) {
+        jack_port = NULL;
+    } else {
+        jack_port = jack_port_register(sesh->jack_client, inport->name,
+                                        JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+        if (!jack_port) {
+            fprintf(stderr, "failed to create JACK port\n");
+            return -1;
+        }
     }
 
     inport->jack_client = sesh->jack_client;
     inport->jack_port = jack_port;
+    inport->names = &sesh->inport_names;
 
     sesh->inports[sesh->ninports] = inport;
     sesh->ninports++;
+    nameIndex_insert(&sesh->inport_names, inport->name, inport);
+
+    if (sesh->journal) {
+        session_compact_journal(sesh);
+    }
 
     return 0;
 
@@ -231,6 +288,8 @@ void sq_session_stop(sq_session_t sesh) {
 
 void sq_session_set_bpm(sq_session_t sesh, float bpm) {
 
+    journal_bpm(sesh, bpm);
+
     if (sesh->is_playing) {
 
         session_ctrl_msg_t msg;
@@ -249,6 +308,14 @@ void sq_session_set_bpm(sq_session_t sesh, float bpm) {
 
 void sq_session_add_sequence(sq_session_t sesh, sq_sequence_t seq) {
 
+    if (sesh->nseqs == SESSION_MAX_NSEQ) {
+        fprintf(stderr, "max number of sequences reached: %d\n", SESSION_MAX_NSEQ);
+        return;
+    }
+
+    seq->session = sesh;
+    nameIndex_insert(&sesh->seq_names, seq->name, seq);
+
     if (sesh->is_playing) {
 
         session_ctrl_msg_t msg;
@@ -263,6 +330,8 @@ void sq_session_add_sequence(sq_session_t sesh, sq_sequence_t seq) {
 
     }
 
+    journal_add(sesh, seq);
+
 }
 
 void sq_session_rm_sequence(sq_session_t sesh, sq_sequence_t seq) {
@@ -270,6 +339,14 @@ void sq_session_rm_sequence(sq_session_t sesh, sq_sequence_t seq) {
     // NOTE: this does not free the memory pointed to by seq;
     //  the caller must do that explicitly
 
+    // its edits can't be undone once it's gone
+    if (sesh->history) {
+        history_forget(sesh->history, seq);
+    }
+    journal_rm(sesh, seq);
+    nameIndex_remove(&sesh->seq_names, seq->name, seq);
+    seq->session = NULL;
+
     if (sesh->is_playing) {
 
         session_ctrl_msg_t msg;
@@ -312,6 +389,15 @@ sq_sequence_t sq_session_get_seq(sq_session_t sesh, size_t i) {
 
 }
 
+sq_sequence_t sq_session_find_seq(sq_session_t sesh, const char *name) {
+
+    // the first sequence of that name, or NULL. sequences added or removed
+    // while playing are found (or not) as soon as the call returns
+
+    return session_get_sequence_from_name(sesh, name);
+
+}
+
 size_t sq_session_get_ninports(sq_session_t sesh) {
 
     return sesh->ninports;
@@ -336,53 +422,271 @@ sq_outport_t sq_session_get_outport(sq_session_t sesh, size_t i) {
 
 }
 
+void sq_session_get_stats(sq_session_t sesh, struct sq_session_stats *stats) {
+
+    stats->noteoffs_scheduled = STATS_GET(sesh->stats.noteoffs_scheduled);
+    stats->noteoffs_delivered = STATS_GET(sesh->stats.noteoffs_delivered);
+    stats->offheap_exhausted = STATS_GET(sesh->stats.offheap_exhausted);
+    stats->mevs_dropped = STATS_GET(sesh->stats.mevs_dropped);
+    stats->rb_overflows = STATS_GET(sesh->stats.rb_overflows);
+
+}
+
+void sq_session_get_perf_stats(sq_session_t sesh, struct sq_perf_stats *stats) {
+
+    perf_read(&sesh->perf, stats);
+
+}
+
+void sq_session_reset_perf_stats(sq_session_t sesh) {
+
+    perf_reset(&sesh->perf);
+
+}
+
+void sq_session_set_perf_threshold(sq_session_t sesh, float threshold) {
+
+    // callbacks taking longer than this fraction of the JACK period are counted
+
+    if (threshold <= 0.) {
+        fprintf(stderr, "perf threshold of %f is out of range (must be > 0)\n", threshold);
+        return;
+    }
+
+    sesh->perf.threshold = threshold;
+
+}
+
 ////
 
+int sq_session_enable_history(sq_session_t sesh, size_t nrecords) {
+
+    // keeps the last nrecords trig and parameter edits for undo and redo
+
+    if (sesh->history) {
+        fprintf(stderr, "session already has a history\n");
+        return -1;
+    }
+
+    if (nrecords < 1) {
+        fprintf(stderr, "history of %zu records is out of range (must be > 0)\n", nrecords);
+        return -1;
+    }
+
+    sesh->history = history_new(nrecords);
+
+    return 0;
+
+}
+
+void sq_session_begin_edit(sq_session_t sesh) {
+
+    // edits until the matching sq_session_end_edit are undone as one
+
+    if (sesh->history) {
+        history_begin(sesh->history);
+    }
+
+}
+
+void sq_session_end_edit(sq_session_t sesh) {
+
+    if (sesh->history) {
+        history_end(sesh->history);
+    }
+
+}
+
+bool sq_session_undo(sq_session_t sesh) {
+
+    size_t from, to;
+
+    if (!sesh->history || !history_undo_range(sesh->history, &from, &to)) {
+        return false;
+    }
+
+    if (!session_apply_history(sesh, from, to, true)) {
+        sesh->history->pos = to;
+        return false;
+    }
+
+    journal_history(sesh, from, to, true);
+
+    return true;
+
+}
+
+bool sq_session_redo(sq_session_t sesh) {
+
+    size_t from, to;
+
+    if (!sesh->history || !history_redo_range(sesh->history, &from, &to)) {
+        return false;
+    }
+
+    if (!session_apply_history(sesh, from, to, false)) {
+        sesh->history->pos = from;
+        return false;
+    }
+
+    journal_history(sesh, from, to, false);
+
+    return true;
+
+}
+
+double sq_session_get_load_time(sq_session_t sesh) {
+
+    // how long sq_session_load took to build this session, in seconds (or
+    // zero, if it wasn't loaded from a file)
+
+    return sesh->load_time;
+
+}
+
+void sq_session_clear_history(sq_session_t sesh) {
+
+    if (sesh->history) {
+        history_clear(sesh->history);
+    }
+
+}
+
+int sq_session_enable_journal(sq_session_t sesh, const char *filename) {
+
+    // saves the session to filename (as with sq_session_save), and from then
+    // on appends every edit to filename.journal, so sq_session_load can
+    // recover them after a crash
+
+    if (sesh->journal) {
+        fprintf(stderr, "session already has a journal\n");
+        return -1;
+    }
+
+    session_sync(sesh);
+    sesh->journal = journal_new(filename, session_filename_is_sqb(filename),
+                                sesh->seqs, sesh->nseqs);
+
+    // the first snapshot is waited for, so that a bad filename fails here
+    session_compact_journal(sesh);
+    if (!journal_wait_snapshot(sesh->journal)) {
+        journal_delete(sesh->journal);
+        sesh->journal = NULL;
+        return -1;
+    }
+
+    return 0;
+
+}
+
+void sq_session_compact_journal(sq_session_t sesh) {
+
+    // folds the journal into a new snapshot now, rather than once it's grown
+
+    if (sesh->journal) {
+        session_compact_journal(sesh);
+    }
+
+}
+
+void sq_session_disable_journal(sq_session_t sesh) {
+
+    // leaves an up-to-date snapshot and an empty journal
+
+    if (sesh->journal) {
+        session_compact_journal(sesh);
+        journal_delete(sesh->journal);
+        sesh->journal = NULL;
+    }
+
+}
+
 void sq_session_save(sq_session_t sesh, const char *filename) {
 
-    FILE *fp;
+    // a .sqb file gets the binary format, anything else JSON. it's written
+    // from a snapshot, so a playing session can be saved as it stands at
+    // the start of one cycle, without stopping it
 
-    fp = fopen(filename, "w+");
-    fprintf(fp, "%s", json_object_to_json_string_ext(session_get_json(sesh),
-                                                    JSON_C_TO_STRING_PRETTY));
-    fclose(fp);
+    snapshot_t *snapshot = session_snapshot(sesh);
+
+    session_save_file(&snapshot->sesh, filename, session_filename_is_sqb(filename));
+    snapshot_delete(snapshot);
 
 }
 
 sq_session_t sq_session_load(const char *filename) {
 
-    FILE *fp;
-    long filesize;
-    struct json_object *jo_session;
-    char *buf;
-    size_t ret;
-    sq_session_t sesh = NULL;
+    // the file is mapped rather than read. a binary session is built
+    // straight out of the mapping; JSON is copied out to be NUL-terminated
+    // for the parser. the format is told by the magic number, not the name.
+    // if the session was journaled, the journal is replayed on top
+
+    return session_load_file(filename, false);
+
+}
+
+int sq_session_reload(sq_session_t sesh, const char *filename) {
+
+    // brings the session in line with filename, which has been edited
+    // elsewhere, without stopping it. the file is loaded and compared
+    // here, and the changes are applied all at once by the RT thread, at
+    // the start of the next bar (counted from when the session was
+    // started). this waits until they have been. sequences that are the
+    // same in the file are left alone, and keep their playheads.
+    //
+    // sequences that aren't in the file are removed and deleted, so the
+    // caller's handles to them go stale. ports that aren't in the file are
+    // kept. the edit history is cleared, and the journal (if any) compacted
+
+    sq_session_t file;
+    reload_t *reload;
+    bool done;
+
+    file = session_load_file(filename, true);
+    if (!file) {
+        return -1;
+    }
+
+    session_sync(sesh);
+    reload = reload_new(sesh, file);
 
-    // open the file descriptor
-    fp = fopen(filename, "r");
+    if (sesh->is_playing) {
 
-    // get the file size
-    fseek(fp, 0L, SEEK_END);
-    filesize = ftell(fp);
-    rewind(fp);
+        session_ctrl_msg_t msg;
+        msg.param = SESSION_RELOAD;
+        msg.reload = reload;
 
-    // allocate the read buffer
-    buf = malloc(filesize);
+        if (session_ringbuffer_write(sesh, &msg)) {
+            while (!reload->done) {
+                usleep(1000);
+            }
+        }
 
-    // read the file into the buffer, parse and instantiate the session
-    ret = fread(buf, 1, filesize, fp);
-    if (ret == filesize) {
-        jo_session = json_tokener_parse(buf);
-        sesh = session_malloc_from_json(jo_session);
     } else {
-        fprintf(stderr, "error while reading file: %s", filename);
+
+        session_reload_now(sesh, reload);
+
     }
 
-    // clean up
-    fclose(fp);
-    free(buf);
+    done = reload->done;
+    sq_session_clear_history(sesh);
+    if (done) {
+        nameIndex_clear(&sesh->seq_names);
+        for (int i=0; i<sesh->nseqs; i++) {
+            nameIndex_insert(&sesh->seq_names, sesh->seqs[i]->name, sesh->seqs[i]);
+        }
+    }
+    if (sesh->journal && done) {
+        journal_reset_seqs(sesh->journal, sesh->seqs, sesh->nseqs);
+    }
+    reload_delete(reload);
+    if (sesh->journal) {
+        session_compact_journal(sesh);
+    }
 
-    return sesh;
+    sq_session_delete_recursive(file);
+
+    return done ? 0 : -1;
 
 }
 
@@ -397,69 +701,286 @@ void sq_session_delete_recursive(sq_session_t sesh) {
     for (int i=0; i<sesh->nseqs; i++) {
         sq_sequence_delete(sesh->seqs[i]);
     }
+    sesh->nseqs = 0;
 
     // inports
     for (int i=0; i<sesh->ninports; i++) {
         sq_inport_delete(sesh->inports[i]);
     }
+    sesh->ninports = 0;
 
     // outports
     for (int i=0; i<sesh->noutports; i++) {
         sq_outport_delete(sesh->outports[i]);
     }
+    sesh->noutports = 0;
 
     // session
     sq_session_delete(sesh);
 
 }
 
-// LOCAL CODE
+// PUBLIC CODE
 
-static sq_sequence_t session_get_sequence_from_name(sq_session_t sesh, const char *name) {
+sq_session_t session_new(const char *client_name, bool offline) {
 
-    for (int i=0; i<sesh->nseqs; i++) {
-        if (strcmp(sesh->seqs[i]->name, name) == 0) {
-            return sesh->seqs[i];
-        }
+    sq_session_t sesh;
+
+    sesh = malloc(sizeof(struct session_data));
+
+    // initialize struct members
+    sesh->go = false;
+    sesh->nseqs = 0;
+    sesh->ninports = 0;
+    sesh->noutports = 0;
+    sesh->is_playing = false;
+    sesh->offline = offline;
+    sesh->reload = NULL;
+    sesh->snapshot = NULL;
+    sesh->arena = NULL;
+    sesh->history = NULL;
+    sesh->journal = NULL;
+    sesh->load_time = 0.;
+    nameIndex_init(&sesh->seq_names);
+    nameIndex_init(&sesh->outport_names);
+    nameIndex_init(&sesh->inport_names);
+
+    // seed random number generator with system time
+    srandom(time(NULL));
+
+    // an offline session stops here, with no JACK client and nothing to
+    // play it with: it's only somewhere to load a file into, to compare
+    // with a live one (see sq_session_reload)
+    if (offline) {
+        sesh->jack_client = NULL;
+        sesh->sr = 0;
+        sesh->bs = 0;
+        sesh->frame = 0;
+        session_set_bpm_now(sesh, DEFAULT_BPM);
+        return sesh;
     }
 
-    return NULL;
+    // open jack client
+    sesh->jack_client = jack_client_open(client_name, JackNoStartServer, NULL);
+	if (sesh->jack_client == NULL) {
+        fprintf(stderr, "sequoia failed to open JACK client\n");
+        exit(1);
+	}
+
+    // get jack server parameters
+    sesh->sr = jack_get_sample_rate(sesh->jack_client);
+    sesh->bs = jack_get_buffer_size(sesh->jack_client);
+
+    session_set_bpm_now(sesh, DEFAULT_BPM);    // this also sets fps
+
+    session_reset_frame_counter(sesh);
+
+    // set jack process callback
+	jack_set_process_callback(sesh->jack_client, session_process, sesh);
+
+    // allocate and lock ringbuffer
+    sesh->rb = jack_ringbuffer_create(SESSION_RB_LENGTH * sizeof(session_ctrl_msg_t));
+    int err = jack_ringbuffer_mlock(sesh->rb);
+    if (err) {
+        fprintf(stderr, "failed to lock ringbuffer\n");
+        exit(1);
+    }
+
+    // allocate the event buffer for session_process
+    sesh->mevs = malloc(sizeof(midiEvent) * SESSION_MAX_NMEVS);
+    sesh->mevs_tmp = malloc(sizeof(midiEvent) * (SESSION_MAX_NMEVS / 2));
+
+    // allocate and initialize note-off buffer, plus offHeap
+    // (long enough for the longest note, at the slowest tempo we allow for,
+    // starting at the end of a block)
+    sesh->len_off = ((sesh->sr * SECONDS_PER_MINUTE) / (SESSION_MIN_BPM * STEPS_PER_BEAT) + 1)
+                        * TRIG_MAX_LENGTH + sesh->bs;
+    sesh->buf_off = malloc(sizeof(offNode_t*) * sesh->len_off);
+    for (size_t i=0; i<sesh->len_off; i++) {
+        sesh->buf_off[i] = NULL;
+    }
+    sesh->idx_off = 0;
+    // (each sequence fires at most once per step, and notes last at most
+    // TRIG_MAX_LENGTH steps)
+    sesh->offHeap = offHeap_new(SESSION_MAX_NSEQ * (TRIG_MAX_LENGTH + 1));
+
+    perf_init(&sesh->perf);
+
+    // messages from the process callback go through here
+    sesh->rtlog = rtlog_new();
+
+    atomic_init(&sesh->stats.noteoffs_scheduled, 0);
+    atomic_init(&sesh->stats.noteoffs_delivered, 0);
+    atomic_init(&sesh->stats.offheap_exhausted, 0);
+    atomic_init(&sesh->stats.mevs_dropped, 0);
+    atomic_init(&sesh->stats.rb_overflows, 0);
+
+    // activate jack client
+	if (jack_activate(sesh->jack_client)) {
+		fprintf(stderr, "failed to activate client\n");
+        exit(1);
+	}
+
+    return sesh;
 
 }
 
-static sq_outport_t session_get_outport_from_name(sq_session_t sesh, const char *name) {
+void session_compact_journal(sq_session_t sesh) {
 
-    for (int i=0; i<sesh->noutports; i++) {
-        if (strcmp(sesh->outports[i]->name, name) == 0) {
-            return sesh->outports[i];
+    // queues a snapshot for the journal's writer thread to write out and
+    // move into place, after the records queued so far
+
+    journal_t *journal = sesh->journal;
+
+    journal_wait_snapshot(journal);
+    journal_snapshot(journal, session_snapshot(sesh));
+
+}
+
+snapshot_t *session_snapshot(sq_session_t sesh) {
+
+    // a copy of the session as it stands at the start of the next cycle (or
+    // the next few, for a lot of recorded trigs; see snapshot_capture_now),
+    // or now if it's stopped. adding and removing sequences is caught up on
+    // first, so the sequences the copy is made of are the RT thread's
+
+    snapshot_t *snapshot;
+
+    session_sync(sesh);
+    snapshot = snapshot_new(sesh);
+
+    if (sesh->is_playing) {
+
+        session_ctrl_msg_t msg;
+        msg.param = SESSION_SNAPSHOT;
+        msg.snapshot = snapshot;
+
+        bool done = false;
+        msg.donep = &done;
+
+        if (session_ringbuffer_write(sesh, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
         }
+
+    } else {
+
+        while (!snapshot_capture_now(snapshot, sesh));
+
+    }
+
+    return snapshot;
+
+}
+
+int session_save_file(sq_session_t sesh, const char *filename, bool binary) {
+
+    // streams the session straight out to the file, through stdio's buffer
+
+    FILE *fp;
+    jsonWriter_t jw;
+
+    fp = fopen(filename, binary ? "wb" : "w");
+    if (!fp) {
+        fprintf(stderr, "failed to open %s for writing\n", filename);
+        return -1;
+    }
+
+    setvbuf(fp, NULL, _IOFBF, SESSION_SAVE_BUFSIZE);
+    if (binary) {
+        sqb_write(sesh, fp);
+    } else {
+        jsonWriter_init(&jw, fp);
+        session_write_json(sesh, &jw);
+    }
+
+    if (ferror(fp) | fclose(fp)) {
+        fprintf(stderr, "failed to write %s\n", filename);
+        return -1;
     }
 
-    return NULL;
+    return 0;
+
+}
+
+sq_sequence_t session_get_sequence_from_name(sq_session_t sesh, const char *name) {
+
+    return nameIndex_find(&sesh->seq_names, name);
+
+}
+
+sq_outport_t session_get_outport_from_name(sq_session_t sesh, const char *name) {
+
+    return nameIndex_find(&sesh->outport_names, name);
+
+}
+
+sq_inport_t session_get_inport_from_name(sq_session_t sesh, const char *name) {
+
+    return nameIndex_find(&sesh->inport_names, name);
 
 }
 
+// LOCAL CODE
+
 static inline jack_nframes_t min_nframes(jack_nframes_t a, jack_nframes_t b ) {
 
     return a < b ? a : b;
 
 }
 
-static void session_ringbuffer_write(sq_session_t sesh, session_ctrl_msg_t *msg) {
+static inline bool session_write_midi(sq_outport_t outport, midiEvent *mev, unsigned char *msg) {
+
+    // reserves room for the mev's bytes in outport's buffer, and copies them
+    // in. returns false if there wasn't room
+
+    unsigned char *ptr = jack_midi_event_reserve(outport->buf, mev->time, mev->size);
+
+    if (!ptr) {
+        STATS_INC(outport->stats.reserve_fails);
+        return false;
+    }
+
+    STATS_INC(outport->stats.events);
+    memcpy(ptr, msg, mev->size);
+
+    return true;
+
+}
+
+static bool session_ringbuffer_write(sq_session_t sesh, session_ctrl_msg_t *msg) {
+
+    // returns false if the message was dropped
 
     int avail = jack_ringbuffer_write_space(sesh->rb);
     if (avail < sizeof(session_ctrl_msg_t)) {
         fprintf(stderr, "session ringbuffer: overflow\n");
-        return;
+        STATS_INC(sesh->stats.rb_overflows);
+        return false;
     }
 
     jack_ringbuffer_write(sesh->rb, (const char*) msg, sizeof(session_ctrl_msg_t));
 
+    return true;
+
 }
 
 static void session_reset_frame_counter(sq_session_t sesh) {
 
     sesh->frame = sesh->fps / 2;    // frame counter
+    sesh->step = 0;     // bars are counted from here
+
+}
+
+static void session_reload_now(sq_session_t sesh, reload_t *reload) {
+
+    if (sesh->bpm != reload->bpm) {
+        session_set_bpm_now(sesh, reload->bpm);
+    }
+    reload_apply_now(reload, sesh);
+
+    reload->done = true;
 
 }
 
@@ -480,6 +1001,11 @@ static void session_serve_ctrl_msgs(sq_session_t sesh) {
                     sesh->seqs[i]->is_playing = true;
                 }
             } else {
+                // a reload waiting for the next bar won't get one
+                if (sesh->reload) {
+                    session_reload_now(sesh, sesh->reload);
+                    sesh->reload = NULL;
+                }
                 for (int i=0; i<sesh->nseqs; i++) {
                     sesh->seqs[i]->is_playing = false;
                     sequence_reset_now(sesh->seqs[i]);
@@ -499,25 +1025,84 @@ static void session_serve_ctrl_msgs(sq_session_t sesh) {
 
             session_rm_sequence_now(sesh, msg.vp);
 
+        } else if (msg.param == SESSION_HISTORY) {
+
+            history_apply_now(sesh->history, msg.from, msg.to, msg.vb);
+            *msg.donep = true;
+
+        } else if (msg.param == SESSION_SYNC) {
+
+            *msg.donep = true;
+
+        } else if (msg.param == SESSION_SNAPSHOT) {
+
+            // captured below. the UI thread waits on it, so nothing is
+            // queued after it until it's done
+            sesh->snapshot = msg.snapshot;
+            sesh->snapshot_donep = msg.donep;
+
+        } else if (msg.param == SESSION_RELOAD) {
+
+            // held until the start of the next bar, if playing
+            if (sesh->go) {
+                sesh->reload = msg.reload;
+            } else {
+                session_reload_now(sesh, msg.reload);
+            }
+
         }
 
         avail -= sizeof(session_ctrl_msg_t);
 
     }
 
+    // a slice of a snapshot's recorded trigs per cycle (see snapshot_capture_now)
+    if (sesh->snapshot && snapshot_capture_now(sesh->snapshot, sesh)) {
+        *sesh->snapshot_donep = true;
+        sesh->snapshot = NULL;
+    }
+
+}
+
+static void session_serve_inports(sq_session_t sesh, jack_nframes_t frame) {
+
+    for (int i=0; i<sesh->ninports; i++) {
+        inport_process(sesh->inports[i], frame, sesh->frame);
+    }
+
+}
+
+static jack_nframes_t session_next_inport_event(sq_session_t sesh, jack_nframes_t nframes) {
+
+    // returns the frame of the earliest pending inport event, or nframes if there is none
+
+    jack_nframes_t next = nframes;
+
+    for (int i=0; i<sesh->ninports; i++) {
+        next = min_nframes(next, inport_next_event_time(sesh->inports[i], nframes));
+    }
+
+    return next;
+
 }
 
 static int session_process(jack_nframes_t nframes, void *arg) {
 
     sq_session_t sesh = (sq_session_t) arg;
-    offNode_t *offp, **offpp;   // tmp vars
+    offNode_t *offp;    // tmp var
+    uint64_t t_start, t0, t1, t0_inports, t_inports, t_write;  // timestamps and durations (ns)
+
+    rtcheck_enter();
+
+    t_start = perf_now();
+
+    // from here on, errors are logged without touching stdio
+    rtlog_bind(sesh->rtlog);
 
     session_serve_ctrl_msgs(sesh);
 
-    // serve the inports
-    for (int i=0; i<sesh->ninports; i++) {
-        inport_process(sesh->inports[i], nframes);
-    }
+    t0 = perf_now();
+    perf_record(&sesh->perf, PERF_CTRL, t0 - t_start);
 
     // prepare the outports. need to do this once per port, per processing
     // callback - EVEN IF the session isn't running. otherwise, stopping the
@@ -530,42 +1115,91 @@ static int session_process(jack_nframes_t nframes, void *arg) {
         jack_midi_clear_buffer(outport->buf);
     }
 
+    t1 = perf_now();
+    t_write = t1 - t0;
+    t0 = t1;
+
     // main processing for midi output
 
-    jack_nframes_t nframes_left, len;
-    unsigned char *midi_msg_write_ptr;
+    jack_nframes_t nframes_left, len, offset;
+    size_t delay;
+    unsigned char midi_msg[3];
 
-    midiEvent mevs[SESSION_MAX_NSEQ];
+    midiEvent *mevs = sesh->mevs;
     size_t len_mevs = 0;
     midiEvent mev;     // midiEvent temp variable
     midiEvent *mevp;   // midiEvent* temp variable
 
+    // prepare the inports. their control events are applied below, interleaved
+    // with sequence processing, at the frame where each one lands in the block.
+    // MIDI thru events are copied to their outports at their original frames
+    t1 = perf_now();
+    size_t ndropped = 0;
+    for (int i=0; i<sesh->ninports; i++) {
+        inport_prepare(sesh->inports[i], nframes, sesh->fps, sesh->go);
+        len_mevs += inport_thru(sesh->inports[i], mevs + len_mevs,
+                                    SESSION_MAX_NMEVS - len_mevs, &ndropped);
+    }
+    if (ndropped) STATS_ADD(sesh->stats.mevs_dropped, ndropped);
+    t_inports = perf_now() - t1;
+
     if (sesh->go) {
 
         // collect mevs (note-on and CC) for this processing block
         nframes_left = nframes;
         while(nframes_left) {
+            offset = nframes - nframes_left;
+            if (sesh->frame == 0) {
+                for (int i=0; i<sesh->nseqs; i++) {
+                    sequence_step(sesh->seqs[i]);
+                }
+                // a reload goes in after the step, so that new sequences
+                // start from their first step on the bar
+                sesh->step++;
+                if (sesh->reload && (sesh->step % (STEPS_PER_BEAT * BEATS_PER_BAR) == 0)) {
+                    session_reload_now(sesh, sesh->reload);
+                    sesh->reload = NULL;
+                }
+            }
+            // apply the inport events that have landed by now, and end this
+            // chunk where the next one lands (as well as on the step boundary)
+            t1 = perf_now();
+            session_serve_inports(sesh, offset);
+            t_inports += perf_now() - t1;
             len = min_nframes(nframes_left, sesh->fps - sesh->frame);
+            len = min_nframes(len, session_next_inport_event(sesh, nframes) - offset);
                 for (int i=0; i<sesh->nseqs; i++) {
 
-                    if (sesh->frame == 0) sequence_step(sesh->seqs[i]);
                     mev = sequence_process(sesh->seqs[i], sesh->fps,
-                                        sesh->frame, len, nframes - nframes_left);
-                    if (mev.buf) mevs[len_mevs++] = mev;    // check for NULL
+                                        sesh->frame, len, offset);
+                    if (!mev.outport) continue;             // check for NULL
+                    if (len_mevs == SESSION_MAX_NMEVS) {
+                        STATS_INC(sesh->stats.mevs_dropped);
+                        continue;
+                    }
+                    mevs[len_mevs++] = mev;
                     if (mev.type == MEV_TYPE_NOTEON) {      // queue note off
                         // allocate and set offNode
                         offp = offHeap_alloc(sesh->offHeap);
+                        if (!offp) {
+                            STATS_INC(sesh->stats.offheap_exhausted);
+                            continue;
+                        }
+                        STATS_INC(sesh->stats.noteoffs_scheduled);
                         offp->mev.type = MEV_TYPE_NOTEOFF;
-                        offp->mev.buf = mev.buf;
+                        offp->mev.outport = mev.outport;
+                        offp->mev.fanout = mev.fanout;
                         offp->mev.status = mev.status - 16; // convert on to off
                         offp->mev.data1 = mev.data1;
-                        offp->next = NULL;
+                        offp->mev.data2 = 0;
+                        offp->mev.size = 3;
                         // add it to the linked-list array that is buf_off
-                        offpp = sesh->buf_off + ((sesh->idx_off + mev.time + mev.length) % sesh->len_off);
-                        while (*offpp) {   // follow the linked list until next == NULL
-                            offpp = &((*offpp)->next);
-                        }
-                        (*offpp) = offp;
+                        // (below SESSION_MIN_BPM, long notes are cut short
+                        // rather than wrapping around)
+                        delay = mev.time + mev.length;
+                        if (delay >= sesh->len_off) delay = sesh->len_off - 1;
+                        offNode_append(sesh->buf_off + ((sesh->idx_off + delay) % sesh->len_off),
+                                        offp);
                     }
                     
                 }
@@ -576,12 +1210,29 @@ static int session_process(jack_nframes_t nframes, void *arg) {
 
     }
 
+    // apply any inport events that are still pending (all of them, if the
+    // session isn't running)
+    t0_inports = perf_now();
+    session_serve_inports(sesh, nframes);
+    t1 = perf_now();
+    t_inports += t1 - t0_inports;
+
+    // everything since the outports were prepared, less the time spent on inports,
+    // this last serve included (the outport buffers are cleared in the write phase)
+    perf_record(&sesh->perf, PERF_SEQUENCES, t1 - t0 - t_inports);
+    perf_record(&sesh->perf, PERF_INPORTS, t_inports);
+    t0 = perf_now();
+
     // cycle through note-off buffer, collect them as mevs
     for (size_t i=0; i<nframes; i++) {
         offp = sesh->buf_off[(sesh->idx_off + i) % sesh->len_off];
         while (offp) {
-            mevs[len_mevs] = offp->mev;
-            mevs[len_mevs++].time = i;
+            if (len_mevs < SESSION_MAX_NMEVS) {
+                mevs[len_mevs] = offp->mev;
+                mevs[len_mevs++].time = i;
+            } else {
+                STATS_INC(sesh->stats.mevs_dropped);
+            }
             offHeap_free(sesh->offHeap, offp);
             offp = offp->next;
         }
@@ -589,18 +1240,39 @@ static int session_process(jack_nframes_t nframes, void *arg) {
     }
     sesh->idx_off = (sesh->idx_off + nframes) % sesh->len_off;
 
+    t1 = perf_now();
+    perf_record(&sesh->perf, PERF_NOTEOFFS, t1 - t0);
+
     // sort all mevs
-    midiEvent_sort(mevs, len_mevs);
+    midiEvent_sort(mevs, len_mevs, sesh->mevs_tmp);
+
+    t0 = perf_now();
+    perf_record(&sesh->perf, PERF_SORT, t0 - t1);
 
-    // fire off mevs
+    // fire off mevs. each is encoded once, and copied to its fanout
     for (size_t i=0; i<len_mevs; i++) {
         mevp = mevs + i;
-        midi_msg_write_ptr = jack_midi_event_reserve(mevp->buf, mevp->time, 3);
-        midi_msg_write_ptr[0] = mevp->status;
-        midi_msg_write_ptr[1] = mevp->data1;
-        midi_msg_write_ptr[2] = mevp->data2;
+        midi_msg[0] = mevp->status;
+        midi_msg[1] = mevp->data1;
+        midi_msg[2] = mevp->data2;
+        if (session_write_midi(mevp->outport, mevp, midi_msg)
+                && (mevp->type == MEV_TYPE_NOTEOFF)) {
+            STATS_INC(sesh->stats.noteoffs_delivered);
+        }
+        for (int j=0; mevp->fanout && (j<sesh->noutports); j++) {
+            outport = sesh->outports[j];
+            if ((mevp->fanout & (1u << j)) && (outport != mevp->outport) && outport->buf) {
+                session_write_midi(outport, mevp, midi_msg);
+            }
+        }
     }
 
+    t1 = perf_now();
+    perf_record(&sesh->perf, PERF_WRITE, t_write + t1 - t0);
+    perf_record_cycle(&sesh->perf, t1 - t_start, (uint64_t) nframes * 1000000000 / sesh->sr);
+
+    rtcheck_leave();
+
     return 0;
 
 }
@@ -628,6 +1300,8 @@ static void session_set_bpm_now(sq_session_t sesh, float bpm) {
 
 static void session_add_sequence_now(sq_session_t sesh, sq_sequence_t seq) {
 
+    if (sesh->nseqs == SESSION_MAX_NSEQ) return;
+
     sesh->seqs[sesh->nseqs] = seq;
     sesh->nseqs++;
 
@@ -652,106 +1326,307 @@ static void session_rm_sequence_now(sq_session_t sesh, sq_sequence_t seq) {
 
 }
 
-static json_object *session_get_json(sq_session_t sesh) {
+static bool session_apply_history(sq_session_t sesh, size_t from, size_t to, bool undo) {
 
-    json_object *jo_session = json_object_new_object();
+    // applies a whole group of edits at once, in a single message if
+    // playing. returns false if the message was dropped
+
+    history_t *history = sesh->history;
+    history_record_t *rec;
+
+    // the message's room is made sure of first, since the edits below can't
+    // be taken back. the UI thread is the only writer, so it stays there
+    if (sesh->is_playing
+            && (jack_ringbuffer_write_space(sesh->rb) < sizeof(session_ctrl_msg_t))) {
+        fprintf(stderr, "session ringbuffer: overflow\n");
+        STATS_INC(sesh->stats.rb_overflows);
+        return false;
+    }
+
+    // copy on write has to happen here, before the RT thread touches trigs,
+    // and so does materializing a lazy sequence that an edit may unmute
+    for (size_t i=from; i<to; i++) {
+        sequence_materialize(history->recs[i].seq);
+        if ((history->recs[i].param == SEQUENCE_SET_TRIG)
+                && !pattern_is_packed(history->recs[i].seq->pattern)) {
+            sequence_own_pattern(history->recs[i].seq);
+        }
+    }
+
+    // a packed pattern can't be written in place, so its trig edits are made
+    // here, in order, by swapping in new ones; the RT thread passes them by.
+    // one that ends up unpacked takes the rest of its edits in place
+    for (size_t i=0; i<to-from; i++) {
+        rec = history->recs + (undo ? to - 1 - i : from + i);
+        if (rec->param == SEQUENCE_SET_TRIG) {
+            sequence_edit_packed(rec->seq, rec->step, 1, undo ? &rec->v.t.before : &rec->v.t.after);
+        }
+    }
+
+    if (sesh->is_playing) {
+
+        session_ctrl_msg_t msg;
+        msg.param = SESSION_HISTORY;
+        msg.from = from;
+        msg.to = to;
+        msg.vb = undo;
+
+        bool done = false;
+        msg.donep = &done;
+
+        if (!session_ringbuffer_write(sesh, &msg)) {
+            return false;
+        }
+        while (!done) {
+            usleep(1000);
+        }
+
+    } else {
+
+        history_apply_now(history, from, to, undo);
+
+    }
+
+    return true;
+
+}
+
+static void session_write_json(sq_session_t sesh, jsonWriter_t *jw) {
+
+    int link;
+
+    jsonWriter_begin_object(jw, NULL);
 
     // top-level attributes
-    json_object_object_add(jo_session, "name",
-                            json_object_new_string(sq_session_get_name(sesh)));
-    json_object_object_add(jo_session, "bpm",
-                            json_object_new_double(sq_session_get_bpm(sesh)));
+    jsonWriter_string(jw, "name", sq_session_get_name(sesh));
+    jsonWriter_double(jw, "bpm", sq_session_get_bpm(sesh));
 
     // sequences
-    json_object *sequence_array = json_object_new_array();
+    jsonWriter_begin_array(jw, "sequences");
     for (int i=0; i<sesh->nseqs; i++) {
-        json_object_array_add(sequence_array, sequence_get_json(sesh->seqs[i]));
+        // linked sequences point back at the first one sharing their pattern
+        link = -1;
+        if (sq_sequence_is_linked(sesh->seqs[i])) {
+            for (int j=0; j<i; j++) {
+                if (sesh->seqs[j]->pattern == sesh->seqs[i]->pattern) {
+                    link = j;
+                    break;
+                }
+            }
+        }
+        sequence_write_json(sesh->seqs[i], jw, sesh, link);
     }
-    json_object_object_add(jo_session, "sequences", sequence_array);
-    
+    jsonWriter_end_array(jw);
 
     // inports
-    json_object *inport_array = json_object_new_array();
+    jsonWriter_begin_array(jw, "inports");
     for (int i=0; i<sesh->ninports; i++) {
-        json_object_array_add(inport_array, inport_get_json(sesh->inports[i]));
+        inport_write_json(sesh->inports[i], jw);
     }
-    json_object_object_add(jo_session, "inports", inport_array);
-    
+    jsonWriter_end_array(jw);
+
     // outports
-    json_object *outport_array = json_object_new_array();
+    jsonWriter_begin_array(jw, "outports");
     for (int i=0; i<sesh->noutports; i++) {
-        json_object_array_add(outport_array, outport_get_json(sesh->outports[i]));
+        outport_write_json(sesh->outports[i], jw);
     }
-    json_object_object_add(jo_session, "outports", outport_array);
-    
-    return jo_session;
+    jsonWriter_end_array(jw);
+
+    jsonWriter_end_object(jw);
 
 }
 
-static sq_session_t session_malloc_from_json(json_object *jo_session) {
+static sq_session_t session_read_json(jsonReader_t *jr, bool offline) {
+
+    // the outports have to exist before the sequences that play through
+    // them, and the sequences before the inports that control them, but
+    // the file can list them in any order. so the first pass reads the
+    // attributes and notes where each list is, and the lists are read
+    // afterwards, in that order
 
-    struct json_object *jo_tmp, *jo_tmp2, *jo_tmp3, *jo_tmp4;
-    const char *name;
-    double bpm;
+    const char *key;
+    const char *sequences = NULL, *inports = NULL, *outports = NULL;
+    char name[SESSION_MAX_NAME_LEN + 1] = "sequoia";
+    double bpm = DEFAULT_BPM;
     sq_session_t sesh;
-    sq_sequence_t seq_tmp = NULL;
-    sq_inport_t inport_tmp = NULL;
-    sq_outport_t outport_tmp = NULL;
+    sq_sequence_t seq_tmp;
+    size_t arena_size = 0;
+
+    jsonReader_begin_object(jr);
+    while (jsonReader_next_key(jr, &key)) {
+        if (!strcmp(key, "name")) {
+            snprintf(name, sizeof(name), "%s", jsonReader_string(jr));
+        } else if (!strcmp(key, "bpm")) {
+            bpm = jsonReader_double(jr);
+        } else {
+            if (!strcmp(key, "sequences")) {
+                sequences = jsonReader_tell(jr);
+            } else if (!strcmp(key, "inports")) {
+                inports = jsonReader_tell(jr);
+            } else if (!strcmp(key, "outports")) {
+                outports = jsonReader_tell(jr);
+            }
+            jsonReader_skip(jr);
+        }
+    }
 
-    // first extract the top-level attributes
-    json_object_object_get_ex(jo_session, "name", &jo_tmp);
-    name = json_object_get_string(jo_tmp);
-    json_object_object_get_ex(jo_session, "bpm", &jo_tmp);
-    bpm = json_object_get_double(jo_tmp);
+    if (jsonReader_failed(jr)) {
+        return NULL;
+    }
 
     // malloc and init the session
-    sesh = sq_session_new(name);
+    sesh = session_new(name, offline);
     sq_session_set_bpm(sesh, bpm);
 
     // add the outports
-    json_object_object_get_ex(jo_session, "outports", &jo_tmp);
-    for (int i=0; i<json_object_array_length(jo_tmp); i++) {
-        jo_tmp2 = json_object_array_get_idx(jo_tmp, i);
-        outport_tmp = outport_malloc_from_json(jo_tmp2);
-        sq_session_register_outport(sesh, outport_tmp);
-    }
-
-    // add the sequences
-    json_object_object_get_ex(jo_session, "sequences", &jo_tmp);
-    for (int i=0; i<json_object_array_length(jo_tmp); i++) {
-        jo_tmp2 = json_object_array_get_idx(jo_tmp, i);
-        seq_tmp = sequence_malloc_from_json(jo_tmp2);
-        // outport remains null, resolve it now
-        json_object_object_get_ex(jo_tmp2, "outport", &jo_tmp3);
-        if (json_object_get_type(jo_tmp3) == json_type_string) {
-            name = json_object_get_string(jo_tmp3);
-            outport_tmp = session_get_outport_from_name(sesh, name);
-            if (outport_tmp) {
-                sq_sequence_set_outport(seq_tmp, outport_tmp);
-            }
+    if (outports) {
+        jsonReader_seek(jr, outports);
+        jsonReader_begin_array(jr);
+        while (jsonReader_next_element(jr)) {
+            sq_session_register_outport(sesh, outport_read_json(jr));
         }
-        sq_session_add_sequence(sesh, seq_tmp);
     }
 
-    // add the inports
-    json_object_object_get_ex(jo_session, "inports", &jo_tmp);
-    for (int i=0; i<json_object_array_length(jo_tmp); i++) {
-        jo_tmp2 = json_object_array_get_idx(jo_tmp, i);
-        inport_tmp = inport_malloc_from_json(jo_tmp2);
-        // seqs remains null, resolve them now
-        json_object_object_get_ex(jo_tmp2, "sequences", &jo_tmp3);
-        for (int j=0; j<json_object_array_length(jo_tmp3); j++) {
-            jo_tmp4 = json_object_array_get_idx(jo_tmp3, i);
-            name = json_object_get_string(jo_tmp4);
-            seq_tmp = session_get_sequence_from_name(sesh, name);
+    if (sequences) {
+
+        // size an arena for the sequences up front, so they're all carved
+        // from one locked region. the ones that can't be heard keep their
+        // trigs packed, off the arena
+        jsonReader_seek(jr, sequences);
+        jsonReader_begin_array(jr);
+        while (jsonReader_next_element(jr)) {
+            arena_size += sequence_read_json_arena_size(jr, sesh);
+        }
+        if (arena_size > 0) {
+            sq_session_init_arena(sesh, arena_size, false);
+        }
+
+        // add the sequences
+        jsonReader_seek(jr, sequences);
+        jsonReader_begin_array(jr);
+        while (jsonReader_next_element(jr)) {
+            seq_tmp = sequence_read_json(jr, sesh, sesh->arena);
             if (seq_tmp) {
-                sq_inport_add_sequence(inport_tmp, seq_tmp);
+                sq_session_add_sequence(sesh, seq_tmp);
             }
         }
-        sq_session_register_inport(sesh, inport_tmp);
+
+    }
+
+    // add the inports
+    if (inports) {
+        jsonReader_seek(jr, inports);
+        jsonReader_begin_array(jr);
+        while (jsonReader_next_element(jr)) {
+            sq_session_register_inport(sesh, inport_read_json(jr, sesh));
+        }
+    }
+
+    if (jsonReader_failed(jr)) {
+        sq_session_delete_recursive(sesh);
+        return NULL;
     }
 
     return sesh;
 
 }
 
+static sq_session_t session_load_file(const char *filename, bool offline) {
+
+    // an offline session isn't journaled, or timed
+
+    int fd;
+    struct stat st;
+    size_t size;
+    char *map, *buf;
+    jsonReader_t *jr;
+    struct timespec t0, t1;
+    sq_session_t sesh = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "failed to open %s\n", filename);
+        return NULL;
+    }
+
+    if ((fstat(fd, &st) < 0) || (st.st_size == 0)) {
+        fprintf(stderr, "error while reading file: %s\n", filename);
+        close(fd);
+        return NULL;
+    }
+    size = st.st_size;
+
+#ifdef MAP_POPULATE
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+#else
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+#endif
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "error while reading file: %s\n", filename);
+        return NULL;
+    }
+
+    if (sqb_is_sqb(map, size)) {
+        sesh = sqb_read(map, size, offline);
+    } else {
+        buf = malloc(size + 1);
+        memcpy(buf, map, size);
+        buf[size] = '\0';
+        jr = malloc(sizeof(jsonReader_t));
+        jsonReader_init(jr, buf);
+        sesh = session_read_json(jr, offline);
+        free(jr);
+        free(buf);
+    }
+
+    // then any edits made since it was saved
+    if (sesh && !offline) {
+        journal_replay(sesh, filename, map, size);
+    }
+
+    munmap(map, size);
+
+    if (sesh && !offline) {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        sesh->load_time = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    }
+
+    return sesh;
+
+}
+
+static bool session_filename_is_sqb(const char *filename) {
+
+    size_t len = strlen(filename);
+
+    return (len >= 4) && !strcmp(filename + len - 4, ".sqb");
+
+}
+
+
+static void session_sync(sq_session_t sesh) {
+
+    // waits for the RT thread to apply the messages already sent to it
+
+    if (sesh->is_playing) {
+
+        session_ctrl_msg_t msg;
+        msg.param = SESSION_SYNC;
+
+        bool done = false;
+        msg.donep = &done;
+
+        if (session_ringbuffer_write(sesh, &msg)) {
+            while (!done) {
+                usleep(1000);
+            }
+        }
+
+    }
+
+}
+
@@ -0,0 +1,212 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sequoia/snapshot.h"
+
+// LOCAL DECLARATIONS
+
+static pattern_t *snapshot_pattern(snapshot_t*, sq_session_t, int);
+static sq_sequence_t snapshot_seq(snapshot_t*, sq_session_t, sq_sequence_t);
+static sq_outport_t snapshot_outport(snapshot_t*, sq_session_t, sq_outport_t);
+
+// PUBLIC CODE
+
+snapshot_t *snapshot_new(sq_session_t sesh) {
+
+    // everything but what snapshot_capture_now fills in. the sequences are
+    // copied whole first, so that nothing is left unset
+
+    snapshot_t *snapshot = malloc(sizeof(snapshot_t));
+    sq_session_t copy = &snapshot->sesh;
+    sq_inport_t inport;
+    int n;
+
+    memcpy(copy, sesh, sizeof(struct session_data));
+    copy->snapshot = NULL;
+    copy->arena = NULL;
+    copy->history = NULL;
+    copy->journal = NULL;
+
+    for (int i=0; i<sesh->noutports; i++) {
+        snapshot->outports[i] = *sesh->outports[i];
+        copy->outports[i] = snapshot->outports + i;
+    }
+
+    snapshot->next_seq = 0;
+    snapshot->next_step = 0;
+
+    snapshot->seqs = malloc((sesh->nseqs + 1) * sizeof(struct sequence_data));
+    snapshot->patterns = malloc((sesh->nseqs + 1) * sizeof(pattern_t*));
+    for (int i=0; i<sesh->nseqs; i++) {
+        snapshot->seqs[i] = *sesh->seqs[i];
+        snapshot->patterns[i] = snapshot_pattern(snapshot, sesh, i);
+        snapshot->seqs[i].pattern = snapshot->patterns[i];
+        snapshot->seqs[i].trigs = snapshot->patterns[i]->trigs;
+        snapshot->seqs[i].outport = snapshot_outport(snapshot, sesh, sesh->seqs[i]->outport);
+        snapshot->seqs[i].arena = NULL;
+        snapshot->seqs[i].session = NULL;
+        copy->seqs[i] = snapshot->seqs + i;
+    }
+
+    // an inport keeps only the sequences and outports that are in the session
+    snapshot->inports = malloc((sesh->ninports + 1) * sizeof(struct inport_data));
+    for (int i=0; i<sesh->ninports; i++) {
+        inport = snapshot->inports + i;
+        *inport = *sesh->inports[i];
+        for (int j=n=0; j<inport->nseqs; j++) {
+            if ((inport->seqs[n] = snapshot_seq(snapshot, sesh, inport->seqs[j]))) n++;
+        }
+        inport->nseqs = n;
+        for (int j=n=0; j<inport->nthru; j++) {
+            if ((inport->thru[n] = snapshot_outport(snapshot, sesh, inport->thru[j]))) n++;
+        }
+        inport->nthru = n;
+        copy->inports[i] = inport;
+    }
+
+    return snapshot;
+
+}
+
+void snapshot_delete(snapshot_t *snapshot) {
+
+    for (int i=0; i<snapshot->sesh.nseqs; i++) {
+        pattern_unref(snapshot->patterns[i]);
+    }
+
+    free(snapshot->inports);
+    free(snapshot->patterns);
+    free(snapshot->seqs);
+    free(snapshot);
+
+}
+
+bool snapshot_capture_now(snapshot_t *snapshot, sq_session_t sesh) {
+
+    // the parameters that inports change on the RT thread, and the trigs
+    // it records. the trigs are copied SNAPSHOT_MAX_NSTEPS at a time, one
+    // slice per call, so that recording into many long sequences can't
+    // overrun a cycle. each step is as it stood when its slice was copied,
+    // and the parameters as they stood at the last call. returns true once
+    // everything is in, and there are no locks
+
+    sq_sequence_t seq, copy;
+    int budget = SNAPSHOT_MAX_NSTEPS;
+    int n;
+
+    snapshot->sesh.bpm = sesh->bpm;
+
+    for (int i=0; (i<sesh->nseqs) && (i<snapshot->sesh.nseqs); i++) {
+        seq = sesh->seqs[i];
+        copy = snapshot->sesh.seqs[i];
+        copy->transpose = seq->transpose;
+        copy->div = seq->div;
+        copy->first = seq->first;
+        copy->last = seq->last;
+        copy->mute = seq->mute;
+        copy->motion = seq->motion;
+    }
+
+    for (; (snapshot->next_seq < sesh->nseqs) && (snapshot->next_seq < snapshot->sesh.nseqs);
+            snapshot->next_seq++, snapshot->next_step = 0) {
+        seq = sesh->seqs[snapshot->next_seq];
+        if (!seq->recorded) continue;
+        copy = snapshot->sesh.seqs[snapshot->next_seq];
+        n = seq->nsteps - snapshot->next_step;
+        if (n > budget) n = budget;
+        memcpy(copy->trigs + snapshot->next_step, seq->trigs + snapshot->next_step,
+                n * sizeof(struct trigger_data));
+        snapshot->next_step += n;
+        budget -= n;
+        if (snapshot->next_step < seq->nsteps) {
+            return false;
+        }
+    }
+
+    return true;
+
+}
+
+// LOCAL CODE
+
+static pattern_t *snapshot_pattern(snapshot_t *snapshot, sq_session_t sesh, int index) {
+
+    // the snapshot's pattern for sequence index. one that's only written
+    // at the UI's request is shared; a linked one, which the UI edits in
+    // place, is copied now; and one that's recorded into is left for the
+    // RT thread to copy. linked sequences keep sharing their copy
+
+    sq_sequence_t seq = sesh->seqs[index];
+    pattern_t *pattern;
+
+    if (!seq->recorded && !seq->pattern->linked) {
+        pattern_ref(seq->pattern);
+        return seq->pattern;
+    }
+
+    for (int i=0; i<index; i++) {
+        if (sesh->seqs[i]->pattern == seq->pattern) {
+            pattern_ref(snapshot->patterns[i]);
+            return snapshot->patterns[i];
+        }
+    }
+
+    pattern = pattern_new(seq->nsteps, NULL);
+    pattern->linked = seq->pattern->linked;
+    if (!seq->recorded) {
+        pattern_read(seq->pattern, 0, seq->nsteps, pattern->trigs);
+    }
+
+    return pattern;
+
+}
+
+static sq_sequence_t snapshot_seq(snapshot_t *snapshot, sq_session_t sesh, sq_sequence_t seq) {
+
+    for (int i=0; i<sesh->nseqs; i++) {
+        if (sesh->seqs[i] == seq) {
+            return snapshot->seqs + i;
+        }
+    }
+
+    return NULL;
+
+}
+
+static sq_outport_t snapshot_outport(snapshot_t *snapshot, sq_session_t sesh,
+                                        sq_outport_t outport) {
+
+    for (int i=0; i<sesh->noutports; i++) {
+        if (sesh->outports[i] == outport) {
+            return snapshot->outports + i;
+        }
+    }
+
+    return NULL;
+
+}
@@ -0,0 +1,620 @@
+/*
+
+    Copyright 2018, Chris Chronopoulos
+
+    This file is part of libsequoia.
+
+    libsequoia is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    libsequoia is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with libsequoia.  If not, see <https://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#include "sequoia/sqb.h"
+#include "sequoia/session.h"
+
+// LOCAL DECLARATIONS
+
+#define SQB_ALIGN 8
+
+typedef struct {
+
+    char *buf;
+    uint32_t len;
+
+} sqb_strings_t;
+
+static uint32_t sqb_align(uint32_t);
+static uint32_t sqb_string(sqb_strings_t*, const char*);
+static uint32_t sqb_link(sq_session_t, int);
+static uint32_t sqb_pack_trigs(sq_trigger_t, int, struct sqb_trigger*);
+static void sqb_write_section(FILE*, uint32_t*, const void*, size_t);
+static bool sqb_section_ok(const struct sqb_section*, size_t, size_t);
+static bool sqb_validate(const char*, size_t);
+static bool sqb_trigs_ok(const struct sqb_trigger*, uint32_t, int);
+static bool sqb_trig_ok(const struct sqb_trigger*);
+static bool sqb_loads_packed(sq_session_t, const struct sqb_sequence*);
+static void sqb_unpack_trigs(sq_sequence_t, const struct sqb_trigger*, uint32_t);
+static pattern_t *sqb_unpack_packed(const struct sqb_trigger*, uint32_t, int, arena_t*);
+static void sqb_unpack_trig(const struct sqb_trigger*, sq_trigger_t);
+
+// PUBLIC CODE
+
+int sqb_write(sq_session_t sesh, FILE *fp) {
+
+    // everything is packed into tables first, since the header needs to
+    // know how big each one is, and then written out in order. each pattern
+    // is read in one go, so it's consistent even while playing
+
+    struct sqb_header hdr;
+    struct sqb_outport *outports;
+    struct sqb_sequence *seqs;
+    struct sqb_inport *inports;
+    struct sqb_trigger *trigs;
+    struct trigger_data *scratch;
+    uint32_t *refs;
+    sqb_strings_t strings;
+    size_t max_strings, max_trigs = 0, max_refs = 0;
+    int max_nsteps = 0;
+    uint32_t pos;
+    sq_sequence_t seq;
+    sq_inport_t inport;
+
+    // bound the sizes of the tables
+
+    max_strings = strlen(sq_session_get_name(sesh)) + 1;
+    for (int i=0; i<sesh->noutports; i++) {
+        max_strings += strlen(sesh->outports[i]->name) + 1;
+    }
+    for (int i=0; i<sesh->nseqs; i++) {
+        max_strings += strlen(sesh->seqs[i]->name) + 1;
+        max_trigs += pattern_is_packed(sesh->seqs[i]->pattern) ? sesh->seqs[i]->pattern->npacked
+                                                                : sesh->seqs[i]->nsteps;
+        if (sesh->seqs[i]->nsteps > max_nsteps) {
+            max_nsteps = sesh->seqs[i]->nsteps;
+        }
+    }
+    for (int i=0; i<sesh->ninports; i++) {
+        max_strings += strlen(sesh->inports[i]->name) + 1;
+        max_refs += sesh->inports[i]->nseqs + sesh->inports[i]->nthru;
+    }
+
+    outports = malloc((sesh->noutports + 1) * sizeof(struct sqb_outport));
+    seqs = malloc((sesh->nseqs + 1) * sizeof(struct sqb_sequence));
+    inports = malloc((sesh->ninports + 1) * sizeof(struct sqb_inport));
+    refs = malloc((max_refs + 1) * sizeof(uint32_t));
+    trigs = malloc((max_trigs + 1) * sizeof(struct sqb_trigger));
+    scratch = malloc((max_nsteps + 1) * sizeof(struct trigger_data));
+    strings.buf = malloc(max_strings);
+    strings.len = 0;
+
+    // pack them
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SQB_MAGIC, sizeof(hdr.magic));
+    hdr.version = SQB_VERSION;
+    hdr.byte_order = SQB_BYTE_ORDER;
+    hdr.name = sqb_string(&strings, sq_session_get_name(sesh));
+    hdr.bpm = sq_session_get_bpm(sesh);
+
+    for (int i=0; i<sesh->noutports; i++) {
+        outports[i].name = sqb_string(&strings, sesh->outports[i]->name);
+    }
+
+    for (int i=0; i<sesh->nseqs; i++) {
+        seq = sesh->seqs[i];
+        seqs[i].name = sqb_string(&strings, seq->name);
+        seqs[i].nsteps = seq->nsteps;
+        seqs[i].transpose = sq_sequence_get_transpose(seq);
+        seqs[i].clockdivide = sq_sequence_get_clockdivide(seq);
+        seqs[i].first = sq_sequence_get_first(seq);
+        seqs[i].last = sq_sequence_get_last(seq);
+        seqs[i].motion = sq_sequence_get_motion(seq);
+        seqs[i].mute = sq_sequence_get_mute(seq);
+        seqs[i].outport = SQB_NONE;
+        for (int j=0; j<sesh->noutports; j++) {
+            if (seq->outport == sesh->outports[j]) {
+                seqs[i].outport = j;
+                break;
+            }
+        }
+        seqs[i].fanout = seq->fanout;
+        seqs[i].link = sqb_link(sesh, i);
+        seqs[i].trigs = hdr.trigs.count;
+        seqs[i].ntrigs = 0;
+        if (seqs[i].link == SQB_NONE) {
+            pattern_read(seq->pattern, 0, seq->nsteps, scratch);
+            seqs[i].ntrigs = sqb_pack_trigs(scratch, seq->nsteps, trigs + hdr.trigs.count);
+            hdr.trigs.count += seqs[i].ntrigs;
+        }
+    }
+
+    for (int i=0; i<sesh->ninports; i++) {
+        inport = sesh->inports[i];
+        inports[i].name = sqb_string(&strings, inport->name);
+        inports[i].type = inport->type;
+        inports[i].record_mode = inport->rec_mode;
+        inports[i].thru_channel = inport->thru_channel;
+        inports[i].thru_transpose = inport->thru_transpose;
+        inports[i].reserved = 0;
+        inports[i].seqs = hdr.refs.count;
+        inports[i].nseqs = 0;
+        for (int j=0; j<inport->nseqs; j++) {
+            for (int k=0; k<sesh->nseqs; k++) {
+                if (inport->seqs[j] == sesh->seqs[k]) {
+                    refs[hdr.refs.count++] = k;
+                    inports[i].nseqs++;
+                    break;
+                }
+            }
+        }
+        inports[i].thru = hdr.refs.count;
+        inports[i].nthru = 0;
+        for (int j=0; j<inport->nthru; j++) {
+            for (int k=0; k<sesh->noutports; k++) {
+                if (inport->thru[j] == sesh->outports[k]) {
+                    refs[hdr.refs.count++] = k;
+                    inports[i].nthru++;
+                    break;
+                }
+            }
+        }
+    }
+
+    // lay out the sections
+
+    hdr.outports.count = sesh->noutports;
+    hdr.sequences.count = sesh->nseqs;
+    hdr.inports.count = sesh->ninports;
+    hdr.strings.count = strings.len;
+
+    pos = sqb_align(sizeof(hdr));
+    hdr.outports.offset = pos;
+    pos = sqb_align(pos + hdr.outports.count * sizeof(struct sqb_outport));
+    hdr.sequences.offset = pos;
+    pos = sqb_align(pos + hdr.sequences.count * sizeof(struct sqb_sequence));
+    hdr.inports.offset = pos;
+    pos = sqb_align(pos + hdr.inports.count * sizeof(struct sqb_inport));
+    hdr.refs.offset = pos;
+    pos = sqb_align(pos + hdr.refs.count * sizeof(uint32_t));
+    hdr.trigs.offset = pos;
+    pos = sqb_align(pos + hdr.trigs.count * sizeof(struct sqb_trigger));
+    hdr.strings.offset = pos;
+
+    // and write them out
+
+    pos = 0;
+    sqb_write_section(fp, &pos, &hdr, sizeof(hdr));
+    sqb_write_section(fp, &pos, outports, hdr.outports.count * sizeof(struct sqb_outport));
+    sqb_write_section(fp, &pos, seqs, hdr.sequences.count * sizeof(struct sqb_sequence));
+    sqb_write_section(fp, &pos, inports, hdr.inports.count * sizeof(struct sqb_inport));
+    sqb_write_section(fp, &pos, refs, hdr.refs.count * sizeof(uint32_t));
+    sqb_write_section(fp, &pos, trigs, hdr.trigs.count * sizeof(struct sqb_trigger));
+    sqb_write_section(fp, &pos, strings.buf, strings.len);
+
+    free(strings.buf);
+    free(scratch);
+    free(trigs);
+    free(refs);
+    free(inports);
+    free(seqs);
+    free(outports);
+
+    return ferror(fp) ? -1 : 0;
+
+}
+
+bool sqb_is_sqb(const char *buf, size_t size) {
+
+    return (size >= sizeof(struct sqb_header)) && !memcmp(buf, SQB_MAGIC, 4);
+
+}
+
+sq_session_t sqb_read(const char *buf, size_t size, bool offline) {
+
+    // the file is checked through first, so that building the session
+    // from it can't fail halfway. buf must be aligned for the records, as
+    // a mapping of the file is. an offline session has no JACK client
+
+    const struct sqb_header *hdr = (const struct sqb_header*) buf;
+    const struct sqb_outport *outports;
+    const struct sqb_sequence *seqs;
+    const struct sqb_inport *inports;
+    const struct sqb_trigger *trigs;
+    const uint32_t *refs;
+    const char *strings;
+    sq_session_t sesh;
+    sq_sequence_t seq;
+    sq_inport_t inport;
+    size_t arena_size = 0;
+    bool packed;
+
+    if (!sqb_validate(buf, size)) {
+        return NULL;
+    }
+
+    outports = (const struct sqb_outport*) (buf + hdr->outports.offset);
+    seqs = (const struct sqb_sequence*) (buf + hdr->sequences.offset);
+    inports = (const struct sqb_inport*) (buf + hdr->inports.offset);
+    refs = (const uint32_t*) (buf + hdr->refs.offset);
+    trigs = (const struct sqb_trigger*) (buf + hdr->trigs.offset);
+    strings = buf + hdr->strings.offset;
+
+    // malloc and init the session
+    sesh = session_new(strings + hdr->name, offline);
+    sq_session_set_bpm(sesh, hdr->bpm);
+
+    // add the outports
+    for (int i=0; i<hdr->outports.count; i++) {
+        sq_session_register_outport(sesh, sq_outport_new(strings + outports[i].name));
+    }
+
+    // size an arena for the sequences up front, then carve them from it.
+    // the ones that can't be heard keep their trigs packed, off the arena,
+    // and long, sparse ones are played packed, as their records are
+    for (int i=0; i<hdr->sequences.count; i++) {
+        arena_size += sequence_arena_size(seqs[i].nsteps, seqs[i].ntrigs,
+                                            sqb_loads_packed(sesh, seqs + i));
+    }
+    if (arena_size > 0) {
+        sq_session_init_arena(sesh, arena_size, false);
+    }
+
+    for (int i=0; i<hdr->sequences.count; i++) {
+        packed = false;
+        if (seqs[i].link != SQB_NONE) {
+            seq = sequence_new(seqs[i].nsteps, sesh->arena);
+        } else if (sqb_loads_packed(sesh, seqs + i)) {
+            seq = sequence_new_pattern(sqb_unpack_packed(trigs + seqs[i].trigs, seqs[i].ntrigs,
+                                        seqs[i].nsteps, NULL), sesh->arena, true);
+            packed = true;
+        } else if (pattern_fits_packed(seqs[i].nsteps, seqs[i].ntrigs)) {
+            seq = sequence_new_pattern(sqb_unpack_packed(trigs + seqs[i].trigs, seqs[i].ntrigs,
+                                        seqs[i].nsteps, sesh->arena), sesh->arena, false);
+            packed = true;
+        } else {
+            seq = sequence_new_pattern(pattern_new(seqs[i].nsteps, sesh->arena), sesh->arena,
+                                        false);
+        }
+        sq_sequence_set_name(seq, strings + seqs[i].name);
+        sq_sequence_set_mute(seq, seqs[i].mute);
+        sq_sequence_set_transpose(seq, seqs[i].transpose);
+        sq_sequence_set_clockdivide(seq, seqs[i].clockdivide);
+        sq_sequence_set_first(seq, seqs[i].first);
+        sq_sequence_set_last(seq, seqs[i].last);
+        sq_sequence_set_motion(seq, seqs[i].motion);
+        if (seqs[i].outport != SQB_NONE) {
+            sq_sequence_set_outport(seq, sesh->outports[seqs[i].outport]);
+        }
+        for (int j=0; j<hdr->outports.count; j++) {
+            if (seqs[i].fanout & (1u << j)) {
+                sq_sequence_add_fanout(seq, sesh->outports[j]);
+            }
+        }
+        if (seqs[i].link != SQB_NONE) {
+            sequence_link_pattern(seq, sesh->seqs[seqs[i].link]);
+        } else if (!packed) {
+            sqb_unpack_trigs(seq, trigs + seqs[i].trigs, seqs[i].ntrigs);
+        }
+        sq_session_add_sequence(sesh, seq);
+    }
+
+    // add the inports
+    for (int i=0; i<hdr->inports.count; i++) {
+        inport = sq_inport_new(strings + inports[i].name);
+        sq_inport_set_type(inport, inports[i].type);
+        sq_inport_set_record_mode(inport, inports[i].record_mode);
+        sq_inport_set_thru_channel(inport, inports[i].thru_channel);
+        sq_inport_set_thru_transpose(inport, inports[i].thru_transpose);
+        for (int j=0; j<inports[i].nseqs; j++) {
+            sq_inport_add_sequence(inport, sesh->seqs[refs[inports[i].seqs + j]]);
+        }
+        for (int j=0; j<inports[i].nthru; j++) {
+            sq_inport_add_thru(inport, sesh->outports[refs[inports[i].thru + j]]);
+        }
+        sq_session_register_inport(sesh, inport);
+    }
+
+    return sesh;
+
+}
+
+// LOCAL CODE
+
+static uint32_t sqb_align(uint32_t pos) {
+
+    return (pos + SQB_ALIGN - 1) & ~(uint32_t) (SQB_ALIGN - 1);
+
+}
+
+static uint32_t sqb_string(sqb_strings_t *strings, const char *str) {
+
+    // appends str to the table and returns its offset
+
+    uint32_t offset = strings->len;
+    size_t len = strlen(str) + 1;
+
+    memcpy(strings->buf + offset, str, len);
+    strings->len += len;
+
+    return offset;
+
+}
+
+static uint32_t sqb_link(sq_session_t sesh, int i) {
+
+    // linked sequences point back at the first one sharing their pattern
+
+    if (sq_sequence_is_linked(sesh->seqs[i])) {
+        for (int j=0; j<i; j++) {
+            if (sesh->seqs[j]->pattern == sesh->seqs[i]->pattern) {
+                return j;
+            }
+        }
+    }
+
+    return SQB_NONE;
+
+}
+
+static uint32_t sqb_pack_trigs(sq_trigger_t src, int nsteps, struct sqb_trigger *dst) {
+
+    // stores the steps that don't hold the default trig, each with the
+    // number of default ones skipped over to get to it
+
+    uint32_t n = 0;
+    int skip = 0;
+
+    for (int i=0; i<nsteps; i++) {
+        if (trigger_is_default(src + i)) {
+            skip++;
+            continue;
+        }
+        dst[n].skip = skip;
+        dst[n].type = src[i].type;
+        dst[n].channel = src[i].channel;
+        dst[n].note_value = src[i].note_value;
+        dst[n].note_velocity = src[i].note_velocity;
+        dst[n].cc_number = src[i].cc_number;
+        dst[n].cc_value = src[i].cc_value;
+        dst[n].outport = (src[i].outport < 0) ? SQB_TRIG_NONE : src[i].outport;
+        memset(dst[n].reserved, 0, sizeof(dst[n].reserved));
+        dst[n].microtime = src[i].microtime;
+        dst[n].probability = src[i].probability;
+        dst[n].note_length = src[i].note_length;
+        n++;
+        skip = 0;
+    }
+
+    return n;
+
+}
+
+static void sqb_write_section(FILE *fp, uint32_t *pos, const void *data, size_t size) {
+
+    // pads up to the section's boundary first
+
+    static const char zeros[SQB_ALIGN];
+
+    fwrite(zeros, 1, sqb_align(*pos) - *pos, fp);
+    *pos = sqb_align(*pos);
+
+    fwrite(data, 1, size, fp);
+    *pos += size;
+
+}
+
+static bool sqb_section_ok(const struct sqb_section *section, size_t record_size, size_t size) {
+
+    return (section->offset % SQB_ALIGN == 0) && (section->offset <= size)
+            && (section->count <= (size - section->offset) / record_size);
+
+}
+
+static bool sqb_validate(const char *buf, size_t size) {
+
+    const struct sqb_header *hdr = (const struct sqb_header*) buf;
+    const struct sqb_outport *outports;
+    const struct sqb_sequence *seqs;
+    const struct sqb_inport *inports;
+    const struct sqb_trigger *trigs;
+    const uint32_t *refs;
+    uint32_t nstrings;
+
+    if (!sqb_is_sqb(buf, size)) {
+        fprintf(stderr, "sqb: not a session file\n");
+        return false;
+    }
+
+    if (hdr->version != SQB_VERSION) {
+        fprintf(stderr, "sqb: unsupported version %u\n", hdr->version);
+        return false;
+    }
+
+    if (hdr->byte_order != SQB_BYTE_ORDER) {
+        fprintf(stderr, "sqb: file was written with another byte order\n");
+        return false;
+    }
+
+    if (!sqb_section_ok(&hdr->outports, sizeof(struct sqb_outport), size)
+            || !sqb_section_ok(&hdr->sequences, sizeof(struct sqb_sequence), size)
+            || !sqb_section_ok(&hdr->inports, sizeof(struct sqb_inport), size)
+            || !sqb_section_ok(&hdr->refs, sizeof(uint32_t), size)
+            || !sqb_section_ok(&hdr->trigs, sizeof(struct sqb_trigger), size)
+            || !sqb_section_ok(&hdr->strings, 1, size)) {
+        fprintf(stderr, "sqb: file is truncated\n");
+        return false;
+    }
+
+    if ((hdr->outports.count > SESSION_MAX_NOUTPORTS) || (hdr->sequences.count > SESSION_MAX_NSEQ)
+            || (hdr->inports.count > SESSION_MAX_NINPORTS)) {
+        fprintf(stderr, "sqb: too many ports or sequences\n");
+        return false;
+    }
+
+    // the table must end in a NUL, so that every offset into it is a string
+    nstrings = hdr->strings.count;
+    if ((nstrings == 0) || (buf[hdr->strings.offset + nstrings - 1] != '\0')
+            || (hdr->name >= nstrings)) {
+        fprintf(stderr, "sqb: bad string table\n");
+        return false;
+    }
+
+    outports = (const struct sqb_outport*) (buf + hdr->outports.offset);
+    for (int i=0; i<hdr->outports.count; i++) {
+        if (outports[i].name >= nstrings) {
+            fprintf(stderr, "sqb: bad outport %d\n", i);
+            return false;
+        }
+    }
+
+    seqs = (const struct sqb_sequence*) (buf + hdr->sequences.offset);
+    trigs = (const struct sqb_trigger*) (buf + hdr->trigs.offset);
+    for (int i=0; i<hdr->sequences.count; i++) {
+        if ((seqs[i].name >= nstrings)
+                || (seqs[i].nsteps <= 0) || (seqs[i].nsteps > SEQUENCE_MAX_NSTEPS)
+                || ((seqs[i].outport != SQB_NONE) && (seqs[i].outport >= hdr->outports.count))
+                || (seqs[i].fanout >> hdr->outports.count)
+                || ((seqs[i].link != SQB_NONE) && ((seqs[i].link >= i)
+                    || (seqs[seqs[i].link].nsteps != seqs[i].nsteps)))
+                || (seqs[i].trigs > hdr->trigs.count)
+                || (seqs[i].ntrigs > hdr->trigs.count - seqs[i].trigs)
+                || !sqb_trigs_ok(trigs + seqs[i].trigs, seqs[i].ntrigs, seqs[i].nsteps)) {
+            fprintf(stderr, "sqb: bad sequence %d\n", i);
+            return false;
+        }
+    }
+
+    inports = (const struct sqb_inport*) (buf + hdr->inports.offset);
+    refs = (const uint32_t*) (buf + hdr->refs.offset);
+    for (int i=0; i<hdr->inports.count; i++) {
+        if ((inports[i].name >= nstrings)
+                || (inports[i].seqs > hdr->refs.count)
+                || (inports[i].nseqs > hdr->refs.count - inports[i].seqs)
+                || (inports[i].thru > hdr->refs.count)
+                || (inports[i].nthru > hdr->refs.count - inports[i].thru)) {
+            fprintf(stderr, "sqb: bad inport %d\n", i);
+            return false;
+        }
+        for (int j=0; j<inports[i].nseqs; j++) {
+            if (refs[inports[i].seqs + j] >= hdr->sequences.count) {
+                fprintf(stderr, "sqb: bad inport %d\n", i);
+                return false;
+            }
+        }
+        for (int j=0; j<inports[i].nthru; j++) {
+            if (refs[inports[i].thru + j] >= hdr->outports.count) {
+                fprintf(stderr, "sqb: bad inport %d\n", i);
+                return false;
+            }
+        }
+    }
+
+    return true;
+
+}
+
+static bool sqb_trigs_ok(const struct sqb_trigger *trigs, uint32_t ntrigs, int nsteps) {
+
+    // every record must land inside the sequence, and hold a trig that could
+    // have been made through the setters
+
+    int step = 0;
+
+    for (int i=0; i<ntrigs; i++) {
+        step += trigs[i].skip;
+        if ((step >= nsteps) || !sqb_trig_ok(trigs + i)) {
+            return false;
+        }
+        step++;
+    }
+
+    return true;
+
+}
+
+static bool sqb_trig_ok(const struct sqb_trigger *rec) {
+
+    // the fields are copied as they are, so they're range-checked here. the
+    // float comparisons are written so that a NaN fails them
+
+    return (rec->type <= TRIG_CC)
+            && (rec->channel >= 1) && (rec->channel <= 16)
+            && (rec->note_value <= 127) && (rec->note_velocity <= 127)
+            && (rec->cc_number <= 127) && (rec->cc_value <= 127)
+            && ((rec->outport == SQB_TRIG_NONE) || (rec->outport < SESSION_MAX_NOUTPORTS))
+            && (rec->microtime >= -0.5) && (rec->microtime < 0.5)
+            && (rec->probability >= 0.) && (rec->probability <= 1.)
+            && (rec->note_length >= 0.) && (rec->note_length <= FLT_MAX);
+
+}
+
+static bool sqb_loads_packed(sq_session_t sesh, const struct sqb_sequence *seq) {
+
+    return sequence_loads_packed(seq->mute,
+                (seq->outport != SQB_NONE) ? sesh->outports[seq->outport] : NULL,
+                (seq->link != SQB_NONE) ? (int) seq->link : -1);
+
+}
+
+static void sqb_unpack_trigs(sq_sequence_t seq, const struct sqb_trigger *trigs, uint32_t ntrigs) {
+
+    // the new sequence's steps already hold the default trig, so only the
+    // records need copying in
+
+    int step = 0;
+
+    for (int i=0; i<ntrigs; i++) {
+        step += trigs[i].skip;
+        sqb_unpack_trig(trigs + i, seq->trigs + step++);
+    }
+
+}
+
+static pattern_t *sqb_unpack_packed(const struct sqb_trigger *trigs, uint32_t ntrigs, int nsteps,
+                                        arena_t *arena) {
+
+    // the records make a packed pattern as they are, a step apiece
+
+    pattern_t *pattern = pattern_new_packed(nsteps, ntrigs, arena);
+    int step = 0;
+
+    for (int i=0; i<ntrigs; i++) {
+        step += trigs[i].skip;
+        pattern->packed[i].step = step++;
+        sqb_unpack_trig(trigs + i, &pattern->packed[i].trig);
+    }
+
+    return pattern;
+
+}
+
+static void sqb_unpack_trig(const struct sqb_trigger *rec, sq_trigger_t trig) {
+
+    trig->type = rec->type;
+    trig->channel = rec->channel;
+    trig->note_value = rec->note_value;
+    trig->note_velocity = rec->note_velocity;
+    trig->cc_number = rec->cc_number;
+    trig->cc_value = rec->cc_value;
+    trig->outport = (rec->outport == SQB_TRIG_NONE) ? -1 : rec->outport;
+    trig->microtime = rec->microtime;
+    trig->probability = rec->probability;
+    trig->note_length = rec->note_length;
+
+}
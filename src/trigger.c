@@ -21,7 +21,11 @@
 
 #include "sequoia.h"
 #include "sequoia/trigger.h"
+#include "sequoia/session.h"
 
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 // INTERFACE CODE
@@ -142,6 +146,20 @@ void sq_trigger_set_channel(sq_trigger_t trig, int channel) {
 
 }
 
+void sq_trigger_set_outport(sq_trigger_t trig, int outport) {
+
+    // an index into the session's outports. the trig plays through that one
+    // alone, in place of its sequence's outport and fanout. -1 clears it
+
+    if ((outport < -1) || (outport >= SESSION_MAX_NOUTPORTS)) {
+        fprintf(stderr, "trig outport of %d is out of range\n", outport);
+        return;
+    }
+
+    trig->outport = outport;
+
+}
+
 enum trig_type  sq_trigger_get_type(sq_trigger_t trig) {
 
     return trig->type;
@@ -196,6 +214,12 @@ int sq_trigger_get_channel(sq_trigger_t trig) {
 
 }
 
+int sq_trigger_get_outport(sq_trigger_t trig) {
+
+    return trig->outport;
+
+}
+
 // PUBLIC CODE
 
 void trigger_init(sq_trigger_t trig) {
@@ -213,103 +237,153 @@ void trigger_init(sq_trigger_t trig) {
 
     trig->probability = 1.;
 
-}
-
-json_object *trigger_get_json(sq_trigger_t trig) {
-
-    json_object *jo_trigger = json_object_new_object();
-
-    json_object_object_add(jo_trigger, "type",
-                            json_object_new_int(trig->type));
-
-    json_object_object_add(jo_trigger, "channel",
-                            json_object_new_int(trig->channel));
-
-    json_object_object_add(jo_trigger, "microtime",
-                            json_object_new_double(trig->microtime));
-
-    json_object_object_add(jo_trigger, "note",
-                            json_object_new_int(trig->note_value));
-
-    json_object_object_add(jo_trigger, "velocity",
-                            json_object_new_int(trig->note_velocity));
+    trig->outport = -1;
 
-    json_object_object_add(jo_trigger, "length",
-                            json_object_new_double(trig->note_length));
+}
 
-    json_object_object_add(jo_trigger, "cc_number",
-                            json_object_new_int(trig->cc_number));
+bool trigger_is_default(sq_trigger_t trig) {
 
-    json_object_object_add(jo_trigger, "cc_value",
-                            json_object_new_int(trig->cc_value));
+    struct trigger_data def;
 
-    json_object_object_add(jo_trigger, "probability",
-                            json_object_new_double(trig->probability));
+    trigger_init(&def);
 
-    return jo_trigger;
+    return !memcmp(trig, &def, sizeof(struct trigger_data));
 
 }
 
-sq_trigger_t trigger_malloc_from_json(json_object *jo_trig) {
-
-    struct json_object *jo_tmp;
-    int type, channel, note_value, note_velocity, cc_number, cc_value;
-    float microtime, note_length, probability;
-    sq_trigger_t trig;
+bool trigger_is_valid(sq_trigger_t trig) {
 
-    // first extract the attributes
+    // for trigs read back from a file, with the same ranges the .sqb reader
+    // checks. the float comparisons are written so that a NaN fails them
 
-    json_object_object_get_ex(jo_trig, "type", &jo_tmp);
-    type = json_object_get_int(jo_tmp);
+    return (trig->type >= TRIG_NULL) && (trig->type <= TRIG_CC)
+            && (trig->channel >= 1) && (trig->channel <= 16)
+            && (trig->note_value >= 0) && (trig->note_value <= 127)
+            && (trig->note_velocity >= 0) && (trig->note_velocity <= 127)
+            && (trig->cc_number >= 0) && (trig->cc_number <= 127)
+            && (trig->cc_value >= 0) && (trig->cc_value <= 127)
+            && (trig->outport >= -1) && (trig->outport < SESSION_MAX_NOUTPORTS)
+            && (trig->microtime >= -0.5) && (trig->microtime < 0.5)
+            && (trig->probability >= 0.) && (trig->probability <= 1.)
+            && (trig->note_length >= 0.) && (trig->note_length <= FLT_MAX);
 
-    json_object_object_get_ex(jo_trig, "channel", &jo_tmp);
-    channel = json_object_get_int(jo_tmp);
+}
 
-    json_object_object_get_ex(jo_trig, "microtime", &jo_tmp);
-    microtime = json_object_get_double(jo_tmp);
+void trigger_write_json(sq_trigger_t trig, jsonWriter_t *jw, int step) {
 
-    json_object_object_get_ex(jo_trig, "note", &jo_tmp);
-    note_value = json_object_get_int(jo_tmp);
+    // only the attributes that differ from a new trig's are written, since
+    // the reader fills in the rest, all on one line. step is the trig's index
+    // in its sequence, or -1 to leave it implied by its position in the list
 
-    json_object_object_get_ex(jo_trig, "velocity", &jo_tmp);
-    note_velocity = json_object_get_int(jo_tmp);
+    struct trigger_data def;
 
-    json_object_object_get_ex(jo_trig, "length", &jo_tmp);
-    note_length = json_object_get_double(jo_tmp);
+    trigger_init(&def);
 
-    json_object_object_get_ex(jo_trig, "cc_number", &jo_tmp);
-    cc_number = json_object_get_int(jo_tmp);
+    jsonWriter_begin_compact_object(jw, NULL);
+    if (step >= 0) {
+        jsonWriter_int(jw, "step", step);
+    }
+    if (trig->type != def.type) {
+        jsonWriter_int(jw, "type", trig->type);
+    }
+    if (trig->channel != def.channel) {
+        jsonWriter_int(jw, "channel", trig->channel);
+    }
+    if (trig->microtime != def.microtime) {
+        jsonWriter_double(jw, "microtime", trig->microtime);
+    }
+    if (trig->note_value != def.note_value) {
+        jsonWriter_int(jw, "note", trig->note_value);
+    }
+    if (trig->note_velocity != def.note_velocity) {
+        jsonWriter_int(jw, "velocity", trig->note_velocity);
+    }
+    if (trig->note_length != def.note_length) {
+        jsonWriter_double(jw, "length", trig->note_length);
+    }
+    if (trig->cc_number != def.cc_number) {
+        jsonWriter_int(jw, "cc_number", trig->cc_number);
+    }
+    if (trig->cc_value != def.cc_value) {
+        jsonWriter_int(jw, "cc_value", trig->cc_value);
+    }
+    if (trig->probability != def.probability) {
+        jsonWriter_double(jw, "probability", trig->probability);
+    }
+    if (trig->outport != def.outport) {
+        jsonWriter_int(jw, "outport", trig->outport);
+    }
+    jsonWriter_end_object(jw);
 
-    json_object_object_get_ex(jo_trig, "cc_value", &jo_tmp);
-    cc_value = json_object_get_int(jo_tmp);
+}
 
-    json_object_object_get_ex(jo_trig, "probability", &jo_tmp);
-    probability = json_object_get_double(jo_tmp);
+int trigger_read_json(sq_trigger_t trig, jsonReader_t *jr) {
+
+    // reads a trig through the setters, so the values are range-checked.
+    // missing attributes take their defaults. returns the trig's "step",
+    // or -1 if it has none, as in the dense form, where each step's trig
+    // is listed in order
+
+    const char *key;
+    struct trigger_data in;
+    int step = -1;
+
+    trigger_init(&in);
+
+    jsonReader_begin_object(jr);
+    while (jsonReader_next_key(jr, &key)) {
+        if (!strcmp(key, "step")) {
+            step = jsonReader_int(jr);
+        } else if (!strcmp(key, "type")) {
+            in.type = jsonReader_int(jr);
+        } else if (!strcmp(key, "channel")) {
+            in.channel = jsonReader_int(jr);
+        } else if (!strcmp(key, "microtime")) {
+            in.microtime = jsonReader_double(jr);
+        } else if (!strcmp(key, "note")) {
+            in.note_value = jsonReader_int(jr);
+        } else if (!strcmp(key, "velocity")) {
+            in.note_velocity = jsonReader_int(jr);
+        } else if (!strcmp(key, "length")) {
+            in.note_length = jsonReader_double(jr);
+        } else if (!strcmp(key, "cc_number")) {
+            in.cc_number = jsonReader_int(jr);
+        } else if (!strcmp(key, "cc_value")) {
+            in.cc_value = jsonReader_int(jr);
+        } else if (!strcmp(key, "probability")) {
+            in.probability = jsonReader_double(jr);
+        } else if (!strcmp(key, "outport")) {
+            in.outport = jsonReader_int(jr);
+        } else {
+            jsonReader_skip(jr);
+        }
+    }
 
     // then set the trig
 
-    trig = sq_trigger_new();
-    switch (type) {
+    trigger_init(trig);
+    switch (in.type) {
         case TRIG_NULL:
             sq_trigger_set_type(trig, TRIG_NULL);
             break;
         case TRIG_NOTE:
             sq_trigger_set_type(trig, TRIG_NOTE);
-            sq_trigger_set_note_value(trig, note_value);
-            sq_trigger_set_note_velocity(trig, note_velocity);
-            sq_trigger_set_note_length(trig, note_length);
+            sq_trigger_set_note_value(trig, in.note_value);
+            sq_trigger_set_note_velocity(trig, in.note_velocity);
+            sq_trigger_set_note_length(trig, in.note_length);
             break;
         case TRIG_CC:
             sq_trigger_set_type(trig, TRIG_CC);
-            sq_trigger_set_cc_number(trig, cc_number);
-            sq_trigger_set_cc_value(trig, cc_value);
+            sq_trigger_set_cc_number(trig, in.cc_number);
+            sq_trigger_set_cc_value(trig, in.cc_value);
             break;
     }
-    sq_trigger_set_channel(trig, channel);
-    sq_trigger_set_microtime(trig, microtime);
-    sq_trigger_set_probability(trig, probability);
+    sq_trigger_set_channel(trig, in.channel);
+    sq_trigger_set_microtime(trig, in.microtime);
+    sq_trigger_set_probability(trig, in.probability);
+    sq_trigger_set_outport(trig, in.outport);
 
-    return trig;
+    return step;
 
 }
 
@@ -0,0 +1,108 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "fakejack.h"
+
+// clones share their trigs until either side is edited, while linked
+// sequences share every edit until unlinked. an inport only takes a shared
+// pattern apart if it records into it
+
+static void note(sq_sequence_t seq, int step, int value) {
+
+    sq_trigger_t trig = sq_trigger_new();
+
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_trigger_set_note_value(trig, value);
+    sq_sequence_set_trig(seq, step, trig);
+    sq_trigger_delete(trig);
+
+}
+
+static int note_at(sq_sequence_t seq, int step) {
+
+    struct trigger_data trig;
+
+    sq_sequence_get_trig(seq, step, &trig);
+
+    return (trig.type == TRIG_NOTE) ? trig.note_value : -1;
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("clone");
+    sq_sequence_t orig = sq_sequence_new(16);
+    note(orig, 0, 60);
+    sq_session_add_sequence(sesh, orig);
+
+    // copy on write, from either side
+    sq_sequence_t clone = sq_sequence_clone(orig);
+    sq_session_add_sequence(sesh, clone);
+    assert((clone->pattern == orig->pattern) && !sq_sequence_is_linked(clone));
+    assert(note_at(clone, 0) == 60);
+    note(clone, 1, 61);
+    assert(clone->pattern != orig->pattern);
+    assert((note_at(clone, 1) == 61) && (note_at(orig, 1) == -1) && (note_at(clone, 0) == 60));
+
+    sq_sequence_t clone2 = sq_sequence_clone(orig);
+    sq_session_add_sequence(sesh, clone2);
+    note(orig, 2, 62);
+    assert(clone2->pattern != orig->pattern);
+    assert((note_at(orig, 2) == 62) && (note_at(clone2, 2) == -1));
+
+    // linked, until unlinked
+    sq_sequence_t linked = sq_sequence_new_linked(orig);
+    sq_session_add_sequence(sesh, linked);
+    assert((linked->pattern == orig->pattern) && sq_sequence_is_linked(linked));
+    assert(sq_sequence_is_linked(orig));
+    note(linked, 3, 63);
+    sq_sequence_clear_trig(orig, 0);
+    assert((linked->pattern == orig->pattern) && (note_at(orig, 3) == 63));
+    assert(note_at(linked, 0) == -1);
+
+    // a clone of a linked sequence is a copy, not another link
+    sq_sequence_t copy = sq_sequence_clone(linked);
+    sq_session_add_sequence(sesh, copy);
+    note(linked, 4, 64);
+    assert((note_at(copy, 3) == 63) && (note_at(copy, 4) == -1));
+
+    sq_sequence_unlink(linked);
+    assert(!sq_sequence_is_linked(linked) && (linked->pattern != orig->pattern));
+    note(linked, 5, 65);
+    assert((note_at(linked, 4) == 64) && (note_at(orig, 5) == -1));
+
+    // edits made while playing go the same way
+    sq_sequence_t played = sq_sequence_clone(orig);
+    sq_session_add_sequence(sesh, played);
+    sq_session_start(sesh);
+    fakejack_start(0, NULL, NULL);
+    note(played, 6, 66);
+    fakejack_stop();
+    sq_session_stop(sesh);
+    fakejack_cycle();
+    assert((note_at(played, 6) == 66) && (note_at(orig, 6) == -1));
+
+    // only a recording inport gives its sequences patterns of their own
+    sq_sequence_t shared = sq_sequence_clone(orig);
+    sq_session_add_sequence(sesh, shared);
+    sq_inport_t inport = sq_inport_new("in");
+    sq_inport_set_type(inport, INPORT_TRANSPOSE);
+    sq_inport_add_sequence(inport, shared);
+    sq_session_register_inport(sesh, inport);
+    assert((shared->pattern == orig->pattern) && !shared->recorded);
+    sq_inport_set_type(inport, INPORT_MUTE);
+    assert((shared->pattern == orig->pattern) && !shared->recorded);
+    sq_inport_set_type(inport, INPORT_RECORD);
+    assert((shared->pattern != orig->pattern) && shared->recorded);
+    assert(note_at(shared, 3) == 63);
+
+    sq_session_delete_recursive(sesh);
+    printf("test-clone: ok\n");
+
+    return 0;
+
+}
@@ -0,0 +1,159 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "sequoia/journal.h"
+#include "fakejack.h"
+
+// fanout: a sequence's trigs go to its outport and to each outport in its
+// fanout, once each, unless a trig names an outport of its own, in which
+// case they go only there. the fanout survives saving in either format,
+// the journal, and a reload whose file lists the outports in another order
+
+#define BS 256
+#define FPS 6000    // frames per step, at 48k and 120 bpm
+
+static unsigned long events(sq_outport_t outport) {
+
+    struct sq_outport_stats stats;
+
+    sq_outport_get_stats(outport, &stats);
+
+    return stats.events;
+
+}
+
+static void check_loaded(const char *path) {
+
+    sq_session_t sesh = sq_session_load(path);
+    struct trigger_data trig;
+
+    assert(sesh && (sq_session_get_noutports(sesh) == 3));
+    assert(sq_session_find_seq(sesh, "drums")->fanout == 0x3);
+    assert(sq_session_find_seq(sesh, "lead")->fanout == 0x2);
+    sq_sequence_get_trig(sq_session_find_seq(sesh, "lead"), 10, &trig);
+    assert(trig.outport == 2);
+    sq_sequence_get_trig(sq_session_find_seq(sesh, "lead"), 2, &trig);
+    assert(trig.outport == -1);
+    sq_session_delete_recursive(sesh);
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, BS);
+
+    sq_session_t sesh = sq_session_new("fanout");
+    sq_session_set_bpm(sesh, 120);
+    sq_outport_t hw = sq_outport_new("hw"), soft = sq_outport_new("soft");
+    sq_outport_t third = sq_outport_new("third"), loose = sq_outport_new("loose");
+    sq_session_register_outport(sesh, hw);
+    sq_session_register_outport(sesh, soft);
+    sq_session_register_outport(sesh, third);
+
+    // the sequence's own outport, and one that isn't in the session, add
+    // nothing to its fanout
+    sq_trigger_t trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_sequence_t drums = sq_sequence_new(16);
+    sq_sequence_set_name(drums, "drums");
+    for (int step=0; step<16; step+=4) {
+        sq_sequence_set_trig(drums, step, trig);
+    }
+    sq_sequence_set_outport(drums, hw);
+    sq_sequence_add_fanout(drums, soft);
+    sq_sequence_add_fanout(drums, hw);
+    sq_sequence_add_fanout(drums, loose);
+    assert(drums->fanout == 0x3);
+    sq_session_add_sequence(sesh, drums);
+
+    // a trig with an outport of its own goes only there
+    sq_sequence_t lead = sq_sequence_new(16);
+    sq_sequence_set_name(lead, "lead");
+    sq_sequence_set_trig(lead, 2, trig);
+    sq_trigger_set_outport(trig, 2);
+    sq_trigger_set_outport(trig, SESSION_MAX_NOUTPORTS);    // out of range, so ignored
+    assert(sq_trigger_get_outport(trig) == 2);
+    sq_sequence_set_trig(lead, 10, trig);
+    sq_sequence_set_outport(lead, hw);
+    sq_sequence_add_fanout(lead, soft);
+    sq_session_add_sequence(sesh, lead);
+
+    // play two passes, up to just before the third, a cycle at a time. each
+    // note is an on and an off
+    sq_session_start(sesh);
+    for (unsigned long frame=0; frame + BS <= 32 * FPS - FPS / 10; frame += BS) {
+        fakejack_cycle();
+    }
+    sq_session_stop(sesh);
+    fakejack_cycle();
+    assert(events(hw) == 2 * 2 * (4 + 1));
+    assert(events(soft) == 2 * 2 * (4 + 1));
+    assert(events(third) == 2 * 2 * 1);
+
+    // saved and loaded, in either format
+    sq_session_save(sesh, "test-fanout.json");
+    check_loaded("test-fanout.json");
+    sq_session_save(sesh, "test-fanout.sqb");
+    check_loaded("test-fanout.sqb");
+
+    // journaled, and replayed after a crash
+    unlink("test-fanout-j.sqb.journal");
+    assert(sq_session_enable_journal(sesh, "test-fanout-j.sqb") == 0);
+    sq_sequence_rm_fanout(drums, soft);
+    sq_sequence_rm_fanout(drums, loose);
+    sq_sequence_add_fanout(drums, third);
+    sq_sequence_add_fanout(lead, third);
+    usleep(10 * JOURNAL_POLL_US);
+    sq_session_t crash = sq_session_load("test-fanout-j.sqb");
+    assert(crash);
+    assert(sq_session_find_seq(crash, "drums")->fanout == 0x5);
+    assert(sq_session_find_seq(crash, "lead")->fanout == 0x6);
+    sq_session_delete_recursive(crash);
+    sq_session_disable_journal(sesh);
+
+    // reloaded from a file with the outports in another order, and one
+    // more: the fanout is by name, so it's mapped onto the session's own
+    sq_session_t file = sq_session_new("file");
+    sq_outport_t f_soft = sq_outport_new("soft"), f_new = sq_outport_new("new");
+    sq_outport_t f_hw = sq_outport_new("hw");
+    sq_session_register_outport(file, f_soft);
+    sq_session_register_outport(file, f_new);
+    sq_session_register_outport(file, f_hw);
+    sq_sequence_t f_drums = sq_sequence_new(16);
+    sq_sequence_set_name(f_drums, "drums");
+    sq_sequence_set_outport(f_drums, f_hw);
+    sq_sequence_add_fanout(f_drums, f_soft);
+    sq_sequence_add_fanout(f_drums, f_new);
+    sq_session_add_sequence(file, f_drums);
+    sq_session_save(file, "test-fanout-r.sqb");
+    sq_session_delete_recursive(file);
+
+    sq_session_start(sesh);
+    fakejack_start(0, NULL, NULL);
+    assert(sq_session_reload(sesh, "test-fanout-r.sqb") == 0);
+    fakejack_stop();
+    sq_session_stop(sesh);
+    fakejack_cycle();
+    drums = sq_session_find_seq(sesh, "drums");
+    assert(sq_session_get_noutports(sesh) == 4);
+    assert(sq_sequence_get_outport(drums) == hw);
+    assert(!strcmp(sq_outport_get_name(sq_session_get_outport(sesh, 3)), "new"));
+    assert(drums->fanout == ((1u << 1) | (1u << 3)));
+
+    sq_session_delete_recursive(sesh);
+    sq_outport_delete(loose);
+    sq_trigger_delete(trig);
+    unlink("test-fanout.json");
+    unlink("test-fanout.sqb");
+    unlink("test-fanout-j.sqb");
+    unlink("test-fanout-j.sqb.journal");
+    unlink("test-fanout-r.sqb");
+    printf("test-fanout: ok\n");
+
+    return 0;
+
+}
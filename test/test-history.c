@@ -0,0 +1,117 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "fakejack.h"
+
+// undo and redo: single edits, groups (nested or not) undone as one, the
+// oldest groups dropped when the history is full, and an undo that can't
+// be sent to the RT thread leaving everything as it was
+
+static void note(sq_sequence_t seq, int step, int value) {
+
+    sq_trigger_t trig = sq_trigger_new();
+
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_trigger_set_note_value(trig, value);
+    sq_sequence_set_trig(seq, step, trig);
+    sq_trigger_delete(trig);
+
+}
+
+static int note_at(sq_sequence_t seq, int step) {
+
+    struct trigger_data trig;
+
+    sq_sequence_get_trig(seq, step, &trig);
+
+    return (trig.type == TRIG_NOTE) ? trig.note_value : -1;
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("history");
+    sq_sequence_t seq = sq_sequence_new(16), lng = sq_sequence_new(4096);
+    sq_session_add_sequence(sesh, seq);
+    sq_session_add_sequence(sesh, lng);
+
+    assert(!sq_session_undo(sesh));
+    assert(sq_session_enable_history(sesh, 0) == -1);
+    assert(sq_session_enable_history(sesh, 4) == 0);
+    assert(sq_session_enable_history(sesh, 8) == -1);
+    assert(!sq_session_undo(sesh) && !sq_session_redo(sesh));
+
+    // one edit at a time
+    note(seq, 0, 60);
+    sq_sequence_set_transpose(seq, 5);
+    assert(sq_session_undo(sesh) && (seq->transpose == 0) && (note_at(seq, 0) == 60));
+    assert(sq_session_undo(sesh) && (note_at(seq, 0) == -1));
+    assert(!sq_session_undo(sesh));
+    assert(sq_session_redo(sesh) && (note_at(seq, 0) == 60) && (seq->transpose == 0));
+    assert(sq_session_redo(sesh) && (seq->transpose == 5));
+    assert(!sq_session_redo(sesh));
+
+    // a group, nested, is undone and redone as one
+    sq_session_begin_edit(sesh);
+    note(seq, 1, 61);
+    sq_session_begin_edit(sesh);
+    note(seq, 2, 62);
+    sq_sequence_clear_trig(seq, 0);
+    sq_session_end_edit(sesh);
+    sq_sequence_set_transpose(seq, 7);
+    sq_session_end_edit(sesh);
+    assert(sq_session_undo(sesh));
+    assert((note_at(seq, 0) == 60) && (note_at(seq, 1) == -1) && (note_at(seq, 2) == -1));
+    assert(seq->transpose == 5);
+    assert(sq_session_redo(sesh));
+    assert((note_at(seq, 0) == -1) && (note_at(seq, 1) == 61) && (note_at(seq, 2) == 62));
+    assert(seq->transpose == 7);
+
+    // the group filled the history, so only it is left. a new edit after
+    // an undo drops the redo
+    assert(sq_session_undo(sesh) && !sq_session_undo(sesh));
+    note(seq, 3, 63);
+    assert(!sq_session_redo(sesh));
+    assert(sq_session_undo(sesh) && (note_at(seq, 3) == -1));
+    assert(!sq_session_undo(sesh));
+
+    // edits that make no change aren't recorded
+    sq_session_clear_history(sesh);
+    sq_sequence_set_transpose(seq, seq->transpose);
+    assert(!sq_session_undo(sesh));
+
+    // while playing, an undo goes through the RT thread, and one whose
+    // message has no room fails without touching anything: here, an edit
+    // to a packed sequence, which would otherwise be made up front
+    note(lng, 100, 64);
+    assert(pattern_is_packed(lng->pattern));
+    sq_session_start(sesh);
+    fakejack_cycle();
+    struct sq_session_stats stats;
+    sq_session_get_stats(sesh, &stats);
+    unsigned long overflows = stats.rb_overflows;
+    while (stats.rb_overflows == overflows) {
+        sq_session_set_bpm(sesh, 120);
+        sq_session_get_stats(sesh, &stats);
+    }
+    assert(!sq_session_undo(sesh));
+    assert(note_at(lng, 100) == 64);
+
+    fakejack_cycle();
+    fakejack_start(0, NULL, NULL);
+    assert(sq_session_undo(sesh) && (note_at(lng, 100) == -1));
+    assert(sq_session_redo(sesh) && (note_at(lng, 100) == 64));
+    fakejack_stop();
+    sq_session_stop(sesh);
+    fakejack_cycle();
+
+    sq_session_delete_recursive(sesh);
+    printf("test-history: ok\n");
+
+    return 0;
+
+}
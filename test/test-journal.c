@@ -0,0 +1,149 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "sequoia/journal.h"
+#include "fakejack.h"
+
+// journal replay after a crash: a torn last record, a record corrupted on
+// disk, and a well-formed record with a trig that's out of range each end
+// the replay there, keeping the records before them
+
+#define NTRIGS 8
+
+static char *journal;
+static long journal_size;
+
+static void put(const char *path, const char *buf, long size) {
+
+    FILE *fp = fopen(path, "wb");
+
+    assert(fp);
+    fwrite(buf, 1, size, fp);
+    fclose(fp);
+
+}
+
+static char *get(const char *path, long *size) {
+
+    FILE *fp = fopen(path, "rb");
+    char *buf;
+
+    assert(fp);
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    rewind(fp);
+    buf = malloc(*size);
+    assert(fread(buf, 1, *size, fp) == *size);
+    fclose(fp);
+
+    return buf;
+
+}
+
+static long record_at(int i) {
+
+    // the offset of the ith trig record; the journal starts with the
+    // sequence's name, then the trigs
+
+    long pos = sizeof(struct journal_header);
+    uint16_t size;
+
+    for (int k=0; k<=i; k++) {
+        memcpy(&size, journal + pos + offsetof(journal_record_t, size), sizeof(size));
+        pos += size;
+    }
+
+    return pos;
+
+}
+
+static int nreplayed(const char *buf, long size) {
+
+    // loads the crashed session with this journal, and counts the trigs it got back
+
+    sq_session_t sesh;
+    struct trigger_data trig;
+    int n;
+
+    put("crash.sqb.journal", buf, size);
+    sesh = sq_session_load("crash.sqb");
+    assert(sesh && (sq_session_get_nseqs(sesh) == 1));
+    assert(!strcmp(sq_sequence_get_name(sq_session_get_seq(sesh, 0)), "lead"));
+    for (n=0; n<NTRIGS; n++) {
+        sq_sequence_get_trig(sq_session_get_seq(sesh, 0), n, &trig);
+        if (trig.type != TRIG_NOTE) break;
+        assert(trig.note_value == 60 + n);
+    }
+    sq_session_delete_recursive(sesh);
+
+    return n;
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("journal");
+    sq_sequence_t seq = sq_sequence_new(16);
+    sq_session_add_sequence(sesh, seq);
+    assert(sq_session_enable_journal(sesh, "test-journal.sqb") == 0);
+
+    sq_trigger_t trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_sequence_set_name(seq, "lead");
+    for (int i=0; i<NTRIGS; i++) {
+        sq_trigger_set_note_value(trig, 60 + i);
+        sq_sequence_set_trig(seq, i, trig);
+    }
+
+    // crash, once the writer thread has caught up
+    usleep(10 * JOURNAL_POLL_US);
+    long size;
+    char *snapshot = get("test-journal.sqb", &size);
+    put("crash.sqb", snapshot, size);
+    free(snapshot);
+    journal = get("test-journal.sqb.journal", &journal_size);
+    assert(nreplayed(journal, journal_size) == NTRIGS);
+
+    // torn in the last record
+    assert(nreplayed(journal, journal_size - 5) == NTRIGS - 1);
+
+    // a bit flipped in the fifth, leaving a trig that would otherwise pass
+    char *buf = malloc(journal_size);
+    memcpy(buf, journal, journal_size);
+    buf[record_at(4) + offsetof(journal_record_t, v.trig.trig.note_value)] ^= 0x01;
+    assert(nreplayed(buf, journal_size) == 4);
+
+    // a third that hashes right, but has a note out of range
+    journal_record_t rec;
+    long pos = record_at(2);
+    memcpy(buf, journal, journal_size);
+    memcpy(&rec, buf + pos, offsetof(journal_record_t, v));
+    memcpy(&rec, buf + pos, rec.size);
+    rec.v.trig.trig.note_value = 200;
+    rec.check = 0;
+    rec.check = journal_hash((const char*) &rec, rec.size);
+    memcpy(buf + pos, &rec, rec.size);
+    assert(nreplayed(buf, journal_size) == 2);
+
+    free(buf);
+    free(journal);
+    sq_session_disable_journal(sesh);
+    sq_session_delete_recursive(sesh);
+    sq_trigger_delete(trig);
+    unlink("test-journal.sqb");
+    unlink("test-journal.sqb.journal");
+    unlink("crash.sqb");
+    unlink("crash.sqb.journal");
+    printf("test-journal: ok\n");
+
+    return 0;
+
+}
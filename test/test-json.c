@@ -0,0 +1,206 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "fakejack.h"
+
+// JSON sessions: only the steps that don't hold the default trig are
+// written, each with its step and the attributes that differ from a new
+// trig's, and they load back the same. older files, which list every step
+// in full and in order, still load, as do files mixing the two forms
+
+#define NSTEPS 32
+
+// the dense form, as sessions used to be saved
+static const char *dense =
+    "{\n"
+    "  \"name\": \"old\",\n"
+    "  \"bpm\": 90,\n"
+    "  \"sequences\": [\n"
+    "    {\n"
+    "      \"name\": \"a\",\n"
+    "      \"nsteps\": 3,\n"
+    "      \"mute\": false,\n"
+    "      \"transpose\": 0,\n"
+    "      \"clockdivide\": 1,\n"
+    "      \"first\": 0,\n"
+    "      \"last\": 2,\n"
+    "      \"motion\": 0,\n"
+    "      \"triggers\": [\n"
+    "        {\"type\": 0, \"channel\": 1, \"microtime\": 0, \"note\": 60, \"velocity\": 100,"
+            " \"length\": 0.8, \"cc_number\": 0, \"cc_value\": 0, \"probability\": 1},\n"
+    "        {\"type\": 1, \"channel\": 4, \"microtime\": 0.25, \"note\": 64, \"velocity\": 90,"
+            " \"length\": 2, \"cc_number\": 0, \"cc_value\": 0, \"probability\": 0.5},\n"
+    "        {\"type\": 2, \"channel\": 1, \"microtime\": 0, \"note\": 60, \"velocity\": 100,"
+            " \"length\": 0.8, \"cc_number\": 7, \"cc_value\": 99, \"probability\": 1}\n"
+    "      ],\n"
+    "      \"outport\": \"o\"\n"
+    "    },\n"
+    "    {\n"
+    "      \"name\": \"mixed\",\n"
+    "      \"nsteps\": 8,\n"
+    "      \"triggers\": [\n"
+    "        {\"step\": 5, \"type\": 1, \"note\": 50},\n"
+    "        {\"type\": 1, \"note\": 51},\n"
+    "        {\"step\": 1, \"type\": 1, \"note\": 52},\n"
+    "        {\"step\": 8, \"type\": 1, \"note\": 53}\n"
+    "      ],\n"
+    "      \"outport\": \"o\"\n"
+    "    }\n"
+    "  ],\n"
+    "  \"inports\": [],\n"
+    "  \"outports\": [\n"
+    "    {\n"
+    "      \"name\": \"o\"\n"
+    "    }\n"
+    "  ]\n"
+    "}\n";
+
+static char *get(const char *path) {
+
+    FILE *fp = fopen(path, "rb");
+    long size;
+    char *buf;
+
+    assert(fp);
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    buf = malloc(size + 1);
+    assert(fread(buf, 1, size, fp) == size);
+    buf[size] = '\0';
+    fclose(fp);
+
+    return buf;
+
+}
+
+static int count(const char *text, const char *s) {
+
+    int n = 0;
+
+    for (const char *p=text; (p = strstr(p, s)); p++) n++;
+
+    return n;
+
+}
+
+static bool same(sq_trigger_t a, sq_trigger_t b) {
+
+    return (a->type == b->type) && (a->channel == b->channel)
+            && (a->microtime == b->microtime) && (a->note_value == b->note_value)
+            && (a->note_velocity == b->note_velocity) && (a->note_length == b->note_length)
+            && (a->cc_number == b->cc_number) && (a->cc_value == b->cc_value)
+            && (a->probability == b->probability) && (a->outport == b->outport);
+
+}
+
+static void check_same(sq_sequence_t a, sq_sequence_t b) {
+
+    struct trigger_data ta[NSTEPS], tb[NSTEPS];
+
+    assert(sq_sequence_get_nsteps(a) == sq_sequence_get_nsteps(b));
+    sq_sequence_get_trigs(a, 0, sq_sequence_get_nsteps(a), ta);
+    sq_sequence_get_trigs(b, 0, sq_sequence_get_nsteps(b), tb);
+    for (int step=0; step<sq_sequence_get_nsteps(a); step++) {
+        assert(same(ta + step, tb + step));
+    }
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("json");
+    sq_outport_t out = sq_outport_new("o");
+    sq_session_register_outport(sesh, out);
+
+    sq_sequence_t lead = sq_sequence_new(16), quiet = sq_sequence_new(NSTEPS);
+    sq_sequence_set_name(lead, "lead");
+    sq_sequence_set_outport(lead, out);
+    sq_sequence_set_name(quiet, "quiet");
+    sq_sequence_set_mute(quiet, true);
+
+    sq_trigger_t trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_trigger_set_channel(trig, 5);
+    sq_trigger_set_probability(trig, 0.5);
+    sq_sequence_set_trig(lead, 3, trig);
+    sq_trigger_delete(trig);
+    trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_CC);
+    sq_trigger_set_cc_number(trig, 74);
+    sq_trigger_set_microtime(trig, -0.125);
+    sq_trigger_set_outport(trig, 0);
+    sq_sequence_set_trig(lead, 15, trig);
+    sq_trigger_delete(trig);
+    trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_trigger_set_note_value(trig, 40);
+    sq_trigger_set_note_length(trig, 4);
+    sq_sequence_set_trig(quiet, NSTEPS - 1, trig);
+    sq_session_add_sequence(sesh, lead);
+    sq_session_add_sequence(sesh, quiet);
+
+    // the file holds the three trigs, with just what sets them apart
+    sq_session_save(sesh, "test-json.json");
+    char *text = get("test-json.json");
+    assert(count(text, "\"step\"") == 3);
+    assert(strstr(text, "{\"step\": 3, \"type\": 1, \"channel\": 5, \"probability\": 0.5}"));
+    assert(strstr(text, "{\"step\": 15, \"type\": 2, \"microtime\": -0.125, \"cc_number\": 74, \"outport\": 0}"));
+    assert(strstr(text, "{\"step\": 31, \"type\": 1, \"note\": 40, \"length\": 4}"));
+    assert(!strstr(text, "\"velocity\"") && !strstr(text, "\"cc_value\""));
+    free(text);
+
+    // and loads back the same
+    sq_session_t file = sq_session_load("test-json.json");
+    assert(file && (sq_session_get_nseqs(file) == 2));
+    check_same(lead, sq_session_find_seq(file, "lead"));
+    check_same(quiet, sq_session_find_seq(file, "quiet"));
+    assert(pattern_is_packed(sq_session_find_seq(file, "quiet")->pattern));
+    sq_session_delete_recursive(file);
+    sq_session_delete_recursive(sesh);
+
+    // an older, dense file, and one that mixes the forms: a trig without a
+    // step goes to the one after the trig before it, and a step past the
+    // end is dropped
+    FILE *fp = fopen("test-json-dense.json", "w");
+    assert(fp);
+    fputs(dense, fp);
+    fclose(fp);
+
+    struct trigger_data trigs[8];
+    sesh = sq_session_load("test-json-dense.json");
+    assert(sesh && (sq_session_get_nseqs(sesh) == 2) && (sq_session_get_bpm(sesh) == 90));
+    sq_sequence_get_trigs(sq_session_find_seq(sesh, "a"), 0, 3, trigs);
+    assert(trigs[0].type == TRIG_NULL);
+    assert((trigs[1].type == TRIG_NOTE) && (trigs[1].channel == 4) && (trigs[1].microtime == 0.25));
+    assert((trigs[1].note_value == 64) && (trigs[1].note_velocity == 90));
+    assert((trigs[1].note_length == 2) && (trigs[1].probability == 0.5));
+    assert((trigs[2].type == TRIG_CC) && (trigs[2].cc_number == 7) && (trigs[2].cc_value == 99));
+
+    sq_sequence_get_trigs(sq_session_find_seq(sesh, "mixed"), 0, 8, trigs);
+    assert((trigs[5].type == TRIG_NOTE) && (trigs[5].note_value == 50));
+    assert((trigs[6].type == TRIG_NOTE) && (trigs[6].note_value == 51));
+    assert((trigs[1].type == TRIG_NOTE) && (trigs[1].note_value == 52));
+    assert((trigs[0].type == TRIG_NULL) && (trigs[2].type == TRIG_NULL) && (trigs[7].type == TRIG_NULL));
+
+    // saved again, it's sparse
+    sq_session_save(sesh, "test-json.json");
+    text = get("test-json.json");
+    assert(count(text, "\"step\"") == 5);
+    free(text);
+
+    sq_session_delete_recursive(sesh);
+    unlink("test-json.json");
+    unlink("test-json-dense.json");
+    printf("test-json: ok\n");
+
+    return 0;
+
+}
@@ -0,0 +1,91 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "fakejack.h"
+
+// looking sequences and ports up by name: a rename moves the item to its
+// new name, including while the index grows around it, and of several
+// items with one name the first added is found, as a scan would find it
+
+#define NSEQS 1000
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("names");
+    sq_sequence_t seqs[NSEQS];
+    char name[SEQUENCE_MAX_NAME_LEN + 16];
+
+    // enough of them to grow the index a few times over, renamed as they go
+    for (int i=0; i<NSEQS; i++) {
+        seqs[i] = sq_sequence_new(4);
+        sprintf(name, "seq%d", i);
+        sq_sequence_set_name(seqs[i], name);
+        sq_session_add_sequence(sesh, seqs[i]);
+        if (i % 2) {
+            sprintf(name, "renamed%d", i);
+            sq_sequence_set_name(seqs[i], name);
+        }
+    }
+    for (int i=0; i<NSEQS; i++) {
+        sprintf(name, "seq%d", i);
+        assert(sq_session_find_seq(sesh, name) == ((i % 2) ? NULL : seqs[i]));
+        sprintf(name, "renamed%d", i);
+        assert(sq_session_find_seq(sesh, name) == ((i % 2) ? seqs[i] : NULL));
+    }
+
+    // the same name twice: the first added is found, even after it's been
+    // renamed away and back
+    sq_sequence_set_name(seqs[10], "dup");
+    sq_sequence_set_name(seqs[20], "dup");
+    assert(sq_session_find_seq(sesh, "dup") == seqs[10]);
+    sq_sequence_set_name(seqs[10], "away");
+    assert(sq_session_find_seq(sesh, "dup") == seqs[20]);
+    sq_sequence_set_name(seqs[10], "dup");
+    assert(sq_session_find_seq(sesh, "dup") == seqs[10]);
+    sq_session_rm_sequence(sesh, seqs[10]);
+    assert(sq_session_find_seq(sesh, "dup") == seqs[20]);
+    sq_sequence_delete(seqs[10]);
+    assert(!sq_session_find_seq(sesh, "away"));
+
+    // a name too long is cut short, and found as it's kept
+    memset(name, 'x', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    sq_sequence_set_name(seqs[30], name);
+    name[SEQUENCE_MAX_NAME_LEN] = '\0';
+    assert(sq_session_find_seq(sesh, name) == seqs[30]);
+    assert(!sq_session_find_seq(sesh, "seq30"));
+
+    // a sequence renamed before it's added, and after it's taken out
+    sq_sequence_t loose = sq_sequence_new(4);
+    sq_sequence_set_name(loose, "before");
+    sq_session_add_sequence(sesh, loose);
+    assert(sq_session_find_seq(sesh, "before") == loose);
+    sq_session_rm_sequence(sesh, loose);
+    sq_sequence_set_name(loose, "after");
+    assert(!sq_session_find_seq(sesh, "before") && !sq_session_find_seq(sesh, "after"));
+    sq_sequence_delete(loose);
+
+    // and ports
+    sq_outport_t out = sq_outport_new("out");
+    sq_session_register_outport(sesh, out);
+    sq_outport_set_name(out, "synth");
+    assert(!session_get_outport_from_name(sesh, "out"));
+    assert(session_get_outport_from_name(sesh, "synth") == out);
+
+    sq_inport_t in = sq_inport_new("in");
+    sq_session_register_inport(sesh, in);
+    sq_inport_set_name(in, "keys");
+    assert(!session_get_inport_from_name(sesh, "in"));
+    assert(session_get_inport_from_name(sesh, "keys") == in);
+
+    sq_session_delete_recursive(sesh);
+    printf("test-names: ok\n");
+
+    return 0;
+
+}
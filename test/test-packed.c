@@ -0,0 +1,110 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "fakejack.h"
+
+// long, sparse sequences are kept packed, through edits, saving and
+// loading, and until an inport records into them, including one that a
+// reload brings in
+
+#define NSTEPS 4096
+
+static void note(sq_sequence_t seq, int step, int value) {
+
+    sq_trigger_t trig = sq_trigger_new();
+
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_trigger_set_note_value(trig, value);
+    sq_sequence_set_trig(seq, step, trig);
+    sq_trigger_delete(trig);
+
+}
+
+static int count_notes(sq_sequence_t seq, int value) {
+
+    struct trigger_data *trigs = malloc(seq->nsteps * sizeof(struct trigger_data));
+    int n = 0;
+
+    sq_sequence_get_trigs(seq, 0, seq->nsteps, trigs);
+    for (int step=0; step<seq->nsteps; step++) {
+        if ((trigs[step].type == TRIG_NOTE) && (trigs[step].note_value == value)) n++;
+    }
+    free(trigs);
+
+    return n;
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("packed");
+    sq_outport_t out = sq_outport_new("out");
+    sq_session_register_outport(sesh, out);
+    sq_inport_t inport = sq_inport_new("in");
+    sq_inport_set_type(inport, INPORT_RECORD);
+    sq_session_register_inport(sesh, inport);
+
+    // edited while packed, and round-tripped
+    sq_sequence_t seq = sq_sequence_new(NSTEPS);
+    sq_sequence_set_name(seq, "long");
+    sq_sequence_set_outport(seq, out);
+    note(seq, 0, 60);
+    note(seq, 1000, 61);
+    note(seq, NSTEPS - 1, 62);
+    sq_sequence_clear_trig(seq, 1000);
+    sq_session_add_sequence(sesh, seq);
+    assert(pattern_is_packed(seq->pattern));
+    assert((count_notes(seq, 60) == 1) && (count_notes(seq, 61) == 0)
+                && (count_notes(seq, 62) == 1));
+    sq_session_save(sesh, "test-packed-0.sqb");
+
+    sq_session_t file = sq_session_load("test-packed-0.sqb");
+    assert(pattern_is_packed(sq_session_find_seq(file, "long")->pattern));
+    assert(count_notes(sq_session_find_seq(file, "long"), 62) == 1);
+
+    // the file adds a long, sparse sequence for the inport to record into
+    sq_sequence_t take = sq_sequence_new(NSTEPS);
+    sq_sequence_set_name(take, "take");
+    sq_sequence_set_outport(take, out);
+    note(take, 16, 50);
+    sq_session_add_sequence(file, take);
+    sq_inport_add_sequence(sq_session_get_inport(file, 0), take);
+    sq_session_save(file, "test-packed-1.sqb");
+    sq_session_delete_recursive(file);
+
+    sq_session_start(sesh);
+    fakejack_start(0, NULL, NULL);
+    assert(sq_session_reload(sesh, "test-packed-1.sqb") == 0);
+    fakejack_stop();
+
+    take = sq_session_find_seq(sesh, "take");
+    assert(take && take->recorded && !pattern_is_packed(take->pattern));
+    assert(pattern_is_packed(seq->pattern) && !seq->recorded);
+
+    // and it records, still playing, a cycle at a time
+    jack_port_t *port = fakejack_get_port("in");
+    jack_midi_data_t on[3] = {0x90, 64, 100}, off[3] = {0x80, 64, 0};
+    for (int i=0; i<64; i++) {
+        if (i % 8 == 0) fakejack_inject(port, 0, on, 3);
+        if (i % 8 == 4) fakejack_inject(port, 0, off, 3);
+        fakejack_cycle();
+    }
+    assert(count_notes(take, 64) > 0);
+    assert(count_notes(take, 50) == 1);
+
+    sq_session_stop(sesh);
+    fakejack_cycle();
+    sq_session_delete_recursive(sesh);
+    unlink("test-packed-0.sqb");
+    unlink("test-packed-1.sqb");
+    printf("test-packed: ok\n");
+
+    return 0;
+
+}
@@ -0,0 +1,96 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "sequoia.h"
+#include "fakejack.h"
+
+// per-cycle timing: every phase of every cycle lands in its histogram, no
+// phase is ever timed as negative (which would wrap to the top bin), and
+// cycles over the threshold are counted
+
+#define NCYCLES 200
+
+static void check(sq_session_t sesh, unsigned long ncycles) {
+
+    struct sq_perf_stats stats;
+    unsigned long n;
+
+    sq_session_get_perf_stats(sesh, &stats);
+    assert(stats.ncycles == ncycles);
+
+    for (int phase=0; phase<PERF_NPHASES; phase++) {
+        n = 0;
+        for (int bin=0; bin<SQ_PERF_NBINS; bin++) {
+            n += stats.hist[phase][bin];
+        }
+        assert(n == ncycles);
+        assert(stats.hist[phase][SQ_PERF_NBINS - 1] == 0);
+        assert(stats.max[phase] < 1000000000UL);
+    }
+
+}
+
+static void play(jack_port_t *port, int ncycles) {
+
+    // inport events in every cycle, so that some are still pending at its end
+
+    for (int i=0; i<ncycles; i++) {
+        for (int k=0; k<8; k++) {
+            jack_midi_data_t msg[3] = {0x90, 60 + (i + k) % 10, 100};
+            fakejack_inject(port, k * 20, msg, 3);
+        }
+        fakejack_cycle();
+    }
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("perf");
+    sq_outport_t out = sq_outport_new("out");
+    sq_session_register_outport(sesh, out);
+    sq_sequence_t seq = sq_sequence_new(16);
+    sq_sequence_set_outport(seq, out);
+    sq_trigger_t trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    for (int step=0; step<16; step+=2) {
+        sq_sequence_set_trig(seq, step, trig);
+    }
+    sq_session_add_sequence(sesh, seq);
+    sq_inport_t inport = sq_inport_new("in");
+    sq_inport_set_type(inport, INPORT_TRANSPOSE);
+    sq_inport_add_sequence(inport, seq);
+    sq_session_register_inport(sesh, inport);
+    jack_port_t *port = fakejack_get_port("in");
+
+    // stopped, all the inport events are served at the end of the cycle
+    sq_session_reset_perf_stats(sesh);
+    play(port, NCYCLES);
+    check(sesh, NCYCLES);
+
+    // and playing, they're served as they land
+    sq_session_start(sesh);
+    play(port, NCYCLES);
+    check(sesh, 2 * NCYCLES);
+    sq_session_stop(sesh);
+    fakejack_cycle();
+
+    // every cycle takes longer than a millionth of the period (a few ns)
+    struct sq_perf_stats stats;
+    sq_session_reset_perf_stats(sesh);
+    sq_session_set_perf_threshold(sesh, 1e-6);
+    sq_session_set_perf_threshold(sesh, 0.);    // out of range, so ignored
+    play(port, NCYCLES);
+    sq_session_get_perf_stats(sesh, &stats);
+    assert((stats.threshold == 1e-6f) && (stats.nover == NCYCLES));
+    check(sesh, NCYCLES);
+
+    sq_session_delete_recursive(sesh);
+    sq_trigger_delete(trig);
+    printf("test-perf: ok\n");
+
+    return 0;
+
+}
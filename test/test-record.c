@@ -0,0 +1,108 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "fakejack.h"
+
+// recording from an inport: notes are quantized to the nearest step of
+// each sequence, with the rest kept as microtime, the length comes from the
+// note-off, and the UI hears about each recorded trig
+
+#define BS 256
+#define FPS 6000    // frames per step, at 48k and 120 bpm
+
+static jack_port_t *port;
+static unsigned long frame;     // since the session started
+
+static void play_until(unsigned long until) {
+
+    while (frame + BS <= until) {
+        fakejack_cycle();
+        frame += BS;
+    }
+
+}
+
+static void play_at(unsigned long at, unsigned char status, unsigned char note,
+                        unsigned char velocity) {
+
+    jack_midi_data_t msg[3] = {status, note, velocity};
+
+    play_until(at);
+    fakejack_inject(port, at - frame, msg, 3);
+
+}
+
+static bool near(float a, float b) {
+
+    return fabsf(a - b) < 1e-3;
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, BS);
+
+    sq_session_t sesh = sq_session_new("record");
+    sq_session_set_bpm(sesh, 120);
+    sq_sequence_t plain = sq_sequence_new(16), slow = sq_sequence_new(16);
+    sq_sequence_set_transpose(plain, 2);
+    sq_sequence_set_clockdivide(slow, 2);
+    sq_session_add_sequence(sesh, plain);
+    sq_session_add_sequence(sesh, slow);
+
+    sq_inport_t inport = sq_inport_new("in");
+    sq_inport_set_type(inport, INPORT_RECORD);
+    sq_inport_add_sequence(inport, plain);
+    sq_inport_add_sequence(inport, slow);
+    sq_session_register_inport(sesh, inport);
+    port = fakejack_get_port("in");
+
+    sq_session_start(sesh);
+
+    // step n's trig sounds n steps in. this note is a quarter step after
+    // step 3's, and held for a step and a half. slow's steps are two long,
+    // so it's nearer its step 2, and early by more than its microtime can say
+    play_at(3 * FPS + FPS / 4, 0x91, 64, 100);
+    play_at(3 * FPS + FPS / 4 + 3 * FPS / 2, 0x81, 64, 0);
+
+    // a quarter step before step 6, and slow's step 3
+    play_at(6 * FPS - FPS / 4, 0x90, 70, 90);
+    play_at(6 * FPS, 0x90, 70, 0);      // a note-off
+    play_until(8 * FPS);
+
+    struct trigger_data trig;
+    sq_sequence_get_trig(plain, 3, &trig);
+    assert((trig.type == TRIG_NOTE) && (trig.channel == 2));
+    assert((trig.note_value == 62) && (trig.note_velocity == 100));
+    assert(near(trig.microtime, 0.25) && near(trig.note_length, 1.5));
+    sq_sequence_get_trig(plain, 6, &trig);
+    assert((trig.note_value == 68) && (trig.note_velocity == 90) && near(trig.microtime, -0.25) && near(trig.note_length, 0.25));
+
+    sq_sequence_get_trig(slow, 2, &trig);
+    assert((trig.note_value == 64) && near(trig.microtime, -0.5) && near(trig.note_length, 1.5));
+    sq_sequence_get_trig(slow, 3, &trig);
+    assert((trig.note_value == 70) && near(trig.microtime, -0.25) && near(trig.note_length, 0.25));
+    sq_sequence_get_trig(slow, 1, &trig);
+    assert(trig.type == TRIG_NULL);
+
+    // each trig is reported when it's struck, and again when it's released
+    sq_sequence_t seq;
+    int step, n = 0;
+    while (sq_inport_read_recorded(inport, &seq, &step, &trig)) {
+        assert(((seq == plain) && ((step == 3) || (step == 6)))
+                    || ((seq == slow) && ((step == 2) || (step == 3))));
+        n++;
+    }
+    assert(n == 8);
+
+    sq_session_stop(sesh);
+    fakejack_cycle();
+    sq_session_delete_recursive(sesh);
+    printf("test-record: ok\n");
+
+    return 0;
+
+}
@@ -0,0 +1,130 @@
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "fakejack.h"
+
+// reloading a session from a file edited elsewhere: only what differs is
+// changed, a few trigs in place and many by a new pattern, unchanged
+// sequences keep their playheads, and sequences under an inport that
+// doesn't record are left packed
+
+static void note(sq_sequence_t seq, int step, int value) {
+
+    sq_trigger_t trig = sq_trigger_new();
+
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_trigger_set_note_value(trig, value);
+    sq_sequence_set_trig(seq, step, trig);
+    sq_trigger_delete(trig);
+
+}
+
+static int note_at(sq_sequence_t seq, int step) {
+
+    struct trigger_data trig;
+
+    sq_sequence_get_trig(seq, step, &trig);
+
+    return (trig.type == TRIG_NOTE) ? trig.note_value : -1;
+
+}
+
+static sq_sequence_t named(sq_session_t sesh, const char *name) {
+
+    return sq_session_find_seq(sesh, name);
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("reload");
+    sq_outport_t out = sq_outport_new("out");
+    sq_session_register_outport(sesh, out);
+
+    const char *names[] = {"edited", "same", "many", "gone", "long"};
+    int nsteps[] = {16, 16, 2048, 16, 4096};
+    sq_sequence_t seqs[5];
+    for (int i=0; i<5; i++) {
+        seqs[i] = sq_sequence_new(nsteps[i]);
+        sq_sequence_set_name(seqs[i], names[i]);
+        sq_sequence_set_outport(seqs[i], out);
+        note(seqs[i], 0, 40 + i);
+        sq_session_add_sequence(sesh, seqs[i]);
+    }
+    sq_sequence_t edited = seqs[0], same = seqs[1], many = seqs[2], lng = seqs[4];
+    for (int step=1; step<2048; step++) {
+        note(many, step, 1);
+    }
+    assert(!pattern_is_packed(many->pattern));
+    sq_inport_t inport = sq_inport_new("in");
+    sq_inport_set_type(inport, INPORT_TRANSPOSE);
+    sq_inport_add_sequence(inport, lng);
+    sq_session_register_inport(sesh, inport);
+    assert(pattern_is_packed(lng->pattern) && !lng->recorded);
+    sq_session_save(sesh, "test-reload-0.sqb");
+
+    // the file, edited
+    sq_session_t file = sq_session_load("test-reload-0.sqb");
+    sq_session_set_bpm(file, 140);
+    note(named(file, "edited"), 5, 99);
+    sq_sequence_set_transpose(named(file, "edited"), 3);
+    for (int step=0; step<2048; step++) {
+        note(named(file, "many"), step, step % 128);
+    }
+    sq_session_rm_sequence(file, named(file, "gone"));
+    sq_sequence_t added = sq_sequence_new(16);
+    sq_sequence_set_name(added, "added");
+    note(added, 2, 70);
+    sq_session_add_sequence(file, added);
+    sq_session_save(file, "test-reload-1.sqb");
+    sq_session_delete_recursive(file);
+
+    // reloaded while playing, applied at the start of a bar
+    pattern_t *edited_pattern = edited->pattern, *many_pattern = many->pattern;
+    sq_session_start(sesh);
+    fakejack_start(0, NULL, NULL);
+    usleep(20000);
+    assert(sq_session_reload(sesh, "test-reload-1.sqb") == 0);
+    fakejack_stop();
+
+    assert(sq_session_get_bpm(sesh) == 140);
+    assert(sq_session_get_nseqs(sesh) == 5);
+    assert(!named(sesh, "gone") && named(sesh, "added"));
+    assert(named(sesh, "edited") == edited && named(sesh, "same") == same);
+
+    // a few trigs go in place, and too many for one cycle get a new pattern
+    assert(edited->pattern == edited_pattern);
+    assert((note_at(edited, 0) == 40) && (note_at(edited, 5) == 99) && (edited->transpose == 3));
+    assert(many->pattern != many_pattern);
+    for (int step=0; step<2048; step++) {
+        assert(note_at(many, step) == step % 128);
+    }
+
+    // the sequences left alone kept counting, and the new one started on the bar
+    assert(same->step == sesh->step % 16);
+    assert(named(sesh, "added")->step == sesh->step % 16);
+    assert(pattern_is_packed(lng->pattern) && !lng->recorded);
+
+    sq_session_stop(sesh);
+    fakejack_cycle();
+
+    // and back again, stopped
+    assert(sq_session_reload(sesh, "test-reload-0.sqb") == 0);
+    assert(sq_session_get_nseqs(sesh) == 5 && named(sesh, "gone") && !named(sesh, "added"));
+    assert((note_at(edited, 5) == -1) && (edited->transpose == 0));
+    assert((note_at(many, 0) == 42) && (note_at(many, 1) == 1));
+    assert(pattern_is_packed(lng->pattern) && !lng->recorded);
+
+    sq_session_delete_recursive(sesh);
+    unlink("test-reload-0.sqb");
+    unlink("test-reload-1.sqb");
+    printf("test-reload: ok\n");
+
+    return 0;
+
+}
@@ -0,0 +1,88 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "sequoia/snapshot.h"
+#include "fakejack.h"
+
+// snapshots of sequences recorded into are copied a slice per cycle, and
+// come out whole, whether they're taken while playing or stopped
+
+#define NSEQS 3
+#define NSTEPS 5000
+
+static void check(sq_session_t sesh) {
+
+    struct trigger_data trig;
+
+    assert(sq_session_get_nseqs(sesh) == NSEQS);
+    for (int i=0; i<NSEQS; i++) {
+        for (int step=0; step<NSTEPS; step++) {
+            sq_sequence_get_trig(sq_session_get_seq(sesh, i), step, &trig);
+            if (step % 7) {
+                assert(trig.type == TRIG_NULL);
+            } else {
+                assert((trig.type == TRIG_NOTE) && (trig.note_value == (i + step) % 128));
+            }
+        }
+    }
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("snapshot");
+    sq_inport_t inport = sq_inport_new("in");
+    sq_inport_set_type(inport, INPORT_RECORD);
+    sq_trigger_t trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    for (int i=0; i<NSEQS; i++) {
+        sq_sequence_t seq = sq_sequence_new(NSTEPS);
+        for (int step=0; step<NSTEPS; step+=7) {
+            sq_trigger_set_note_value(trig, (i + step) % 128);
+            sq_sequence_set_trig(seq, step, trig);
+        }
+        sq_session_add_sequence(sesh, seq);
+        sq_inport_add_sequence(inport, seq);
+    }
+    sq_session_register_inport(sesh, inport);
+    for (int i=0; i<NSEQS; i++) {
+        assert(sq_session_get_seq(sesh, i)->recorded);
+    }
+
+    // the slices, one call at a time
+    snapshot_t *snapshot = snapshot_new(sesh);
+    int ncalls = 1;
+    while (!snapshot_capture_now(snapshot, sesh)) {
+        ncalls++;
+    }
+    assert(ncalls == (NSEQS * NSTEPS + SNAPSHOT_MAX_NSTEPS - 1) / SNAPSHOT_MAX_NSTEPS);
+    check(&snapshot->sesh);
+    snapshot_delete(snapshot);
+
+    // saved while playing, over as many cycles
+    sq_session_start(sesh);
+    fakejack_start(0, NULL, NULL);
+    sq_session_save(sesh, "test-snapshot.sqb");
+    fakejack_stop();
+    sq_session_stop(sesh);
+    fakejack_cycle();
+
+    sq_session_t loaded = sq_session_load("test-snapshot.sqb");
+    assert(loaded);
+    check(loaded);
+    sq_session_delete_recursive(loaded);
+
+    sq_session_delete_recursive(sesh);
+    sq_trigger_delete(trig);
+    unlink("test-snapshot.sqb");
+    printf("test-snapshot: ok\n");
+
+    return 0;
+
+}
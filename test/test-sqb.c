@@ -0,0 +1,249 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "sequoia/sqb.h"
+#include "fakejack.h"
+
+// the binary format: a session comes back from a round trip as it went in,
+// and a file with any field out of range is turned away whole rather than
+// loaded with values the setters would never have let through
+
+static char *file;
+static long file_size;
+static char *buf;
+
+static void load_file(const char *path) {
+
+    FILE *fp = fopen(path, "rb");
+
+    assert(fp);
+    fseek(fp, 0, SEEK_END);
+    file_size = ftell(fp);
+    rewind(fp);
+    file = malloc(file_size);
+    buf = malloc(file_size);
+    assert(fread(file, 1, file_size, fp) == file_size);
+    fclose(fp);
+
+}
+
+static bool loads(long size) {
+
+    // writes out buf, as it's been corrupted, and tries loading it
+
+    FILE *fp = fopen("test-sqb-bad.sqb", "wb");
+    sq_session_t sesh;
+
+    assert(fp);
+    fwrite(buf, 1, size, fp);
+    fclose(fp);
+    if ((sesh = sq_session_load("test-sqb-bad.sqb"))) {
+        sq_session_delete_recursive(sesh);
+    }
+
+    return sesh != NULL;
+
+}
+
+static struct sqb_header *header(void) {
+
+    memcpy(buf, file, file_size);
+
+    return (struct sqb_header*) buf;
+
+}
+
+static struct sqb_sequence *seq_rec(int i) {
+
+    struct sqb_header *hdr = header();
+
+    return (struct sqb_sequence*) (buf + hdr->sequences.offset) + i;
+
+}
+
+static struct sqb_trigger *trig_rec(int i) {
+
+    struct sqb_header *hdr = header();
+
+    return (struct sqb_trigger*) (buf + hdr->trigs.offset) + i;
+
+}
+
+static struct sqb_inport *inport_rec(int i) {
+
+    struct sqb_header *hdr = header();
+
+    return (struct sqb_inport*) (buf + hdr->inports.offset) + i;
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("sqb");
+    sq_session_set_bpm(sesh, 97.5);
+    sq_outport_t out0 = sq_outport_new("out0"), out1 = sq_outport_new("out1");
+    sq_session_register_outport(sesh, out0);
+    sq_session_register_outport(sesh, out1);
+
+    sq_sequence_t lead = sq_sequence_new(16);
+    sq_sequence_set_name(lead, "lead");
+    sq_sequence_set_outport(lead, out0);
+    sq_sequence_add_fanout(lead, out1);
+    sq_sequence_set_transpose(lead, -3);
+    sq_sequence_set_clockdivide(lead, 3);
+    sq_sequence_set_first(lead, 2);
+    sq_sequence_set_last(lead, 13);
+    sq_sequence_set_motion(lead, MOTION_BOUNCE);
+    sq_sequence_set_mute(lead, true);
+
+    sq_trigger_t trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_trigger_set_note_value(trig, 72);
+    sq_trigger_set_note_velocity(trig, 33);
+    sq_trigger_set_note_length(trig, 2.5);
+    sq_trigger_set_channel(trig, 16);
+    sq_trigger_set_microtime(trig, -0.25);
+    sq_trigger_set_probability(trig, 0.75);
+    sq_sequence_set_trig(lead, 0, trig);
+    sq_trigger_set_type(trig, TRIG_CC);
+    sq_trigger_set_cc_number(trig, 74);
+    sq_trigger_set_cc_value(trig, 127);
+    sq_trigger_set_outport(trig, 1);
+    sq_sequence_set_trig(lead, 15, trig);
+    sq_session_add_sequence(sesh, lead);
+
+    sq_sequence_t echo = sq_sequence_new_linked(lead);
+    sq_sequence_set_name(echo, "echo");
+    sq_session_add_sequence(sesh, echo);
+
+    sq_inport_t inport = sq_inport_new("keys");
+    sq_inport_set_type(inport, INPORT_RECORD);
+    sq_inport_set_record_mode(inport, RECORD_REPLACE);
+    sq_inport_add_sequence(inport, echo);
+    sq_inport_add_thru(inport, out1);
+    sq_inport_set_thru_channel(inport, 5);
+    sq_inport_set_thru_transpose(inport, 12);
+    sq_session_register_inport(sesh, inport);
+
+    sq_session_save(sesh, "test-sqb.sqb");
+    sq_session_delete_recursive(sesh);
+
+    // the round trip
+    sesh = sq_session_load("test-sqb.sqb");
+    assert(sesh && !strcmp(sq_session_get_name(sesh), "sqb"));
+    assert(sq_session_get_bpm(sesh) == 97.5);
+    assert((sq_session_get_noutports(sesh) == 2) && (sq_session_get_nseqs(sesh) == 2));
+    assert(!strcmp(sq_outport_get_name(sq_session_get_outport(sesh, 1)), "out1"));
+
+    lead = sq_session_find_seq(sesh, "lead");
+    echo = sq_session_find_seq(sesh, "echo");
+    assert(lead && echo && (lead->pattern == echo->pattern) && sq_sequence_is_linked(echo));
+    assert(sq_sequence_get_outport(lead) == sq_session_get_outport(sesh, 0));
+    assert(lead->fanout == 0x2);
+    assert((sq_sequence_get_transpose(lead) == -3) && (sq_sequence_get_clockdivide(lead) == 3));
+    assert((sq_sequence_get_first(lead) == 2) && (sq_sequence_get_last(lead) == 13));
+    assert((sq_sequence_get_motion(lead) == MOTION_BOUNCE) && sq_sequence_get_mute(lead));
+
+    sq_sequence_get_trig(lead, 0, trig);
+    assert((trig->type == TRIG_NOTE) && (trig->note_value == 72) && (trig->note_velocity == 33));
+    assert((trig->note_length == 2.5) && (trig->channel == 16) && (trig->microtime == -0.25));
+    assert((trig->probability == 0.75) && (trig->outport == -1));
+    sq_sequence_get_trig(lead, 15, trig);
+    assert((trig->type == TRIG_CC) && (trig->cc_number == 74) && (trig->cc_value == 127));
+    assert(trig->outport == 1);
+    sq_sequence_get_trig(lead, 7, trig);
+    assert(trig->type == TRIG_NULL);
+
+    inport = sq_session_get_inport(sesh, 0);
+    assert(!strcmp(sq_inport_get_name(inport), "keys"));
+    assert((sq_inport_get_type(inport) == INPORT_RECORD));
+    assert(sq_inport_get_record_mode(inport) == RECORD_REPLACE);
+    assert((sq_inport_get_thru_channel(inport) == 5) && (sq_inport_get_thru_transpose(inport) == 12));
+    assert((inport->nseqs == 1) && (inport->seqs[0] == echo));
+    assert((inport->nthru == 1) && (inport->thru[0] == sq_session_get_outport(sesh, 1)));
+    sq_session_delete_recursive(sesh);
+
+    // validation. the file as it is loads, so each failure below is down to
+    // the one field changed
+    load_file("test-sqb.sqb");
+    header();
+    assert(loads(file_size));
+    assert(!loads(file_size - 1));
+    assert(!loads(sizeof(struct sqb_header) - 1));
+
+    header()->magic[0] = 'X';
+    assert(!loads(file_size));
+    header()->version = SQB_VERSION + 1;
+    assert(!loads(file_size));
+    header()->trigs.count = 1;     // fewer than the sequences refer to
+    assert(!loads(file_size));
+    header()->strings.offset = file_size;
+    assert(!loads(file_size));
+
+    seq_rec(0)->nsteps = 0;
+    assert(!loads(file_size));
+    seq_rec(0)->outport = 2;
+    assert(!loads(file_size));
+    seq_rec(0)->fanout = 0x4;
+    assert(!loads(file_size));
+    seq_rec(0)->link = 1;
+    assert(!loads(file_size));
+    seq_rec(1)->ntrigs += 1;
+    assert(!loads(file_size));
+    inport_rec(0)->nthru += 1;
+    assert(!loads(file_size));
+
+    trig_rec(1)->skip = 15;     // past the end of the sequence
+    assert(!loads(file_size));
+    trig_rec(0)->type = TRIG_CC + 1;
+    assert(!loads(file_size));
+    trig_rec(0)->channel = 0;
+    assert(!loads(file_size));
+    trig_rec(0)->channel = 17;
+    assert(!loads(file_size));
+    trig_rec(0)->note_value = 128;
+    assert(!loads(file_size));
+    trig_rec(0)->note_velocity = 200;
+    assert(!loads(file_size));
+    trig_rec(1)->cc_number = 128;
+    assert(!loads(file_size));
+    trig_rec(1)->cc_value = 255;
+    assert(!loads(file_size));
+    trig_rec(1)->outport = SESSION_MAX_NOUTPORTS;
+    assert(!loads(file_size));
+    trig_rec(0)->microtime = -0.75;
+    assert(!loads(file_size));
+    trig_rec(0)->microtime = 0.5;
+    assert(!loads(file_size));
+    trig_rec(0)->microtime = NAN;
+    assert(!loads(file_size));
+    trig_rec(0)->probability = 1.5;
+    assert(!loads(file_size));
+    trig_rec(0)->probability = NAN;
+    assert(!loads(file_size));
+    trig_rec(0)->note_length = -1;
+    assert(!loads(file_size));
+    trig_rec(0)->note_length = INFINITY;
+    assert(!loads(file_size));
+
+    trig_rec(0)->microtime = 0.49;
+    assert(loads(file_size));
+
+    free(file);
+    free(buf);
+    sq_trigger_delete(trig);
+    unlink("test-sqb.sqb");
+    unlink("test-sqb-bad.sqb");
+    printf("test-sqb: ok\n");
+
+    return 0;
+
+}
@@ -0,0 +1,100 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "sequoia.h"
+#include "fakejack.h"
+
+// MIDI thru: channel remap and transpose, notes held across a change of
+// either, and events that don't fit in a cycle counted as dropped
+
+static jack_port_t *in;
+
+static void play(unsigned char status, unsigned char data1, unsigned char data2) {
+
+    jack_midi_data_t msg[3] = {status, data1, data2};
+
+    fakejack_inject(in, 0, msg, 3);
+    fakejack_cycle();
+
+}
+
+static void expect(const char *port, unsigned char status, unsigned char data1) {
+
+    void *buf = jack_port_get_buffer(fakejack_get_port(port), 0);
+    jack_midi_event_t ev;
+
+    assert(jack_midi_get_event_count(buf) == 1);
+    jack_midi_event_get(&ev, buf, 0);
+    assert((ev.buffer[0] == status) && (ev.buffer[1] == data1));
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("thru");
+    sq_outport_t a = sq_outport_new("a");
+    sq_outport_t b = sq_outport_new("b");
+    sq_outport_t c = sq_outport_new("c");
+    sq_session_register_outport(sesh, a);
+    sq_session_register_outport(sesh, b);
+    sq_session_register_outport(sesh, c);
+
+    sq_inport_t inport = sq_inport_new("in");
+    sq_inport_add_thru(inport, a);
+    sq_session_register_inport(sesh, inport);
+    in = fakejack_get_port("in");
+
+    // unmapped, and sysex is never passed through
+    play(0x93, 60, 100);
+    expect("a", 0x93, 60);
+    jack_midi_data_t sysex[3] = {0xF0, 0x01, 0xF7};
+    fakejack_inject(in, 0, sysex, 3);
+    fakejack_cycle();
+    assert(jack_midi_get_event_count(jack_port_get_buffer(fakejack_get_port("a"), 0)) == 0);
+    play(0x83, 60, 0);
+
+    // remapped to channel 10, up a fifth; out-of-range notes are dropped
+    sq_inport_set_thru_channel(inport, 10);
+    sq_inport_set_thru_transpose(inport, 7);
+    fakejack_cycle();
+    assert(sq_inport_get_thru_channel(inport) == 10);
+    assert(sq_inport_get_thru_transpose(inport) == 7);
+    play(0x90, 60, 100);
+    expect("a", 0x99, 67);
+    play(0x90, 125, 100);
+    assert(jack_midi_get_event_count(jack_port_get_buffer(fakejack_get_port("a"), 0)) == 0);
+    play(0xB0, 7, 64);
+    expect("a", 0xB9, 7);
+
+    // the held note is released where it went on, not where it would go now
+    sq_inport_set_thru_channel(inport, 0);
+    sq_inport_set_thru_transpose(inport, -12);
+    fakejack_cycle();
+    play(0x80, 60, 0);
+    expect("a", 0x89, 67);
+    play(0x90, 60, 100);
+    expect("a", 0x90, 48);
+    play(0x80, 60, 0);
+
+    // a cycle with more thru events than the session has room for
+    struct sq_session_stats stats;
+    jack_midi_data_t msg[3] = {0xB0, 1, 0};
+    sq_inport_add_thru(inport, b);
+    sq_inport_add_thru(inport, c);
+    sq_session_get_stats(sesh, &stats);
+    unsigned long dropped = stats.mevs_dropped;
+    for (int i=0; i<3000; i++) {
+        fakejack_inject(in, i * 256 / 3000, msg, 3);
+    }
+    fakejack_cycle();
+    sq_session_get_stats(sesh, &stats);
+    assert(stats.mevs_dropped - dropped == 3 * 3000 - 8192);
+
+    sq_session_delete_recursive(sesh);
+    printf("test-thru: ok\n");
+
+    return 0;
+
+}
@@ -0,0 +1,142 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sequoia.h"
+#include "sequoia/session.h"
+#include "sequoia/journal.h"
+#include "fakejack.h"
+
+// trigs in bulk: a range set in one go reads back the same, stopped or
+// playing, packed or not, and is undone as one edit. ranges and steps out
+// of bounds are turned away before anything is touched, recorded or journaled
+
+#define NSTEPS 4096
+#define NTRIGS 64
+
+static long file_size(const char *path) {
+
+    FILE *fp = fopen(path, "rb");
+    long size;
+
+    assert(fp);
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fclose(fp);
+
+    return size;
+
+}
+
+static void fill(struct trigger_data *trigs, int n, int value) {
+
+    sq_trigger_t trig = sq_trigger_new();
+
+    for (int i=0; i<n; i++) {
+        trigs[i] = *trig;
+        trigs[i].type = TRIG_NOTE;
+        trigs[i].note_value = value + i % 32;
+        trigs[i].note_velocity = 1 + i;
+    }
+    sq_trigger_delete(trig);
+
+}
+
+static void check(sq_sequence_t seq, int first, int n, int value) {
+
+    struct trigger_data trigs[NTRIGS];
+
+    sq_sequence_get_trigs(seq, first, n, trigs);
+    for (int i=0; i<n; i++) {
+        assert((trigs[i].type == TRIG_NOTE) && (trigs[i].note_value == value + i % 32));
+        assert(trigs[i].note_velocity == 1 + i);
+    }
+
+}
+
+int main(void) {
+
+    fakejack_set_params(48000, 256);
+
+    sq_session_t sesh = sq_session_new("trigs");
+    sq_sequence_t seq = sq_sequence_new(16), lng = sq_sequence_new(NSTEPS);
+    sq_session_add_sequence(sesh, seq);
+    sq_session_add_sequence(sesh, lng);
+    assert(sq_session_enable_history(sesh, 8) == 0);
+
+    struct trigger_data trigs[NTRIGS], got[NTRIGS];
+
+    // stopped, then undone as one
+    fill(trigs, 8, 60);
+    sq_sequence_set_trigs(seq, 4, 8, trigs);
+    check(seq, 4, 8, 60);
+    sq_sequence_get_trigs(seq, 0, 16, got);
+    assert((got[3].type == TRIG_NULL) && (got[12].type == TRIG_NULL));
+    assert(sq_session_undo(sesh));
+    sq_sequence_get_trigs(seq, 0, 16, got);
+    for (int step=0; step<16; step++) assert(got[step].type == TRIG_NULL);
+    assert(!sq_session_undo(sesh));
+    assert(sq_session_redo(sesh));
+    check(seq, 4, 8, 60);
+
+    // into a packed sequence, which stays packed
+    fill(trigs, 16, 40);
+    sq_sequence_set_trigs(lng, NSTEPS - 16, 16, trigs);
+    assert(pattern_is_packed(lng->pattern));
+    check(lng, NSTEPS - 16, 16, 40);
+
+    // and while playing
+    sq_session_start(sesh);
+    fakejack_start(0, NULL, NULL);
+    fill(trigs, 16, 80);
+    sq_sequence_set_trigs(seq, 0, 16, trigs);
+    fill(trigs, NTRIGS, 20);
+    sq_sequence_set_trigs(lng, 1000, NTRIGS, trigs);
+    check(seq, 0, 16, 80);
+    check(lng, 1000, NTRIGS, 20);
+    fakejack_stop();
+    sq_session_stop(sesh);
+    fakejack_cycle();
+
+    // ranges that don't fit leave the sequence, and the array, alone
+    sq_session_clear_history(sesh);
+    assert(sq_session_enable_journal(sesh, "test-trigs.sqb") == 0);
+    usleep(10 * JOURNAL_POLL_US);
+    long size = file_size("test-trigs.sqb.journal");
+
+    fill(trigs, NTRIGS, 100);
+    sq_sequence_set_trigs(seq, 8, 9, trigs);
+    sq_sequence_set_trigs(seq, -1, 2, trigs);
+    sq_sequence_set_trigs(seq, 0, -1, trigs);
+    memset(got, 0xff, sizeof(got));
+    sq_sequence_get_trigs(seq, 15, 2, got);
+    sq_sequence_get_trigs(seq, -1, 1, got);
+    for (int i=0; i<(int) sizeof(got); i++) assert(((unsigned char*) got)[i] == 0xff);
+
+    sq_trigger_t trig = sq_trigger_new();
+    sq_trigger_set_type(trig, TRIG_NOTE);
+    sq_sequence_set_trig(seq, 16, trig);
+    sq_sequence_set_trig(seq, -1, trig);
+    sq_sequence_clear_trig(seq, 16);
+    sq_sequence_clear_trig(seq, -1);
+    sq_sequence_set_trig(lng, NSTEPS, trig);
+    sq_sequence_clear_trig(lng, NSTEPS);
+    sq_trigger_delete(trig);
+
+    check(seq, 0, 16, 80);
+    assert(pattern_is_packed(lng->pattern));
+    check(lng, 1000, NTRIGS, 20);
+    assert(!sq_session_undo(sesh));
+    usleep(10 * JOURNAL_POLL_US);
+    assert(file_size("test-trigs.sqb.journal") == size);
+
+    sq_session_disable_journal(sesh);
+    sq_session_delete_recursive(sesh);
+    unlink("test-trigs.sqb");
+    unlink("test-trigs.sqb.journal");
+    printf("test-trigs: ok\n");
+
+    return 0;
+
+}